@@ -0,0 +1,38 @@
+#include <atomic>
+
+#include "cpu.h"
+
+namespace base {
+  namespace {
+    std::atomic<int> max_simd_level(static_cast<int>(SimdLevel::kAvx512));
+
+    SimdLevel DetectSimdLevel() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+      __builtin_cpu_init();
+      if(__builtin_cpu_supports("avx512f"))
+        return SimdLevel::kAvx512;
+      if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::kAvx2;
+#endif
+      return SimdLevel::kScalar;
+    }
+  }
+
+  // The widest instruction set supported by this processor.
+  SimdLevel SupportedSimdLevel() {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+  }
+
+  // The instruction set the kernels dispatch to.
+  SimdLevel ActiveSimdLevel() {
+    int supported = static_cast<int>(SupportedSimdLevel());
+    int cap = max_simd_level.load(std::memory_order_relaxed);
+    return static_cast<SimdLevel>(supported < cap ? supported : cap);
+  }
+
+  // Caps the instruction set used by the kernels.
+  void SetMaxSimdLevel(SimdLevel level) {
+    max_simd_level.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+}
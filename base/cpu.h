@@ -0,0 +1,39 @@
+#ifndef _base_cpu_h
+#define _base_cpu_h
+
+namespace base {
+
+// The instruction sets the numeric kernels have specialized code for,
+// ordered from the most portable to the widest.
+enum class SimdLevel {
+  kScalar = 0,
+  kAvx2 = 1,    // AVX2 + FMA
+  kAvx512 = 2,  // AVX-512F
+};
+
+// ----------------------------------------------------------------------------
+/// @Brief  The widest instruction set that is supported by the running
+///         processor. It is detected once, on the first call.
+// ----------------------------------------------------------------------------
+SimdLevel SupportedSimdLevel();
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  The instruction set the kernels dispatch to: the supported one,
+///         capped by SetMaxSimdLevel.
+// ----------------------------------------------------------------------------
+SimdLevel ActiveSimdLevel();
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  Caps the instruction set used by the kernels. Mostly useful to
+///         compare the code paths against each other, or to get results
+///         that do not depend on the machine.
+///
+/// @Param level The widest instruction set the kernels may use.
+// ----------------------------------------------------------------------------
+void SetMaxSimdLevel(SimdLevel level);
+
+} // namespace base
+
+#endif
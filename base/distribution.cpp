@@ -1,9 +1,50 @@
 #include <algorithm>
-#include <random>
+#include <cmath>
+#include <functional>
 
 #include "distribution.h"
+#include "vmath.h"
 
 namespace base {
+  namespace {
+    // The sorting buffer of DistributionView::GuessingEntropy.
+    std::vector<double>& ThreadScratch() {
+      thread_local std::vector<double> scratch;
+      return scratch;
+    }
+  }
+
+  // The Shannon entropy of the viewed values.
+  double DistributionView::ShannonEntropy() const {
+    return Entropy(this->data_, this->size_);
+  }
+
+  // The guessing entropy of the viewed values.
+  double DistributionView::GuessingEntropy() const {
+    std::vector<double>& scratch = ThreadScratch();
+    scratch.assign(this->begin(), this->end());
+    return base::GuessingEntropy(scratch.data(), scratch.size());
+  }
+
+  // The min-entropy of the viewed values.
+  double DistributionView::MinEntropy() const {
+    double max = 0;
+    for(double value : *this) max = std::max(max, value);
+    return -log2(max);
+  }
+
+  // Whether the viewed values are a probability distribution.
+  bool DistributionView::isDistribution(double eps) const {
+    if(this->size_ == 0) return true;
+
+    double sum = 0;
+    for(double value : *this) {
+      if(value < 0) return false;
+      sum += value;
+    }
+    return (fabs(sum-1.0f) < eps);
+  }
+
   // Creates a new distribution with 'size' elements.
   //  'uniform' indicates whether the distribution will be uniform,
   //  or randomly generated.
@@ -13,7 +54,7 @@ namespace base {
                                                 this->base_norm_);
     }
     else {
-      Distribution::GenerateRandomDistribution(size, this->pdist_,
+      Distribution::GenerateRandomDistribution(ThreadRng(), size, this->pdist_,
                                                this->base_norm_);
     }
   }
@@ -26,11 +67,12 @@ namespace base {
   }
 
   // Generates a new random distribution.
-  Distribution Distribution::GenerateRandomDistribution(int size) {
+  Distribution Distribution::GenerateRandomDistribution(int size, Rng* rng) {
     std::vector<double> vdist;
     long long base_norm = 0;
     
-    Distribution::GenerateRandomDistribution(size, vdist, base_norm);
+    Distribution::GenerateRandomDistribution(rng ? *rng : ThreadRng(), size,
+                                             vdist, base_norm);
 
     return Distribution(vdist, base_norm);
   }
@@ -42,17 +84,14 @@ namespace base {
   }
 
   // Generates a new random distribution.
-  void Distribution::GenerateRandomDistribution(int size,
+  void Distribution::GenerateRandomDistribution(Rng& rng, int size,
                                                 std::vector<double>& vdist,
                                                 long long& base_norm) {
-    std::mt19937 rng;
-    rng.seed(std::random_device()());
-    std::uniform_int_distribution<std::mt19937::result_type> dist(0,1e7);
     vdist.resize(size, 0);
     base_norm = 0;
     
     for(int i = 0; i < size; i++) {
-      int neue = dist(rng);
+      int neue = rng.UniformInt(0, 1e7);
       base_norm += neue;
       vdist[i] = neue;
     }
@@ -75,43 +114,39 @@ namespace base {
   }
 
   // Creates a new random distribution, maintaining the same size.
-  void Distribution::Randomize() {
-    this->pdist_ = Distribution::GenerateRandomDistribution(this->pdist_.size()).pdist();
+  void Distribution::Randomize(Rng* rng) {
+    this->pdist_ = Distribution::GenerateRandomDistribution(this->pdist_.size(), rng).pdist();
   }
 
   // Returns the shannon entropy of this distribution.
   double Distribution::ShannonEntropy() const {
-    double entropy = 0;
-    for(double value : this->pdist_) {
-      if(value > 0)
-        entropy += (value*log2(1.0f/value));
-    }
-    return entropy;
+    return this->view().ShannonEntropy();
   }
 
   // Returns the guessing entropy of this distribution.
   double Distribution::GuessingEntropy() const {
-    double entropy = 0; 
-    std::vector<double> sorted_prior = this->pdist();
-    std::sort(sorted_prior.begin(), sorted_prior.end());
-    std::reverse(sorted_prior.begin(), sorted_prior.end());
-    int i = 1;
-    for(double value : sorted_prior) {
-      if(value > 0)
-        entropy += ((i++)*value);
-    }
+    return this->view().GuessingEntropy();
+  }
+
+  // Returns the min-entropy of this distribution.
+  double Distribution::MinEntropy() const {
+    return this->view().MinEntropy();
+  }
+
+  // sum_k k * v_k over the positive values, in descending order.
+  double GuessingEntropy(double* values, long long n) {
+    double* end = std::partition(values, values + n,
+                                 [](double value) { return value > 0; });
+    std::sort(values, end, std::greater<double>());
+    double entropy = 0;
+    long long i = 1;
+    for(const double* value = values; value != end; value++)
+      entropy += ((i++)*(*value));
     return entropy;
-  } 
+  }
 
   // Returns if the received vector contains a probability distribution.
   bool Distribution::isDistribution(const std::vector<double> &dist) {
-    if(dist.size() == 0) return true;
-    
-    double sum = 0;
-    for(double value : dist) {
-      if(value < 0) return false;
-      sum += value;
-    }
-    return (fabs(sum-1.0f) < this->eps);
+    return DistributionView(dist).isDistribution(this->eps);
   }
 }
@@ -1,10 +1,63 @@
 #ifndef _base_distribution_h
 #define _base_distribution_h
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 
+#include "random.h"
+
 namespace base {
 
+// A probability distribution held in memory owned by someone else, e.g. a
+// row of a channel matrix or the prior of a Channel. It is as cheap to
+// copy as a pointer, and must not outlive the values it points to.
+class DistributionView {
+  public:
+    DistributionView(const double* data, size_t size)
+      : data_(data), size_(size) {}
+
+    DistributionView(const std::vector<double>& dist)
+      : data_(dist.data()), size_(dist.size()) {}
+
+    const double* data() const { return this->data_; }
+    size_t size() const { return this->size_; }
+    const double* begin() const { return this->data_; }
+    const double* end() const { return this->data_ + this->size_; }
+    double operator[](size_t x) const { return this->data_[x]; }
+
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Shannon entropy, see base::Entropy.
+    // ----------------------------------------------------------------------------
+    double ShannonEntropy() const;
+
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Guessing entropy, sum_k k * p_k with p_1 >= p_2 >= ... The
+    ///         values are sorted in a buffer of the calling thread, which
+    ///         is reused by the next calls.
+    // ----------------------------------------------------------------------------
+    double GuessingEntropy() const;
+
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Min-entropy, -log2(max_x p(x)).
+    // ----------------------------------------------------------------------------
+    double MinEntropy() const;
+
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Whether the values are not negative and sum to 1, give or
+    ///         take [eps]. An empty view is a distribution.
+    // ----------------------------------------------------------------------------
+    bool isDistribution(double eps=1e-6) const;
+
+  private:
+    const double* data_;
+    size_t size_;
+};
+
+
 class Distribution {
   public:
     // --------------------------------------------------------------------------
@@ -38,14 +91,22 @@ class Distribution {
     const std::vector<double>& pdist() const { return this->pdist_; }
 
 
+    // --------------------------------------------------------------------------
+    /// @Brief  A view of this distribution, valid while it is not changed.
+    // ----------------------------------------------------------------------------
+    DistributionView view() const { return DistributionView(this->pdist_); }
+
+
     // --------------------------------------------------------------------------
     /// @Brief  Generates a new random distribution.
     ///
     /// @Param size The size of the probability distribution.
+    /// @Param rng The generator to draw from. By default, the one of the
+    ///            calling thread, see base::ThreadRng.
     ///
     /// @Returns   Returns a Distribution object.
     // ----------------------------------------------------------------------------
-    static Distribution GenerateRandomDistribution(int size);
+    static Distribution GenerateRandomDistribution(int size, Rng* rng=nullptr);
     
 
     // --------------------------------------------------------------------------
@@ -70,8 +131,10 @@ class Distribution {
 
     // --------------------------------------------------------------------------
     /// @Brief  Creates a new random distribution, maintaining the same size.
+    ///
+    /// @Param rng As in GenerateRandomDistribution.
     // ----------------------------------------------------------------------------
-    void Randomize();
+    void Randomize(Rng* rng=nullptr);
 
 
     // --------------------------------------------------------------------------
@@ -90,6 +153,14 @@ class Distribution {
     double GuessingEntropy() const;
 
 
+    // --------------------------------------------------------------------------
+    /// @Brief  Min-entropy.
+    ///
+    /// @Returns   A double. -log2 of the largest probability.
+    // ----------------------------------------------------------------------------
+    double MinEntropy() const;
+
+
     // --------------------------------------------------------------------------
     /// @Brief  Returns if the received vector represents a probability
     ///         distribution.
@@ -117,12 +188,13 @@ class Distribution {
     // --------------------------------------------------------------------------
     /// @Brief  Generates a new random distribution.
     ///
+    /// @Param rng The generator to draw from.
     /// @Param size The size of the newly generated probability distribution.
     /// @Param vdist A vector<double> which will be filled with the distribution.
     /// @Param base_norm The common denominator used to generate this probability
     ///                  distribution.
     // ----------------------------------------------------------------------------
-    static void GenerateRandomDistribution(int size, std::vector<double>& vdist, long long& base_norm);
+    static void GenerateRandomDistribution(Rng& rng, int size, std::vector<double>& vdist, long long& base_norm);
 
 
     // --------------------------------------------------------------------------
@@ -136,6 +208,19 @@ class Distribution {
     static void GenerateUniformDistribution(int size, std::vector<double>& vdist, long long& base_norm);
 };
 
+
+// ----------------------------------------------------------------------------
+/// @Brief  Guessing entropy of the positive values in [values], that is
+///         sum_k k * v_k with v_1 >= v_2 >= ... The positive values are
+///         moved to the front and sorted there, so the other ones cost a
+///         single pass; the sums are the ones of
+///         Distribution::GuessingEntropy. Nothing is allocated, so callers
+///         can reuse one scratch buffer for many vectors.
+///
+/// @Param values [n] values, which are reordered.
+// ----------------------------------------------------------------------------
+double GuessingEntropy(double* values, long long n);
+
 } // namespace base
 
 #endif
@@ -0,0 +1,162 @@
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define QIF_X86_KERNELS 1
+#endif
+
+#include "cpu.h"
+#include "gemm.h"
+#include "parallel.h"
+
+namespace base {
+  namespace {
+    // Rows of A handled together by a micro kernel.
+    const int kRows = 4;
+
+    // Rows of B (i.e. columns of A) kept hot in cache at a time.
+    const int kDepthBlock = 128;
+
+    // Columns of B kept hot in cache at a time.
+    const int kColBlock = 256;
+
+    struct GemmArgs {
+      const double* a; int lda;
+      const double* b; int ldb;
+      double* c; int ldc;
+      int cols, depth;
+    };
+
+    // A micro kernel adds A(0..3, 0..depth) * B(0..depth, 0..W) to the
+    // 4 x W tile of C that starts at c.
+    typedef void (*MicroKernel)(const double* a, int lda,
+                                const double* b, int ldb,
+                                double* c, int ldc, int depth);
+
+    // C(i, j0..j1) += A(i, k0..k1) * B(k0..k1, j0..j1), one row at a time.
+    // Used for the rows and columns that do not fill a whole tile.
+    void EdgeRows(const GemmArgs& g, int i0, int i1, int k0, int k1,
+                  int j0, int j1) {
+      for(int i = i0; i < i1; i++) {
+        double* c_row = g.c + (long long)i*g.ldc;
+        const double* a_row = g.a + (long long)i*g.lda;
+        for(int k = k0; k < k1; k++) {
+          double a_ik = a_row[k];
+          const double* b_row = g.b + (long long)k*g.ldb;
+          for(int j = j0; j < j1; j++)
+            c_row[j] += a_ik * b_row[j];
+        }
+      }
+    }
+
+    // Walks the blocks of C(row_begin..row_end, :), calling the micro kernel
+    // on every whole 4 x W tile.
+    void Blocked(const GemmArgs& g, int row_begin, int row_end,
+                 MicroKernel micro, int width) {
+      for(int kk = 0; kk < g.depth; kk += kDepthBlock) {
+        int k_end = std::min(kk + kDepthBlock, g.depth);
+        for(int jj = 0; jj < g.cols; jj += kColBlock) {
+          int j_end = std::min(jj + kColBlock, g.cols);
+          int j_tiles = jj + (j_end - jj) / width * width;
+          int i = row_begin;
+          for(; i + kRows <= row_end; i += kRows) {
+            const double* a = g.a + (long long)i*g.lda + kk;
+            for(int j = jj; j < j_tiles; j += width)
+              micro(a, g.lda, g.b + (long long)kk*g.ldb + j, g.ldb,
+                    g.c + (long long)i*g.ldc + j, g.ldc, k_end - kk);
+            EdgeRows(g, i, i + kRows, kk, k_end, j_tiles, j_end);
+          }
+          EdgeRows(g, i, row_end, kk, k_end, jj, j_end);
+        }
+      }
+    }
+
+#ifdef QIF_X86_KERNELS
+    __attribute__((target("avx2,fma")))
+    void MicroAvx2(const double* a, int lda, const double* b, int ldb,
+                   double* c, int ldc, int depth) {
+      __m256d c00 = _mm256_loadu_pd(c),         c01 = _mm256_loadu_pd(c + 4);
+      __m256d c10 = _mm256_loadu_pd(c + ldc),   c11 = _mm256_loadu_pd(c + ldc + 4);
+      __m256d c20 = _mm256_loadu_pd(c + 2*ldc), c21 = _mm256_loadu_pd(c + 2*ldc + 4);
+      __m256d c30 = _mm256_loadu_pd(c + 3*ldc), c31 = _mm256_loadu_pd(c + 3*ldc + 4);
+      for(int k = 0; k < depth; k++) {
+        const double* b_row = b + (long long)k*ldb;
+        __m256d b0 = _mm256_loadu_pd(b_row), b1 = _mm256_loadu_pd(b_row + 4);
+        __m256d a0 = _mm256_broadcast_sd(a + k);
+        __m256d a1 = _mm256_broadcast_sd(a + lda + k);
+        __m256d a2 = _mm256_broadcast_sd(a + 2*lda + k);
+        __m256d a3 = _mm256_broadcast_sd(a + 3*lda + k);
+        c00 = _mm256_fmadd_pd(a0, b0, c00); c01 = _mm256_fmadd_pd(a0, b1, c01);
+        c10 = _mm256_fmadd_pd(a1, b0, c10); c11 = _mm256_fmadd_pd(a1, b1, c11);
+        c20 = _mm256_fmadd_pd(a2, b0, c20); c21 = _mm256_fmadd_pd(a2, b1, c21);
+        c30 = _mm256_fmadd_pd(a3, b0, c30); c31 = _mm256_fmadd_pd(a3, b1, c31);
+      }
+      _mm256_storeu_pd(c, c00);         _mm256_storeu_pd(c + 4, c01);
+      _mm256_storeu_pd(c + ldc, c10);   _mm256_storeu_pd(c + ldc + 4, c11);
+      _mm256_storeu_pd(c + 2*ldc, c20); _mm256_storeu_pd(c + 2*ldc + 4, c21);
+      _mm256_storeu_pd(c + 3*ldc, c30); _mm256_storeu_pd(c + 3*ldc + 4, c31);
+    }
+
+    __attribute__((target("avx512f")))
+    void MicroAvx512(const double* a, int lda, const double* b, int ldb,
+                     double* c, int ldc, int depth) {
+      __m512d c00 = _mm512_loadu_pd(c),         c01 = _mm512_loadu_pd(c + 8);
+      __m512d c10 = _mm512_loadu_pd(c + ldc),   c11 = _mm512_loadu_pd(c + ldc + 8);
+      __m512d c20 = _mm512_loadu_pd(c + 2*ldc), c21 = _mm512_loadu_pd(c + 2*ldc + 8);
+      __m512d c30 = _mm512_loadu_pd(c + 3*ldc), c31 = _mm512_loadu_pd(c + 3*ldc + 8);
+      for(int k = 0; k < depth; k++) {
+        const double* b_row = b + (long long)k*ldb;
+        __m512d b0 = _mm512_loadu_pd(b_row), b1 = _mm512_loadu_pd(b_row + 8);
+        __m512d a0 = _mm512_set1_pd(a[k]);
+        __m512d a1 = _mm512_set1_pd(a[lda + k]);
+        __m512d a2 = _mm512_set1_pd(a[2*lda + k]);
+        __m512d a3 = _mm512_set1_pd(a[3*lda + k]);
+        c00 = _mm512_fmadd_pd(a0, b0, c00); c01 = _mm512_fmadd_pd(a0, b1, c01);
+        c10 = _mm512_fmadd_pd(a1, b0, c10); c11 = _mm512_fmadd_pd(a1, b1, c11);
+        c20 = _mm512_fmadd_pd(a2, b0, c20); c21 = _mm512_fmadd_pd(a2, b1, c21);
+        c30 = _mm512_fmadd_pd(a3, b0, c30); c31 = _mm512_fmadd_pd(a3, b1, c31);
+      }
+      _mm512_storeu_pd(c, c00);         _mm512_storeu_pd(c + 8, c01);
+      _mm512_storeu_pd(c + ldc, c10);   _mm512_storeu_pd(c + ldc + 8, c11);
+      _mm512_storeu_pd(c + 2*ldc, c20); _mm512_storeu_pd(c + 2*ldc + 8, c21);
+      _mm512_storeu_pd(c + 3*ldc, c30); _mm512_storeu_pd(c + 3*ldc + 8, c31);
+    }
+#endif
+
+    // Multiplies the rows [row_begin, row_end) of A by B.
+    void MultiplyRows(const GemmArgs& g, int row_begin, int row_end,
+                      SimdLevel level) {
+#ifdef QIF_X86_KERNELS
+      if(level == SimdLevel::kAvx512) {
+        Blocked(g, row_begin, row_end, MicroAvx512, 16);
+        return;
+      }
+      if(level == SimdLevel::kAvx2) {
+        Blocked(g, row_begin, row_end, MicroAvx2, 8);
+        return;
+      }
+#endif
+      // Without SIMD, the row loops of EdgeRows are already the best
+      // order: the innermost loop streams a row of B into a row of C.
+      for(int kk = 0; kk < g.depth; kk += kDepthBlock) {
+        int k_end = std::min(kk + kDepthBlock, g.depth);
+        for(int jj = 0; jj < g.cols; jj += kColBlock)
+          EdgeRows(g, row_begin, row_end, kk, k_end, jj,
+                   std::min(jj + kColBlock, g.cols));
+      }
+    }
+  }
+
+  // Computes the product A * B.
+  Matrix Multiply(const MatrixView& a, const MatrixView& b, int threads) {
+    Matrix c(a.rows(), b.cols(), 0);
+    GemmArgs g = {a.data(), a.stride(), b.data(), b.stride(),
+                  c.data(), c.cols(), b.cols(), a.cols()};
+    SimdLevel level = ActiveSimdLevel();
+    ParallelFor(0, a.rows(), threads,
+                [&g, level](int row_begin, int row_end) {
+                  MultiplyRows(g, row_begin, row_end, level);
+                }, kRows);
+    return c;
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef _base_gemm_h
+#define _base_gemm_h
+
+#include "matrix.h"
+
+namespace base {
+
+// ----------------------------------------------------------------------------
+/// @Brief  Computes the product C = A * B of two row-major matrices.
+///         This is the kernel behind channel cascading, where A is the
+///         first channel matrix and B the second one.
+///
+///         The work is split in blocks of rows of A (one block per thread),
+///         then in panels of B small enough to stay in cache. Each 4 x W
+///         tile of C is kept in registers, using AVX2 (W = 8) or AVX-512
+///         (W = 16) when the processor has them (see base/cpu.h).
+///
+///         Every C(i, j) is accumulated in the same order, k = 0, 1, ...,
+///         whatever the path and the number of threads. The scalar path
+///         gives exactly the result of the textbook triple loop. The SIMD
+///         paths use fused multiply-adds, which round once per step instead
+///         of twice, so they may differ from it by at most
+///             |dC(i, j)| <= K * 2^-53 * sum_k |A(i, k) * B(k, j)|,
+///         where K = A.cols(). For channels (rows summing to one) that is
+///         below K * 1.2e-16 per entry.
+///
+/// @Param a A n x K matrix.
+/// @Param b A K x m matrix.
+/// @Param threads The number of threads used to split the rows of A.
+///
+/// @Returns   The n x m matrix A * B.
+// ----------------------------------------------------------------------------
+Matrix Multiply(const MatrixView& a, const MatrixView& b, int threads=1);
+
+} // namespace base
+
+#endif
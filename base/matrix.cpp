@@ -0,0 +1,54 @@
+#include <algorithm>
+
+#include "matrix.h"
+
+namespace base {
+  // Creates a rows x cols matrix filled with value.
+  Matrix::Matrix(int rows, int cols, double value) {
+    this->assign(rows, cols, value);
+  }
+
+  // Copies a matrix stored as a vector of rows.
+  Matrix::Matrix(const std::vector<std::vector<double> >& rows) {
+    this->rows_ = rows.size();
+    this->cols_ = rows.empty() ? 0 : rows[0].size();
+    this->data_.resize((std::size_t)this->rows_*this->cols_);
+    for(int i = 0; i < this->rows_; i++)
+      std::copy(rows[i].begin(), rows[i].begin() + this->cols_,
+                this->data_.begin() + (std::size_t)i*this->cols_);
+  }
+
+  // Resizes the matrix and fills it with value.
+  void Matrix::assign(int rows, int cols, double value) {
+    this->rows_ = rows;
+    this->cols_ = cols;
+    this->data_.assign((std::size_t)rows*cols, value);
+  }
+
+  // Returns the transpose of this matrix.
+  Matrix Matrix::Transposed() const {
+    // Copying in square tiles keeps both the reads and the writes
+    // inside a few cache lines.
+    const int tile = 32;
+    Matrix t(this->cols_, this->rows_);
+    for(int ii = 0; ii < this->rows_; ii += tile) {
+      int i_end = std::min(ii + tile, this->rows_);
+      for(int jj = 0; jj < this->cols_; jj += tile) {
+        int j_end = std::min(jj + tile, this->cols_);
+        for(int i = ii; i < i_end; i++)
+          for(int j = jj; j < j_end; j++)
+            t(j, i) = (*this)(i, j);
+      }
+    }
+    return t;
+  }
+
+  // Copies the matrix into a vector of rows.
+  std::vector<std::vector<double> > Matrix::to_vectors() const {
+    std::vector<std::vector<double> > v(this->rows_);
+    for(int i = 0; i < this->rows_; i++)
+      v[i].assign(this->data_.begin() + (std::size_t)i*this->cols_,
+                  this->data_.begin() + (std::size_t)(i+1)*this->cols_);
+    return v;
+  }
+}
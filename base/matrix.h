@@ -0,0 +1,191 @@
+#ifndef _base_matrix_h
+#define _base_matrix_h
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace base {
+
+// ----------------------------------------------------------------------------
+/// @Brief  A non-owning view over [size] elements placed [stride] elements
+///         apart. Rows of a Matrix are views with stride 1, columns are
+///         views with stride equal to the row stride.
+// ----------------------------------------------------------------------------
+template <typename T>
+class Span {
+  public:
+    class iterator {
+      public:
+        iterator(T* ptr, std::ptrdiff_t stride) : ptr_(ptr), stride_(stride) {}
+        T& operator*() const { return *this->ptr_; }
+        iterator& operator++() { this->ptr_ += this->stride_; return *this; }
+        bool operator==(const iterator& o) const { return this->ptr_ == o.ptr_; }
+        bool operator!=(const iterator& o) const { return this->ptr_ != o.ptr_; }
+      private:
+        T* ptr_;
+        std::ptrdiff_t stride_;
+    };
+
+    Span() : data_(nullptr), size_(0), stride_(1) {}
+    Span(T* data, int size, std::ptrdiff_t stride=1)
+      : data_(data), size_(size), stride_(stride) {}
+
+    // A view over mutable memory can always be read as a const view.
+    operator Span<const T>() const {
+      return Span<const T>(this->data_, this->size_, this->stride_);
+    }
+
+    T& operator[](int i) const { return this->data_[i*this->stride_]; }
+
+    T* data() const { return this->data_; }
+    int size() const { return this->size_; }
+    std::ptrdiff_t stride() const { return this->stride_; }
+    bool contiguous() const { return this->stride_ == 1; }
+
+    iterator begin() const { return iterator(this->data_, this->stride_); }
+    iterator end() const {
+      return iterator(this->data_ + this->size_*this->stride_, this->stride_);
+    }
+
+    // Copies the viewed elements into a new vector.
+    std::vector<typename std::remove_const<T>::type> to_vector() const {
+      std::vector<typename std::remove_const<T>::type> v(this->size_);
+      for(int i = 0; i < this->size_; i++) v[i] = (*this)[i];
+      return v;
+    }
+
+  private:
+    T* data_;
+    int size_;
+    std::ptrdiff_t stride_;
+};
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  A read-only, non-owning view over a row-major matrix of doubles.
+///         It is what the numeric kernels consume, so they work the same
+///         way over a Matrix or over memory that is owned by someone else.
+// ----------------------------------------------------------------------------
+class MatrixView {
+  public:
+    MatrixView() : data_(nullptr), rows_(0), cols_(0), stride_(0) {}
+    MatrixView(const double* data, int rows, int cols, int stride)
+      : data_(data), rows_(rows), cols_(cols), stride_(stride) {}
+    MatrixView(const double* data, int rows, int cols)
+      : MatrixView(data, rows, cols, cols) {}
+
+    int rows() const { return this->rows_; }
+    int cols() const { return this->cols_; }
+    int stride() const { return this->stride_; }
+    const double* data() const { return this->data_; }
+
+    double operator()(int i, int j) const {
+      return this->data_[(std::ptrdiff_t)i*this->stride_ + j];
+    }
+
+    Span<const double> operator[](int i) const { return this->row(i); }
+
+    Span<const double> row(int i) const {
+      return Span<const double>(this->data_ + (std::ptrdiff_t)i*this->stride_,
+                                this->cols_);
+    }
+
+    Span<const double> column(int j) const {
+      return Span<const double>(this->data_ + j, this->rows_, this->stride_);
+    }
+
+  private:
+    const double* data_;
+    int rows_, cols_, stride_;
+};
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  A dense matrix of doubles kept in one contiguous row-major block.
+///         m[i] returns a span over the i-th row, so m[i][j] keeps working
+///         for code written against vector<vector<double> >.
+// ----------------------------------------------------------------------------
+class Matrix {
+  public:
+    Matrix() : rows_(0), cols_(0) {}
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Creates a [rows] x [cols] matrix filled with [value].
+    // ----------------------------------------------------------------------------
+    Matrix(int rows, int cols, double value=0);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Copies a matrix stored as a vector of rows. Every row must have
+    ///         the same size as the first one.
+    // ----------------------------------------------------------------------------
+    explicit Matrix(const std::vector<std::vector<double> >& rows);
+
+    int rows() const { return this->rows_; }
+    int cols() const { return this->cols_; }
+    bool empty() const { return this->data_.empty(); }
+
+    double* data() { return this->data_.data(); }
+    const double* data() const { return this->data_.data(); }
+
+    double& operator()(int i, int j) {
+      return this->data_[(std::size_t)i*this->cols_ + j];
+    }
+    double operator()(int i, int j) const {
+      return this->data_[(std::size_t)i*this->cols_ + j];
+    }
+
+    Span<double> operator[](int i) { return this->row(i); }
+    Span<const double> operator[](int i) const { return this->row(i); }
+
+    Span<double> row(int i) {
+      return Span<double>(this->data() + (std::size_t)i*this->cols_, this->cols_);
+    }
+    Span<const double> row(int i) const {
+      return Span<const double>(this->data() + (std::size_t)i*this->cols_,
+                                this->cols_);
+    }
+
+    // Columns are strided views; use Transposed() when a loop walks many of
+    // them and needs them contiguous.
+    Span<double> column(int j) {
+      return Span<double>(this->data() + j, this->rows_, this->cols_);
+    }
+    Span<const double> column(int j) const {
+      return Span<const double>(this->data() + j, this->rows_, this->cols_);
+    }
+
+    MatrixView view() const {
+      return MatrixView(this->data(), this->rows_, this->cols_);
+    }
+    operator MatrixView() const { return this->view(); }
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Resizes the matrix to [rows] x [cols] and fills it with [value].
+    // ----------------------------------------------------------------------------
+    void assign(int rows, int cols, double value=0);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Returns a new matrix with rows and columns swapped, i.e. this
+    ///         matrix stored in column-major order.
+    // ----------------------------------------------------------------------------
+    Matrix Transposed() const;
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Copies the matrix into a vector of rows.
+    // ----------------------------------------------------------------------------
+    std::vector<std::vector<double> > to_vectors() const;
+
+    bool operator==(const Matrix& o) const {
+      return this->rows_ == o.rows_ && this->cols_ == o.cols_ &&
+             this->data_ == o.data_;
+    }
+    bool operator!=(const Matrix& o) const { return !(*this == o); }
+
+  private:
+    std::vector<double> data_;
+    int rows_, cols_;
+};
+
+} // namespace base
+
+#endif
@@ -0,0 +1,35 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+namespace base {
+  // Calls fn over contiguous chunks of [begin, end), in parallel.
+  void ParallelFor(int begin, int end, int threads,
+                   const std::function<void(int, int)>& fn, int grain) {
+    if(end <= begin) return;
+    grain = std::max(grain, 1);
+    int blocks = (end - begin + grain - 1) / grain;
+    threads = std::min(threads, blocks);
+    if(threads < 2) {
+      fn(begin, end);
+      return;
+    }
+
+    // The first (blocks % threads) chunks get one extra block.
+    std::vector<int> bounds(threads + 1, begin);
+    for(int t = 0; t < threads; t++) {
+      int size = blocks / threads + (t < blocks % threads ? 1 : 0);
+      bounds[t+1] = std::min(end, bounds[t] + size*grain);
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for(int t = 1; t < threads; t++)
+      workers.emplace_back(fn, bounds[t], bounds[t+1]);
+    fn(bounds[0], bounds[1]);
+    for(std::thread& worker : workers)
+      worker.join();
+  }
+}
@@ -0,0 +1,26 @@
+#ifndef _base_parallel_h
+#define _base_parallel_h
+#include <functional>
+
+namespace base {
+
+// ----------------------------------------------------------------------------
+/// @Brief  Splits [begin, end) in at most [threads] contiguous chunks and
+///         calls fn(chunk_begin, chunk_end) for each one of them, in
+///         parallel. The calling thread runs the first chunk, and the
+///         function returns once every chunk is done.
+///
+/// @Param begin The first index of the range.
+/// @Param end One past the last index of the range.
+/// @Param threads The number of threads. Values below 2 run fn(begin, end)
+///                on the calling thread.
+/// @Param fn The function that processes a chunk.
+/// @Param grain Every chunk boundary is a multiple of [grain] away from
+///              [begin], so kernels can keep their blocks whole.
+// ----------------------------------------------------------------------------
+void ParallelFor(int begin, int end, int threads,
+                 const std::function<void(int, int)>& fn, int grain=1);
+
+} // namespace base
+
+#endif
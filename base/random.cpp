@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <random>
+
+#include "random.h"
+#include "vmath.h"
+
+namespace base {
+  namespace {
+    uint64_t SplitMix64(uint64_t* x) {
+      uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+
+    // The global seed of ThreadRng. A thread whose generator is from an
+    // older generation takes the next unused stream of the current seed.
+    std::mutex seed_mutex;
+    bool seed_ready = false;
+    uint64_t global_seed = 0;
+    int next_stream = 0;
+    std::atomic<int> generation(0);
+
+    struct ThreadState {
+      Rng rng;
+      int generation = -1;
+    };
+    thread_local ThreadState thread_state;
+
+    // Gamma(alpha, 1), by Marsaglia and Tsang's method, for alpha != 1.
+    double Gamma(Rng& rng, double alpha) {
+      if(alpha < 1) {
+        // Gamma(alpha) = Gamma(alpha + 1) * U^(1 / alpha).
+        double u = 1 - rng.Uniform();
+        return Gamma(rng, alpha + 1) * std::pow(u, 1 / alpha);
+      }
+      const double d = alpha - 1.0 / 3, c = 1 / std::sqrt(9 * d);
+      while(true) {
+        // A standard normal, by the polar method.
+        double a, b, s;
+        do {
+          a = 2 * rng.Uniform() - 1;
+          b = 2 * rng.Uniform() - 1;
+          s = a*a + b*b;
+        } while(s >= 1 || s == 0);
+        double x = a * std::sqrt(-2 * std::log(s) / s);
+
+        double v = 1 + c*x;
+        if(v <= 0) continue;
+        v = v*v*v;
+        double u = 1 - rng.Uniform();
+        if(u < 1 - 0.0331 * x*x*x*x ||
+           std::log(u) < 0.5*x*x + d*(1 - v + std::log(v)))
+          return d * v;
+      }
+    }
+
+    // Scales [n] non-negative weights to sum one. All zero weights, which
+    // the samplers give with negligible probability, become uniform.
+    void Normalize(double* weights, int n) {
+      double sum = 0;
+      for(int i = 0; i < n; i++) sum += weights[i];
+      for(int i = 0; i < n; i++)
+        weights[i] = (sum > 0) ? weights[i] / sum : 1.0 / n;
+    }
+
+    // Fills [out] with [n] independent Gamma(alpha, 1) values. With alpha
+    // = 1 they are exponential, -log(U), and the logarithms are taken
+    // all at once.
+    void GammaWeights(Rng& rng, double* out, long long n, double alpha) {
+      if(alpha != 1) {
+        for(long long i = 0; i < n; i++) out[i] = Gamma(rng, alpha);
+        return;
+      }
+      for(long long i = 0; i < n; i++) out[i] = 1 - rng.Uniform();
+      // base::Log takes int sizes, so huge matrices go in pieces.
+      const long long kPiece = 1 << 20;
+      for(long long i = 0; i < n; i += kPiece) {
+        int size = (int)std::min(kPiece, n - i);
+        Log(out + i, out + i, size);
+      }
+      for(long long i = 0; i < n; i++) out[i] = -out[i];
+    }
+  }
+
+  Rng::Rng(uint64_t seed) {
+    for(int i = 0; i < 4; i++)
+      this->s_[i] = SplitMix64(&seed);
+  }
+
+  Rng Rng::Stream(uint64_t seed, int index) {
+    Rng rng(seed);
+    for(int i = 0; i < index; i++) rng.Jump();
+    return rng;
+  }
+
+  // Lemire's method: the high half of x * range, rejecting the few values
+  // of x that would make some results more likely.
+  long long Rng::UniformInt(long long lo, long long hi) {
+    const uint64_t range = (uint64_t)hi - (uint64_t)lo + 1;
+    if(range == 0) return (long long)(*this)();
+    unsigned __int128 m = (unsigned __int128)(*this)() * range;
+    uint64_t low = (uint64_t)m;
+    if(low < range) {
+      const uint64_t threshold = -range % range;
+      while(low < threshold) {
+        m = (unsigned __int128)(*this)() * range;
+        low = (uint64_t)m;
+      }
+    }
+    return (long long)((uint64_t)lo + (uint64_t)(m >> 64));
+  }
+
+  // The jump polynomial of the reference implementation.
+  void Rng::Jump() {
+    static const uint64_t kJump[] = {
+      0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+      0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+    uint64_t s[4] = {0, 0, 0, 0};
+    for(uint64_t jump : kJump) {
+      for(int b = 0; b < 64; b++) {
+        if(jump & (1ULL << b))
+          for(int i = 0; i < 4; i++) s[i] ^= this->s_[i];
+        (*this)();
+      }
+    }
+    for(int i = 0; i < 4; i++) this->s_[i] = s[i];
+  }
+
+  // Hands out the next stream when the thread's one is stale.
+  Rng& ThreadRng() {
+    ThreadState& state = thread_state;
+    if(state.generation != generation.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(seed_mutex);
+      if(!seed_ready) {
+        global_seed = ((uint64_t)std::random_device()() << 32) ^
+                      std::random_device()();
+        seed_ready = true;
+      }
+      state.rng = Rng::Stream(global_seed, next_stream++);
+      state.generation = generation.load();
+    }
+    return state.rng;
+  }
+
+  void SeedThreadRngs(uint64_t seed) {
+    std::lock_guard<std::mutex> lock(seed_mutex);
+    global_seed = seed;
+    seed_ready = true;
+    next_stream = 1;
+    thread_state.rng = Rng::Stream(seed, 0);
+    thread_state.generation = ++generation;
+  }
+
+  void RandomDistribution(Rng& rng, double* out, int n, double alpha) {
+    GammaWeights(rng, out, n, alpha);
+    Normalize(out, n);
+  }
+
+  // Draws the weights of every row at once, then normalizes each row.
+  Matrix RandomStochasticMatrix(Rng& rng, int rows, int cols, double alpha) {
+    Matrix matrix(rows, cols);
+    GammaWeights(rng, matrix.data(), (long long)rows * cols, alpha);
+    for(int i = 0; i < rows; i++)
+      Normalize(matrix.row(i).data(), cols);
+    return matrix;
+  }
+}
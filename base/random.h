@@ -0,0 +1,112 @@
+#ifndef _base_random_h
+#define _base_random_h
+#include <cstdint>
+
+#include "matrix.h"
+
+namespace base {
+
+// ----------------------------------------------------------------------------
+/// @Brief  xoshiro256**, a small and fast generator of 64-bit values with
+///         a period of 2^256 - 1. It meets the UniformRandomBitGenerator
+///         requirements, so it also works with the std distributions.
+///
+///         Unlike std::random_device, seeding it costs nothing, and the
+///         same seed always gives the same values on every platform.
+///         A generator must not be shared between threads; use one per
+///         thread, see Stream and ThreadRng.
+// ----------------------------------------------------------------------------
+class Rng {
+  public:
+    typedef uint64_t result_type;
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Fills the state from [seed] with splitmix64, so nearby seeds
+    ///         give unrelated sequences.
+    // ----------------------------------------------------------------------------
+    explicit Rng(uint64_t seed=0);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  The generator for stream [index] of [seed]: the one of [seed]
+    ///         advanced by index * 2^128 values. Different streams of a seed
+    ///         never overlap, so every thread or work item can have its own,
+    ///         and a run is reproducible however the work is scheduled.
+    // ----------------------------------------------------------------------------
+    static Rng Stream(uint64_t seed, int index);
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+      const uint64_t result = Rotl(this->s_[1] * 5, 7) * 9;
+      const uint64_t t = this->s_[1] << 17;
+      this->s_[2] ^= this->s_[0];
+      this->s_[3] ^= this->s_[1];
+      this->s_[1] ^= this->s_[2];
+      this->s_[0] ^= this->s_[3];
+      this->s_[2] ^= t;
+      this->s_[3] = Rotl(this->s_[3], 45);
+      return result;
+    }
+
+    // A double in [0, 1), with 53 random bits.
+    double Uniform() {
+      return ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // --------------------------------------------------------------------------
+    /// @Brief  An integer in [lo, hi], every value equally likely.
+    // ----------------------------------------------------------------------------
+    long long UniformInt(long long lo, long long hi);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Advances the generator by 2^128 values.
+    // ----------------------------------------------------------------------------
+    void Jump();
+
+  private:
+    static uint64_t Rotl(uint64_t x, int k) {
+      return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t s_[4];
+};
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  The generator of the calling thread. Each thread gets its own
+///         stream of the global seed the first time it asks, so threads
+///         never share state. Until SeedThreadRngs is called the global
+///         seed comes from std::random_device, read once per process.
+// ----------------------------------------------------------------------------
+Rng& ThreadRng();
+
+// ----------------------------------------------------------------------------
+/// @Brief  Sets the global seed, and restarts the generator of the calling
+///         thread at stream 0 of it. Other threads restart at a new stream
+///         the next time they call ThreadRng. A single-threaded program is
+///         then reproducible; a multithreaded one should give each work
+///         item its own Rng::Stream instead.
+// ----------------------------------------------------------------------------
+void SeedThreadRngs(uint64_t seed);
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  Fills [out] with a random distribution over [n] elements,
+///         drawn from the symmetric Dirichlet distribution with parameter
+///         [alpha]. alpha = 1 is the uniform distribution on the simplex;
+///         smaller values give sparser distributions and larger ones
+///         distributions closer to uniform.
+// ----------------------------------------------------------------------------
+void RandomDistribution(Rng& rng, double* out, int n, double alpha=1);
+
+// ----------------------------------------------------------------------------
+/// @Brief  A rows x cols row-stochastic matrix, with every row drawn as in
+///         RandomDistribution. With alpha = 1 the logarithms of a whole
+///         matrix are taken at once, with base::Log.
+// ----------------------------------------------------------------------------
+Matrix RandomStochasticMatrix(Rng& rng, int rows, int cols, double alpha=1);
+
+} // namespace base
+
+#endif
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+
+#include "simplex.h"
+
+namespace base {
+  namespace {
+    // Entries below this are treated as zero.
+    const double kEps = 1e-9;
+
+    // Non-improving pivots after which Bland's rule takes over.
+    const int kStallLimit = 50;
+
+    // A simplex tableau with [m] constraint rows, [n] columns and the
+    // right-hand side in column n. Row m holds the reduced costs of the
+    // objective being maximized, and minus its current value in column n.
+    class Tableau {
+      public:
+        Tableau(int m, int n)
+          : m_(m), n_(n), t_((std::size_t)(m+1)*(n+1), 0), basis_(m, -1) {}
+
+        double& at(int i, int j) { return this->t_[(std::size_t)i*(this->n_+1) + j]; }
+        double* row(int i) { return &this->at(i, 0); }
+        double& rhs(int i) { return this->at(i, this->n_); }
+        int& basis(int i) { return this->basis_[i]; }
+
+        double objective() { return -this->rhs(this->m_); }
+
+        // Makes column c basic in row r.
+        void Pivot(int r, int c) {
+          const int w = this->n_ + 1;
+          double* p = this->row(r);
+          const double inv = 1.0 / p[c];
+          for(int j = 0; j < w; j++) p[j] *= inv;
+          p[c] = 1;
+          for(int i = 0; i <= this->m_; i++) {
+            if(i == r) continue;
+            double* q = this->row(i);
+            const double f = q[c];
+            if(f == 0) continue;
+            for(int j = 0; j < w; j++) q[j] -= f * p[j];
+            q[c] = 0;
+          }
+          this->basis_[r] = c;
+        }
+
+        // Pivots until no allowed column improves the objective.
+        LpStatus Optimize(const std::vector<bool>& allowed, int max_iterations) {
+          double last = this->objective();
+          int stalled = 0;
+          for(int it = 0; it < max_iterations; it++) {
+            const bool bland = stalled >= kStallLimit;
+            const double* cost = this->row(this->m_);
+            int c = -1;
+            for(int j = 0; j < this->n_; j++) {
+              if(!allowed[j] || cost[j] <= kEps) continue;
+              if(c < 0 || (!bland && cost[j] > cost[c])) c = j;
+              if(bland) break;
+            }
+            if(c < 0) return LpStatus::kOptimal;
+
+            // Ratio test, ties broken by the smallest basic column.
+            int r = -1;
+            double best = 0;
+            for(int i = 0; i < this->m_; i++) {
+              const double a = this->at(i, c);
+              if(a <= kEps) continue;
+              const double ratio = this->rhs(i) / a;
+              if(r < 0 || ratio < best - kEps ||
+                 (ratio <= best + kEps && this->basis_[i] < this->basis_[r])) {
+                r = i;
+                best = ratio;
+              }
+            }
+            if(r < 0) return LpStatus::kUnbounded;
+            this->Pivot(r, c);
+
+            const double now = this->objective();
+            stalled = (now > last + kEps) ? 0 : stalled + 1;
+            last = std::max(last, now);
+          }
+          return LpStatus::kIterationLimit;
+        }
+
+      private:
+        int m_, n_;
+        std::vector<double> t_;
+        std::vector<int> basis_;
+    };
+  }
+
+  LinearProgram::LinearProgram(int n_vars)
+    : n_vars_(n_vars), c_(n_vars, 0) {}
+
+  void LinearProgram::SetObjective(const std::vector<double>& c) {
+    this->c_ = c;
+    this->c_.resize(this->n_vars_, 0);
+  }
+
+  void LinearProgram::AddLessEqual(const std::vector<double>& a, double b) {
+    this->rows_.push_back(Row{a, b, Sense::kLess});
+    this->rows_.back().a.resize(this->n_vars_, 0);
+  }
+
+  void LinearProgram::AddGreaterEqual(const std::vector<double>& a, double b) {
+    this->rows_.push_back(Row{a, b, Sense::kGreater});
+    this->rows_.back().a.resize(this->n_vars_, 0);
+  }
+
+  void LinearProgram::AddEqual(const std::vector<double>& a, double b) {
+    this->rows_.push_back(Row{a, b, Sense::kEqual});
+    this->rows_.back().a.resize(this->n_vars_, 0);
+  }
+
+  // Two-phase simplex. Phase one drives the artificial variables of the
+  // >= and = rows to zero, phase two optimizes the real objective.
+  LpResult LinearProgram::Maximize(int max_iterations) const {
+    const int n = this->n_vars_, m = this->rows_.size();
+
+    // Every right-hand side is made non-negative, flipping the row.
+    std::vector<Row> rows(this->rows_);
+    int n_slack = 0, n_artificial = 0;
+    for(Row& row : rows) {
+      if(row.b < 0) {
+        for(double& a : row.a) a = -a;
+        row.b = -row.b;
+        if(row.sense == Sense::kLess) row.sense = Sense::kGreater;
+        else if(row.sense == Sense::kGreater) row.sense = Sense::kLess;
+      }
+      if(row.sense != Sense::kEqual) n_slack++;
+      if(row.sense != Sense::kLess) n_artificial++;
+    }
+
+    // Columns: variables, then slacks, then artificials.
+    const int first_artificial = n + n_slack;
+    const int cols = first_artificial + n_artificial;
+    Tableau t(m, cols);
+    int slack = n, artificial = first_artificial;
+    for(int i = 0; i < m; i++) {
+      std::copy(rows[i].a.begin(), rows[i].a.end(), t.row(i));
+      t.rhs(i) = rows[i].b;
+      if(rows[i].sense == Sense::kLess) {
+        t.at(i, slack) = 1;
+        t.basis(i) = slack++;
+      } else {
+        if(rows[i].sense == Sense::kGreater) t.at(i, slack++) = -1;
+        t.at(i, artificial) = 1;
+        t.basis(i) = artificial++;
+      }
+    }
+
+    LpResult result;
+    result.objective = 0;
+    result.x.assign(n, 0);
+    std::vector<bool> allowed(cols, true);
+
+    // Phase one: maximize -(sum of artificials), priced out of the basis.
+    if(n_artificial > 0) {
+      double* cost = t.row(m);
+      for(int i = 0; i < m; i++) {
+        if(t.basis(i) < first_artificial) continue;
+        const double* r = t.row(i);
+        for(int j = 0; j <= cols; j++) cost[j] += r[j];
+      }
+      for(int j = first_artificial; j < cols; j++) cost[j] = 0;
+
+      LpStatus status = t.Optimize(allowed, max_iterations);
+      if(status == LpStatus::kIterationLimit) {
+        result.status = status;
+        return result;
+      }
+      if(t.objective() < -kEps * std::max(1.0, (double)m)) {
+        result.status = LpStatus::kInfeasible;
+        return result;
+      }
+
+      // Artificials left in the basis are at zero. Swap them for any
+      // other column; rows where none is left are redundant.
+      for(int i = 0; i < m; i++) {
+        if(t.basis(i) < first_artificial) continue;
+        for(int j = 0; j < first_artificial; j++) {
+          if(std::fabs(t.at(i, j)) > kEps) {
+            t.Pivot(i, j);
+            break;
+          }
+        }
+      }
+      for(int j = first_artificial; j < cols; j++) allowed[j] = false;
+    }
+
+    // Phase two: the real objective, priced out of the basis.
+    double* cost = t.row(m);
+    std::fill(cost, cost + cols + 1, 0);
+    std::copy(this->c_.begin(), this->c_.end(), cost);
+    for(int i = 0; i < m; i++) {
+      const int b = t.basis(i);
+      if(b >= n || this->c_[b] == 0) continue;
+      const double f = this->c_[b];
+      const double* r = t.row(i);
+      for(int j = 0; j <= cols; j++) cost[j] -= f * r[j];
+    }
+
+    result.status = t.Optimize(allowed, max_iterations);
+    for(int i = 0; i < m; i++) {
+      if(t.basis(i) < n) result.x[t.basis(i)] = t.rhs(i);
+    }
+    result.objective = 0;
+    for(int j = 0; j < n; j++) result.objective += this->c_[j] * result.x[j];
+    return result;
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef _base_simplex_h
+#define _base_simplex_h
+#include <vector>
+
+namespace base {
+
+enum class LpStatus {
+  kOptimal = 0,
+  kInfeasible = 1,
+  kUnbounded = 2,
+  kIterationLimit = 3,
+};
+
+struct LpResult {
+  LpStatus status;
+  // The value of the objective at x. Only meaningful when optimal.
+  double objective;
+  // The solution, one value per variable.
+  std::vector<double> x;
+};
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  A small dense linear program,
+///             maximize c.x  subject to  a_i.x (<=, >=, =) b_i,  x >= 0,
+///         solved with the two-phase simplex method over a full tableau.
+///         It is meant for the programs built by the capacity solvers,
+///         with up to a few hundred variables and constraints.
+// ----------------------------------------------------------------------------
+class LinearProgram {
+  public:
+    explicit LinearProgram(int n_vars);
+
+    int n_vars() const { return this->n_vars_; }
+    int n_constraints() const { return this->rows_.size(); }
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Sets c, the vector of [n_vars] objective coefficients.
+    // ----------------------------------------------------------------------------
+    void SetObjective(const std::vector<double>& c);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Adds the constraint a.x <= b, a.x >= b or a.x = b. [a] has one
+    ///         coefficient per variable.
+    // ----------------------------------------------------------------------------
+    void AddLessEqual(const std::vector<double>& a, double b);
+    void AddGreaterEqual(const std::vector<double>& a, double b);
+    void AddEqual(const std::vector<double>& a, double b);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Solves the program. Pivots follow Dantzig's rule, and switch
+    ///         to Bland's rule, which cannot cycle, after a run of steps
+    ///         that do not improve the objective.
+    ///
+    /// @Param max_iterations The pivot budget of each phase.
+    // ----------------------------------------------------------------------------
+    LpResult Maximize(int max_iterations=100000) const;
+
+  private:
+    enum class Sense { kLess, kGreater, kEqual };
+    struct Row {
+      std::vector<double> a;
+      double b;
+      Sense sense;
+    };
+
+    int n_vars_;
+    std::vector<double> c_;
+    std::vector<Row> rows_;
+};
+
+} // namespace base
+
+#endif
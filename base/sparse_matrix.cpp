@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include "sparse_matrix.h"
+
+namespace base {
+  // Copies the nonzero entries of m, row by row.
+  SparseMatrix SparseMatrix::FromDense(const MatrixView& m) {
+    SparseMatrix s(m.cols());
+    s.reserve(CountNonzeros(m));
+    for(int i = 0; i < m.rows(); i++) {
+      const double* row = m.row(i).data();
+      for(int j = 0; j < m.cols(); j++)
+        if(row[j] != 0) s.Add(j, row[j]);
+      s.EndRow();
+    }
+    return s;
+  }
+
+  std::size_t SparseMatrix::CountNonzeros(const MatrixView& m) {
+    std::size_t count = 0;
+    for(int i = 0; i < m.rows(); i++) {
+      const double* row = m.row(i).data();
+      for(int j = 0; j < m.cols(); j++)
+        count += (row[j] != 0);
+    }
+    return count;
+  }
+
+  // Sorts the entries of the last row, sums the repeated columns and
+  // drops the zeros.
+  void SparseMatrix::EndRow() {
+    const std::size_t begin = this->row_start_.back();
+    bool sorted = true;
+    for(std::size_t k = begin + 1; k < this->col_.size(); k++) {
+      if(this->col_[k] <= this->col_[k-1]) {
+        sorted = false;
+        break;
+      }
+    }
+    if(!sorted) {
+      // A stable sort keeps the repeated columns in the order they were
+      // added, so they are summed in that order.
+      this->pending_.clear();
+      for(std::size_t k = begin; k < this->col_.size(); k++)
+        this->pending_.emplace_back(this->col_[k], this->value_[k]);
+      std::stable_sort(this->pending_.begin(), this->pending_.end(),
+                       [](const std::pair<int, double>& a,
+                          const std::pair<int, double>& b) {
+                         return a.first < b.first;
+                       });
+      this->col_.resize(begin);
+      this->value_.resize(begin);
+      for(const std::pair<int, double>& entry : this->pending_) {
+        if(this->col_.size() > begin && this->col_.back() == entry.first)
+          this->value_.back() += entry.second;
+        else
+          this->Add(entry.first, entry.second);
+      }
+    }
+
+    std::size_t end = begin;
+    for(std::size_t k = begin; k < this->col_.size(); k++) {
+      if(this->value_[k] != 0) {
+        this->col_[end] = this->col_[k];
+        this->value_[end] = this->value_[k];
+        end++;
+      }
+    }
+    this->col_.resize(end);
+    this->value_.resize(end);
+    this->row_start_.push_back(end);
+    this->rows_++;
+  }
+
+  Matrix SparseMatrix::ToDense() const {
+    Matrix m(this->rows_, this->cols_);
+    for(int i = 0; i < this->rows_; i++) {
+      SparseRow r = this->row(i);
+      double* row = m.row(i).data();
+      for(int k = 0; k < r.size; k++)
+        row[r.col[k]] = r.value[k];
+    }
+    return m;
+  }
+
+  // A counting sort of the entries by column; the rows come out in order.
+  SparseMatrix SparseMatrix::Transposed() const {
+    SparseMatrix t(this->rows_);
+    t.rows_ = this->cols_;
+    t.row_start_.assign(this->cols_ + 1, 0);
+    for(int j : this->col_)
+      t.row_start_[j + 1]++;
+    for(int j = 0; j < this->cols_; j++)
+      t.row_start_[j + 1] += t.row_start_[j];
+
+    t.col_.resize(this->nonzeros());
+    t.value_.resize(this->nonzeros());
+    std::vector<std::size_t> next(t.row_start_.begin(), t.row_start_.end() - 1);
+    for(int i = 0; i < this->rows_; i++) {
+      SparseRow r = this->row(i);
+      for(int k = 0; k < r.size; k++) {
+        const std::size_t at = next[r.col[k]]++;
+        t.col_[at] = i;
+        t.value_[at] = r.value[k];
+      }
+    }
+    return t;
+  }
+
+  // Gustavson's algorithm, with a dense accumulator over the columns of b
+  // that is only cleared where it was used.
+  SparseMatrix Multiply(const SparseMatrix& a, const SparseMatrix& b) {
+    SparseMatrix c(b.cols());
+    std::vector<double> sum(b.cols(), 0);
+    std::vector<bool> used(b.cols(), false);
+    std::vector<int> columns;
+    for(int i = 0; i < a.rows(); i++) {
+      SparseRow a_i = a.row(i);
+      columns.clear();
+      for(int k = 0; k < a_i.size; k++) {
+        SparseRow b_k = b.row(a_i.col[k]);
+        const double a_ik = a_i.value[k];
+        for(int l = 0; l < b_k.size; l++) {
+          const int j = b_k.col[l];
+          if(!used[j]) {
+            used[j] = true;
+            columns.push_back(j);
+          }
+          sum[j] += a_ik * b_k.value[l];
+        }
+      }
+      std::sort(columns.begin(), columns.end());
+      for(int j : columns) {
+        c.Add(j, sum[j]);
+        sum[j] = 0;
+        used[j] = false;
+      }
+      c.EndRow();
+    }
+    return c;
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef _base_sparse_matrix_h
+#define _base_sparse_matrix_h
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+
+namespace base {
+
+// ----------------------------------------------------------------------------
+/// @Brief  The nonzero entries of one row of a SparseMatrix, sorted by
+///         column: value[k] is the entry at column col[k].
+// ----------------------------------------------------------------------------
+struct SparseRow {
+  const int* col;
+  const double* value;
+  int size;
+};
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  A matrix of doubles in compressed sparse row (CSR) form: only the
+///         nonzero entries are stored, row after row, each row sorted by
+///         column. Loops over a SparseMatrix take time proportional to the
+///         nonzeros rather than to rows x cols.
+///
+///         The transpose of a matrix in CSR form is the same matrix in
+///         compressed sparse column (CSC) form, so Transposed() is what a
+///         loop over columns uses.
+///
+///         A matrix is built one row at a time: Add the entries of the row,
+///         in any order, then EndRow. Entries added twice to the same column
+///         are summed, and zeros are dropped.
+// ----------------------------------------------------------------------------
+class SparseMatrix {
+  public:
+    SparseMatrix() : rows_(0), cols_(0), row_start_(1, 0) {}
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Creates a matrix with [cols] columns and no rows yet.
+    // ----------------------------------------------------------------------------
+    explicit SparseMatrix(int cols) : rows_(0), cols_(cols), row_start_(1, 0) {}
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Copies the nonzero entries of a dense matrix.
+    // ----------------------------------------------------------------------------
+    static SparseMatrix FromDense(const MatrixView& m);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Counts the nonzero entries of a dense matrix.
+    // ----------------------------------------------------------------------------
+    static std::size_t CountNonzeros(const MatrixView& m);
+
+    int rows() const { return this->rows_; }
+    int cols() const { return this->cols_; }
+    std::size_t nonzeros() const { return this->value_.size(); }
+
+    // The share of the entries that are stored, in [0, 1].
+    double density() const {
+      const double size = (double)this->rows_ * this->cols_;
+      return size == 0 ? 0 : this->nonzeros() / size;
+    }
+
+    SparseRow row(int i) const {
+      const std::size_t begin = this->row_start_[i];
+      return SparseRow{this->col_.data() + begin, this->value_.data() + begin,
+                       (int)(this->row_start_[i+1] - begin)};
+    }
+
+    // Reserves room for [nonzeros] entries in all.
+    void reserve(std::size_t nonzeros) {
+      this->col_.reserve(nonzeros);
+      this->value_.reserve(nonzeros);
+    }
+
+    // Adds [value] at column [j] of the row being built.
+    void Add(int j, double value) {
+      this->col_.push_back(j);
+      this->value_.push_back(value);
+    }
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Ends the row being built, sorting its entries by column.
+    ///         Rows added in column order, with no repeated columns, are
+    ///         kept as they are.
+    // ----------------------------------------------------------------------------
+    void EndRow();
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Returns the rows x cols dense matrix.
+    // ----------------------------------------------------------------------------
+    Matrix ToDense() const;
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Returns the transpose, i.e. this matrix in CSC form.
+    // ----------------------------------------------------------------------------
+    SparseMatrix Transposed() const;
+
+  private:
+    int rows_, cols_;
+    // Row i is at [row_start_[i], row_start_[i+1]) of col_ and value_.
+    std::vector<std::size_t> row_start_;
+    std::vector<int> col_;
+    std::vector<double> value_;
+
+    // Scratch space of EndRow, for rows added out of order.
+    std::vector<std::pair<int, double> > pending_;
+};
+
+
+// ----------------------------------------------------------------------------
+/// @Brief  Computes the product C = A * B of two sparse matrices, row by row
+///         (Gustavson's algorithm): row i of C is the sum of the rows k of
+///         B, scaled by A(i, k). The work is proportional to the products
+///         of nonzeros that are actually multiplied, plus cols of B once.
+///
+///         Every C(i, j) is accumulated in the order k = 0, 1, ..., as in
+///         the textbook triple loop, but skipping the zero terms.
+// ----------------------------------------------------------------------------
+SparseMatrix Multiply(const SparseMatrix& a, const SparseMatrix& b);
+
+} // namespace base
+
+#endif
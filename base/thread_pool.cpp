@@ -0,0 +1,126 @@
+#include <algorithm>
+
+#include "thread_pool.h"
+
+namespace base {
+  namespace {
+    // The pool and index of the worker running on this thread, if any.
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local int current_index = -1;
+  }
+
+  // Starts the workers, each with its own queue.
+  ThreadPool::ThreadPool(int threads)
+    : queued_(0), pending_(0), next_queue_(0) {
+    if(threads < 1)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    for(int t = 0; t < threads; t++)
+      this->queues_.emplace_back(new Queue());
+    this->workers_.reserve(threads);
+    for(int t = 0; t < threads; t++)
+      this->workers_.emplace_back(&ThreadPool::WorkerLoop, this, t);
+  }
+
+  // Drains the queues and joins the workers.
+  ThreadPool::~ThreadPool() {
+    this->Wait();
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->stop_ = true;
+    }
+    this->work_ready_.notify_all();
+    for(std::thread& worker : this->workers_)
+      worker.join();
+  }
+
+  int ThreadPool::CurrentWorker() const {
+    return current_pool == this ? current_index : -1;
+  }
+
+  // Queues a task on the calling worker, or round robin from outside.
+  void ThreadPool::Submit(std::function<void()> task) {
+    int index = this->CurrentWorker();
+    if(index < 0) index = this->next_queue_++ % this->queues_.size();
+    this->pending_++;
+    {
+      Queue& queue = *this->queues_[index];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->queued_++;
+    }
+    this->work_ready_.notify_one();
+  }
+
+  // Blocks until no task is queued or running.
+  void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    this->all_done_.wait(lock, [this] { return this->pending_ == 0; });
+  }
+
+  // Runs fn over [begin, end), splitting it in halves as tasks.
+  void ThreadPool::ParallelFor(int begin, int end,
+                               const std::function<void(int, int)>& fn,
+                               int grain) {
+    if(end <= begin) return;
+    grain = std::max(grain, 1);
+
+    // Keeps the left half and queues the right one, until a single
+    // chunk is left. The queued halves are what the other workers steal.
+    std::function<void(int, int)> run = [&](int b, int e) {
+      while(e - b > grain) {
+        int blocks = (e - b + grain - 1) / grain;
+        int mid = b + (blocks / 2) * grain;
+        this->Submit([&run, mid, e] { run(mid, e); });
+        e = mid;
+      }
+      fn(b, e);
+    };
+    this->Submit([&run, begin, end] { run(begin, end); });
+    this->Wait();
+  }
+
+  // Own queue from the back, other queues from the front.
+  bool ThreadPool::Take(int index, std::function<void()>* task) {
+    const int n = this->queues_.size();
+    for(int k = 0; k < n; k++) {
+      Queue& queue = *this->queues_[(index + k) % n];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if(queue.tasks.empty()) continue;
+      if(k == 0) {
+        *task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        *task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+      this->queued_--;
+      return true;
+    }
+    return false;
+  }
+
+  // Runs tasks until the pool stops.
+  void ThreadPool::WorkerLoop(int index) {
+    current_pool = this;
+    current_index = index;
+    while(true) {
+      std::function<void()> task;
+      if(this->Take(index, &task)) {
+        task();
+        if(--this->pending_ == 0) {
+          std::lock_guard<std::mutex> lock(this->mutex_);
+          this->all_done_.notify_all();
+        }
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(this->mutex_);
+      this->work_ready_.wait(lock, [this] {
+        return this->stop_ || this->queued_ > 0;
+      });
+      if(this->stop_ && this->queued_ <= 0) return;
+    }
+  }
+}
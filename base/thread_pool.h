@@ -0,0 +1,101 @@
+#ifndef _base_thread_pool_h
+#define _base_thread_pool_h
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// ----------------------------------------------------------------------------
+/// @Brief  A fixed set of worker threads that run submitted tasks. Unlike
+///         ParallelFor, the threads are started once and reused, so a
+///         long scan pays for them a single time.
+///
+///         Every worker has its own queue. Tasks submitted from a worker
+///         go to the back of its queue and are taken from there by it,
+///         most recent first, while idle workers steal from the front of
+///         the other queues, oldest first. So a task that splits its work
+///         keeps the pieces it is about to run hot in its own cache and
+///         hands the large, old ones to whoever is free.
+// ----------------------------------------------------------------------------
+class ThreadPool {
+  public:
+    // --------------------------------------------------------------------------
+    /// @Brief  Starts [threads] workers. Values below 1 start one worker per
+    ///         hardware thread.
+    // ----------------------------------------------------------------------------
+    explicit ThreadPool(int threads=0);
+
+    // Waits for the pending tasks, then stops the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return this->workers_.size(); }
+
+    // --------------------------------------------------------------------------
+    /// @Brief  The index, in [0, size()), of the worker of this pool that is
+    ///         running the calling thread, or -1 on any other thread. Meant
+    ///         to index per-worker results without locks.
+    // ----------------------------------------------------------------------------
+    int CurrentWorker() const;
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Queues [task] to run on some worker. Tasks may submit more
+    ///         tasks.
+    // ----------------------------------------------------------------------------
+    void Submit(std::function<void()> task);
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Blocks until every submitted task has finished, including the
+    ///         ones they submitted. Must not be called from inside a task.
+    // ----------------------------------------------------------------------------
+    void Wait();
+
+    // --------------------------------------------------------------------------
+    /// @Brief  Calls fn(chunk_begin, chunk_end) over chunks of [grain]
+    ///         indices of [begin, end), on the workers, and returns once all
+    ///         of them are done. The range is split in halves recursively,
+    ///         so idle workers steal the largest pieces left.
+    ///         Must not be called from inside a task of this pool.
+    // ----------------------------------------------------------------------------
+    void ParallelFor(int begin, int end,
+                     const std::function<void(int, int)>& fn, int grain=1);
+
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<std::function<void()> > tasks;
+    };
+
+    void WorkerLoop(int index);
+
+    // Takes a task, from the back of queue [index] or from the front of
+    // another one. Returns false if every queue is empty.
+    bool Take(int index, std::function<void()>* task);
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue> > queues_;
+
+    // Tasks queued, and tasks queued or running.
+    std::atomic<int> queued_;
+    std::atomic<int> pending_;
+    // Where the next task from outside the pool goes.
+    std::atomic<unsigned> next_queue_;
+
+    // Idle workers and Wait sleep on these.
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable all_done_;
+    bool stop_ = false;
+};
+
+} // namespace base
+
+#endif
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define QIF_X86_KERNELS 1
+#endif
+
+#include "cpu.h"
+#include "vmath.h"
+
+namespace base {
+  namespace {
+    const double kLn2Hi = 6.93147180369123816490e-01;
+    const double kLn2Lo = 1.90821492927058770002e-10;
+    const double kLog2e = 1.44269504088896338700e+00;
+    const double kSqrt2 = 1.41421356237309514547e+00;
+
+    // The smallest and largest normal doubles.
+    const double kMinNormal = 2.2250738585072014e-308;
+    const double kMaxNormal = 1.7976931348623157e+308;
+
+    // The range of Exp4, where 2^k and the result are normal numbers.
+    const double kExpMax = 709.0;
+    const double kExpMin = -708.0;
+
+    // i!, exact in a double up to 18!.
+    const double kFactorial[14] = {
+      1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880, 3628800, 39916800,
+      479001600, 6227020800.0};
+
+    void ScalarLog(const double* in, double* out, int n) {
+      for(int i = 0; i < n; i++) out[i] = std::log(in[i]);
+    }
+
+    void ScalarExp(const double* in, double* out, int n) {
+      for(int i = 0; i < n; i++) out[i] = std::exp(in[i]);
+    }
+
+    std::atomic<int> log_mode(static_cast<int>(LogMode::kExact));
+
+    // The kFast log2 of a normal x, with the reduction and the series of
+    // Log4, cut at f^7: the rest of the series of log2(m) is below
+    // 2/ln(2) * f^9/9 / (1 - f^2) < 4.3e-8.
+    double FastLog2(double x) {
+      uint64_t bits;
+      std::memcpy(&bits, &x, sizeof(bits));
+      double e = static_cast<double>(static_cast<int>(bits >> 52) - 1023);
+      bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+      double m;
+      std::memcpy(&m, &bits, sizeof(m));
+      if(m >= kSqrt2) {
+        m *= 0.5;
+        e += 1;
+      }
+      const double f = (m - 1) / (m + 1), f2 = f * f;
+      double p = 1.0/7;
+      for(int k = 5; k >= 1; k -= 2) p = p * f2 + 1.0/k;
+      return e + (f + f) * p * kLog2e;
+    }
+
+    double ScalarEntropy(const double* p, int n, double scale, bool fast) {
+      double entropy = 0;
+      for(int i = 0; i < n; i++) {
+        const double x = scale * p[i];
+        // A zero becomes 1, whose log2 is 0, so it adds 0 * 0.
+        const double safe = (x != 0) ? x : 1.0;
+        const bool normal = safe >= kMinNormal && safe <= kMaxNormal;
+        entropy -= x * ((fast && normal) ? FastLog2(safe) : std::log2(safe));
+      }
+      return entropy;
+    }
+
+#ifdef QIF_X86_KERNELS
+    // x = m * 2^e, with m in [sqrt(2)/2, sqrt(2)). Returns
+    // f = (m - 1) / (m + 1), |f| < 0.172, and sets [e].
+    __attribute__((target("avx2,fma")))
+    __m256d Reduce4(__m256d x, __m256d* e) {
+      const __m256i bits = _mm256_castpd_si256(x);
+      // The exponent, turned into a double with the 2^52 trick.
+      __m256i e_i = _mm256_srli_epi64(bits, 52);
+      *e = _mm256_sub_pd(
+          _mm256_castsi256_pd(_mm256_or_si256(
+              e_i, _mm256_castpd_si256(_mm256_set1_pd(4503599627370496.0)))),
+          _mm256_set1_pd(4503599627370496.0 + 1023));
+      __m256d m = _mm256_castsi256_pd(_mm256_or_si256(
+          _mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL)),
+          _mm256_set1_epi64x(0x3ff0000000000000LL)));
+      __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(kSqrt2), _CMP_GE_OQ);
+      m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+      *e = _mm256_add_pd(*e, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+
+      const __m256d one = _mm256_set1_pd(1.0);
+      return _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    }
+
+    // atanh(f) / f = sum_k f^2k / (2k + 1), summed up to f^(kLast - 1).
+    template <int kLast>
+    __attribute__((target("avx2,fma")))
+    __m256d AtanhSeries4(__m256d f) {
+      __m256d f2 = _mm256_mul_pd(f, f);
+      __m256d p = _mm256_set1_pd(1.0/kLast);
+      for(int k = kLast - 2; k >= 1; k -= 2)
+        p = _mm256_fmadd_pd(p, f2, _mm256_set1_pd(1.0/k));
+      return p;
+    }
+
+    // log(x) = e*ln(2) + log(m), with x = m * 2^e and m in [sqrt(2)/2, sqrt(2)).
+    // log(m) = 2 atanh(f), f = (m - 1) / (m + 1), |f| < 0.172, summed up to
+    // f^23, whose term is below 2^-60.
+    __attribute__((target("avx2,fma")))
+    __m256d Log4(__m256d x) {
+      __m256d e;
+      __m256d f = Reduce4(x, &e);
+      __m256d p = AtanhSeries4<23>(f);
+      // 2 f p is log(m); the exponent part is added with a split ln(2).
+      __m256d log_m = _mm256_mul_pd(_mm256_add_pd(f, f), p);
+      __m256d r = _mm256_fmadd_pd(e, _mm256_set1_pd(kLn2Lo), log_m);
+      return _mm256_fmadd_pd(e, _mm256_set1_pd(kLn2Hi), r);
+    }
+
+    // log2(x) = e + log(m) / ln(2), with the series of Log4, or in kFast
+    // mode the one of FastLog2.
+    template <bool kFast>
+    __attribute__((target("avx2,fma")))
+    __m256d Log2_4(__m256d x) {
+      __m256d e;
+      __m256d f = Reduce4(x, &e);
+      __m256d p = kFast ? AtanhSeries4<7>(f) : AtanhSeries4<23>(f);
+      __m256d log_m = _mm256_mul_pd(_mm256_add_pd(f, f), p);
+      return _mm256_fmadd_pd(log_m, _mm256_set1_pd(kLog2e), e);
+    }
+
+    template <bool kFast>
+    __attribute__((target("avx2,fma")))
+    double EntropyAvx2(const double* p, int n, double scale) {
+      const __m256d s = _mm256_set1_pd(scale);
+      const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+      const __m256d lo = _mm256_set1_pd(kMinNormal);
+      const __m256d hi = _mm256_set1_pd(kMaxNormal);
+      __m256d sum = zero;
+      double rest = 0;
+      int i = 0;
+      for(; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_mul_pd(s, _mm256_loadu_pd(p + i));
+        // The zeros become 1, whose log2 is 0.
+        __m256d safe = _mm256_blendv_pd(x, one, _mm256_cmp_pd(x, zero, _CMP_EQ_OQ));
+        __m256d normal = _mm256_and_pd(_mm256_cmp_pd(safe, lo, _CMP_GE_OQ),
+                                       _mm256_cmp_pd(safe, hi, _CMP_LE_OQ));
+        if(_mm256_movemask_pd(normal) != 0xf)
+          rest += ScalarEntropy(p + i, 4, scale, kFast);
+        else
+          sum = _mm256_fnmadd_pd(x, Log2_4<kFast>(safe), sum);
+      }
+      double lanes[4];
+      _mm256_storeu_pd(lanes, sum);
+      rest += ScalarEntropy(p + i, n - i, scale, kFast);
+      return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + rest;
+    }
+
+    // Reduce4, eight values at a time.
+    __attribute__((target("avx512f")))
+    __m512d Reduce8(__m512d x, __m512d* e) {
+      const __m512i bits = _mm512_castpd_si512(x);
+      __m512i e_i = _mm512_maskz_srli_epi64(0xff, bits, 52);
+      *e = _mm512_sub_pd(
+          _mm512_castsi512_pd(_mm512_or_si512(
+              e_i, _mm512_castpd_si512(_mm512_set1_pd(4503599627370496.0)))),
+          _mm512_set1_pd(4503599627370496.0 + 1023));
+      __m512d m = _mm512_castsi512_pd(_mm512_or_si512(
+          _mm512_and_si512(bits, _mm512_set1_epi64(0x000fffffffffffffLL)),
+          _mm512_set1_epi64(0x3ff0000000000000LL)));
+      __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(kSqrt2), _CMP_GE_OQ);
+      m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+      *e = _mm512_mask_add_pd(*e, big, *e, _mm512_set1_pd(1.0));
+
+      const __m512d one = _mm512_set1_pd(1.0);
+      return _mm512_div_pd(_mm512_sub_pd(m, one), _mm512_add_pd(m, one));
+    }
+
+    template <int kLast>
+    __attribute__((target("avx512f")))
+    __m512d AtanhSeries8(__m512d f) {
+      __m512d f2 = _mm512_mul_pd(f, f);
+      __m512d p = _mm512_set1_pd(1.0/kLast);
+      for(int k = kLast - 2; k >= 1; k -= 2)
+        p = _mm512_fmadd_pd(p, f2, _mm512_set1_pd(1.0/k));
+      return p;
+    }
+
+    template <bool kFast>
+    __attribute__((target("avx512f")))
+    __m512d Log2_8(__m512d x) {
+      __m512d e;
+      __m512d f = Reduce8(x, &e);
+      __m512d p = kFast ? AtanhSeries8<7>(f) : AtanhSeries8<23>(f);
+      __m512d log_m = _mm512_mul_pd(_mm512_add_pd(f, f), p);
+      return _mm512_fmadd_pd(log_m, _mm512_set1_pd(kLog2e), e);
+    }
+
+    // As EntropyAvx2; the last block is loaded with a mask, whose lanes
+    // outside [0, n) are zeros.
+    template <bool kFast>
+    __attribute__((target("avx512f")))
+    double EntropyAvx512(const double* p, int n, double scale) {
+      const __m512d s = _mm512_set1_pd(scale);
+      const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+      const __m512d lo = _mm512_set1_pd(kMinNormal);
+      const __m512d hi = _mm512_set1_pd(kMaxNormal);
+      __m512d sum = zero;
+      double rest = 0;
+      for(int i = 0; i < n; i += 8) {
+        const int count = std::min(8, n - i);
+        const __mmask8 in = static_cast<__mmask8>((1u << count) - 1);
+        __m512d x = _mm512_mul_pd(s, _mm512_maskz_loadu_pd(in, p + i));
+        __mmask8 nonzero = _mm512_cmp_pd_mask(x, zero, _CMP_NEQ_UQ);
+        __m512d safe = _mm512_mask_blend_pd(nonzero, one, x);
+        __mmask8 normal = _mm512_cmp_pd_mask(safe, lo, _CMP_GE_OQ) &
+                          _mm512_cmp_pd_mask(safe, hi, _CMP_LE_OQ);
+        if(normal != 0xff)
+          rest += ScalarEntropy(p + i, count, scale, kFast);
+        else
+          sum = _mm512_fnmadd_pd(x, Log2_8<kFast>(safe), sum);
+      }
+      double lanes[8];
+      _mm512_storeu_pd(lanes, sum);
+      return (((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+              ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]))) + rest;
+    }
+
+    // exp(x) = 2^k * exp(r), with k = round(x / ln(2)) and |r| <= ln(2)/2.
+    // exp(r) is its Taylor series up to r^13, whose remainder is below
+    // 2^-56 relative.
+    __attribute__((target("avx2,fma")))
+    __m256d Exp4(__m256d x) {
+      __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(kLog2e)),
+                                  _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(kLn2Hi), x);
+      r = _mm256_fnmadd_pd(k, _mm256_set1_pd(kLn2Lo), r);
+
+      __m256d p = _mm256_set1_pd(1.0/kFactorial[13]);
+      for(int i = 12; i >= 0; i--)
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/kFactorial[i]));
+
+      // 2^k, built in the exponent field with the 2^52 trick.
+      __m256d biased = _mm256_add_pd(k, _mm256_set1_pd(4503599627370496.0 + 1023));
+      __m256i two_k = _mm256_slli_epi64(_mm256_castpd_si256(biased), 52);
+      return _mm256_mul_pd(p, _mm256_castsi256_pd(two_k));
+    }
+
+    __attribute__((target("avx2,fma")))
+    void LogAvx2(const double* in, double* out, int n) {
+      const __m256d lo = _mm256_set1_pd(2.2250738585072014e-308);
+      const __m256d hi = _mm256_set1_pd(1.7976931348623157e+308);
+      int i = 0;
+      for(; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(in + i);
+        // Zero, subnormal, negative, infinite and NaN lanes fail this.
+        __m256d normal = _mm256_and_pd(_mm256_cmp_pd(x, lo, _CMP_GE_OQ),
+                                       _mm256_cmp_pd(x, hi, _CMP_LE_OQ));
+        if(_mm256_movemask_pd(normal) != 0xf) ScalarLog(in + i, out + i, 4);
+        else _mm256_storeu_pd(out + i, Log4(x));
+      }
+      ScalarLog(in + i, out + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void ExpAvx2(const double* in, double* out, int n) {
+      const __m256d lo = _mm256_set1_pd(kExpMin);
+      const __m256d hi = _mm256_set1_pd(kExpMax);
+      int i = 0;
+      for(; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(in + i);
+        __m256d inside = _mm256_and_pd(_mm256_cmp_pd(x, lo, _CMP_GE_OQ),
+                                       _mm256_cmp_pd(x, hi, _CMP_LE_OQ));
+        if(_mm256_movemask_pd(inside) != 0xf) ScalarExp(in + i, out + i, 4);
+        else _mm256_storeu_pd(out + i, Exp4(x));
+      }
+      ScalarExp(in + i, out + i, n - i);
+    }
+#endif
+  }
+
+  // out[i] = log(in[i])
+  void Log(const double* in, double* out, int n) {
+#ifdef QIF_X86_KERNELS
+    if(ActiveSimdLevel() >= SimdLevel::kAvx2) {
+      LogAvx2(in, out, n);
+      return;
+    }
+#endif
+    ScalarLog(in, out, n);
+  }
+
+  // out[i] = exp(in[i])
+  void Exp(const double* in, double* out, int n) {
+#ifdef QIF_X86_KERNELS
+    if(ActiveSimdLevel() >= SimdLevel::kAvx2) {
+      ExpAvx2(in, out, n);
+      return;
+    }
+#endif
+    ScalarExp(in, out, n);
+  }
+
+  // The mode of the Entropy calls that do not give one.
+  LogMode ActiveLogMode() {
+    return static_cast<LogMode>(log_mode.load(std::memory_order_relaxed));
+  }
+
+  void SetLogMode(LogMode mode) {
+    log_mode.store(static_cast<int>(mode), std::memory_order_relaxed);
+  }
+
+  // sum_i x_i log2(1 / x_i), x_i = scale * p[i] != 0
+  double Entropy(const double* p, int n, double scale) {
+    return Entropy(p, n, scale, ActiveLogMode());
+  }
+
+  double Entropy(const double* p, int n, double scale, LogMode mode) {
+    const bool fast = (mode == LogMode::kFast);
+#ifdef QIF_X86_KERNELS
+    const SimdLevel level = ActiveSimdLevel();
+    if(level == SimdLevel::kAvx512)
+      return fast ? EntropyAvx512<true>(p, n, scale)
+                  : EntropyAvx512<false>(p, n, scale);
+    if(level == SimdLevel::kAvx2)
+      return fast ? EntropyAvx2<true>(p, n, scale)
+                  : EntropyAvx2<false>(p, n, scale);
+#endif
+    return ScalarEntropy(p, n, scale, fast);
+  }
+}
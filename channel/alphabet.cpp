@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+#include "alphabet.h"
+
+namespace channel {
+
+namespace {
+
+struct Symbols {
+  std::mutex mutex;
+  std::unordered_map<std::string, int> ids;
+  // A deque never moves its elements, so Name can hand out references.
+  std::deque<std::string> names;
+};
+
+Symbols& symbol_table() {
+  static Symbols* s = new Symbols();
+  return *s;
+}
+
+struct SymbolsHash {
+  std::size_t operator()(const std::vector<int>& v) const {
+    std::size_t h = v.size();
+    for(int id : v)
+      h ^= std::hash<int>()(id) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+  }
+};
+
+// Every live alphabet, by its symbols.
+struct Registry {
+  std::mutex mutex;
+  std::unordered_map<std::vector<int>, std::weak_ptr<const Alphabet>,
+                     SymbolsHash> alphabets;
+  // Dead entries are swept when the table doubles past this size.
+  std::size_t sweep_at = 1024;
+};
+
+Registry& registry() {
+  static Registry* r = new Registry();
+  return *r;
+}
+
+// The default alphabets built so far, by prefix, size and padding, so
+// that channels of the same size do not format and intern their names
+// again. They are kept alive, up to this many symbols in all; past
+// that, the table starts over.
+const std::size_t kDefaultSymbols = 1 << 20;
+
+struct Defaults {
+  std::mutex mutex;
+  std::map<std::tuple<std::string, int, bool>, Alphabet::Ptr> alphabets;
+  std::size_t symbols = 0;
+};
+
+Defaults& defaults() {
+  static Defaults* d = new Defaults();
+  return *d;
+}
+
+}  // namespace
+
+int SymbolTable::Intern(const std::string& name) {
+  Symbols& s = symbol_table();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto it = s.ids.find(name);
+  if(it != s.ids.end()) return it->second;
+  int id = s.names.size();
+  s.names.push_back(name);
+  s.ids.emplace(name, id);
+  return id;
+}
+
+const std::string& SymbolTable::Name(int id) {
+  Symbols& s = symbol_table();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.names.at(id);
+}
+
+Alphabet::Alphabet(Key, const std::vector<int>& symbols) : symbols_(symbols) {
+  this->names_.reserve(symbols.size());
+  this->position_.reserve(symbols.size());
+  this->index_.reserve(symbols.size());
+  for(int i = 0; i < (int)symbols.size(); i++) {
+    this->names_.push_back(SymbolTable::Name(symbols[i]));
+    this->position_[symbols[i]] = i;
+    this->index_[this->names_[i]] = i;
+  }
+}
+
+Alphabet::Ptr Alphabet::FromSymbols(const std::vector<int>& symbols) {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::weak_ptr<const Alphabet>& slot = r.alphabets[symbols];
+  Ptr alphabet = slot.lock();
+  if(alphabet) return alphabet;
+
+  alphabet = std::make_shared<const Alphabet>(Key(), symbols);
+  slot = alphabet;
+  if(r.alphabets.size() >= r.sweep_at) {
+    for(auto it = r.alphabets.begin(); it != r.alphabets.end(); ) {
+      if(it->second.expired()) it = r.alphabets.erase(it);
+      else ++it;
+    }
+    r.sweep_at = 2*std::max<std::size_t>(r.alphabets.size(), 512);
+  }
+  return alphabet;
+}
+
+Alphabet::Ptr Alphabet::Make(const std::vector<std::string>& names) {
+  std::vector<int> ids(names.size());
+  for(int i = 0; i < (int)names.size(); i++)
+    ids[i] = SymbolTable::Intern(names[i]);
+  return Alphabet::FromSymbols(ids);
+}
+
+Alphabet::Ptr Alphabet::Default(const std::string& prefix, int size, bool pad) {
+  Defaults& d = defaults();
+  const auto key = std::make_tuple(prefix, size, pad);
+  {
+    std::lock_guard<std::mutex> lock(d.mutex);
+    auto it = d.alphabets.find(key);
+    if(it != d.alphabets.end()) return it->second;
+  }
+
+  std::vector<std::string> names(size);
+  int width = std::to_string(size).size();
+  for(int i = 0; i < size; i++) {
+    std::string num = std::to_string(i);
+    if(pad && (int)num.size() < width)
+      num = std::string(width - num.size(), '0') + num;
+    names[i] = prefix + num;
+  }
+  Ptr alphabet = Alphabet::Make(names);
+
+  std::lock_guard<std::mutex> lock(d.mutex);
+  if(d.symbols + size > kDefaultSymbols) {
+    d.alphabets.clear();
+    d.symbols = 0;
+  }
+  if(d.alphabets.emplace(key, alphabet).second) d.symbols += size;
+  return alphabet;
+}
+
+int Alphabet::index(const std::string& name) const {
+  auto it = this->index_.find(name);
+  if(it == this->index_.end())
+    throw std::out_of_range("Alphabet::index: unknown name " + name);
+  return it->second;
+}
+
+}  // namespace channel
@@ -0,0 +1,102 @@
+#ifndef _channel_alphabet_h
+#define _channel_alphabet_h
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace channel {
+
+// Interns the input/output names used by every channel, so a name is
+// kept once and is otherwise handled as a small integer id.
+// Thread-safe.
+//
+// The table only grows: ids are stored in alphabets and Name hands out
+// references, so a name is never dropped once interned. This is meant
+// for the bounded sets of names a process works with; a long-running
+// process that keeps making up new names will keep all of them.
+class SymbolTable {
+  public:
+    // Returns the id of [name], creating it if this is its first use.
+    static int Intern(const std::string& name);
+
+    // Returns the name of the symbol [id].
+    static const std::string& Name(int id);
+};
+
+
+// An ordered set of symbols: the inputs or the outputs of a channel.
+//
+// Alphabets are immutable and hash-consed: Make returns the very same
+// object for equal name lists, so channels built over the same names
+// share one Alphabet, and comparing alphabets is a pointer comparison.
+class Alphabet {
+  public:
+    typedef std::shared_ptr<const Alphabet> Ptr;
+
+    // Returns the alphabet with the given names, in this order.
+    static Ptr Make(const std::vector<std::string>& names);
+
+    // Returns the alphabet with the given symbol ids, in this order.
+    static Ptr FromSymbols(const std::vector<int>& symbols);
+
+    // Returns the default alphabet [prefix]0, [prefix]1, ...
+    // If [pad] is set, the numbers are left-padded with zeros to the
+    // width of [size]. Default alphabets are kept once built, so asking
+    // again for the same one costs a lookup.
+    static Ptr Default(const std::string& prefix, int size, bool pad);
+
+    int size() const {
+      return this->symbols_.size();
+    }
+
+    const std::vector<int>& symbols() const {
+      return this->symbols_;
+    }
+
+    const std::vector<std::string>& names() const {
+      return this->names_;
+    }
+
+    // Returns the position of the symbol [id], or -1 if it is not here.
+    int position(int id) const {
+      auto it = this->position_.find(id);
+      return (it == this->position_.end()) ? -1 : it->second;
+    }
+
+    // Returns the position of [name]. Throws std::out_of_range if the
+    // name is not in this alphabet. A repeated name maps to its last
+    // position.
+    int index(const std::string& name) const;
+
+    // Alphabets are hash-consed, so equal alphabets are the same object.
+    static bool Same(const Ptr& a, const Ptr& b) {
+      return a == b;
+    }
+
+  private:
+    // Only FromSymbols builds alphabets; the constructor takes a Key so
+    // that std::make_shared can call it while nobody else can.
+    class Key {
+      friend class Alphabet;
+      Key() {}
+    };
+
+  public:
+    Alphabet(Key, const std::vector<int>& symbols);
+
+  private:
+    std::vector<int> symbols_;
+
+    // The names of the symbols, kept here so the alphabet can hand out
+    // a reference to them.
+    std::vector<std::string> names_;
+
+    // Map a symbol id, and a name, to its position.
+    std::unordered_map<int, int> position_;
+    std::unordered_map<std::string, int> index_;
+};
+
+} // namespace channel
+
+#endif
@@ -1,18 +1,38 @@
-// In here, you can find a brute-force algorithm that randomly tries to find
-// two channels c1 and c2.
+// In here, you can find a brute-force algorithm that tries every pair of
+// channels c1 and c2 with a given resolution.
 //
 // The intention is to find channels whose properties hold:
 // 1) I_1(X;Y) = I_2(X;Y)
 // 2) V_1(X|Y) < V_2(X|Y)
 // 3) V_1(Y|X) > V_2(Y|X)
+//
+// Every property is computed under a uniform prior, so it does not change
+// when the inputs or outputs of a channel are relabeled, and only one
+// channel per class of relabelings is looked at (see channel/search.h).
+// The metrics are computed once per channel; the pairs are then taken from
+// the channels sorted by NMI, so only the ones within EPS are compared.
+//
+// The channels of a resolution are far too many to keep (about 10^9 at
+// 3 X 3 and N = 100), so they are spilled to temporary files, bucketed by
+// ranges of NMI, and read back one bucket at a time, in order. A bucket
+// with more than IN_MEMORY channels is split again. Memory is then
+// bounded by IN_MEMORY, plus the channels within EPS of the end of a
+// bucket, plus the ones with the very same NMI, which no split separates.
 
 #include <algorithm>
+#include <array>
+#include <cstdio>
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+#include "../../base/thread_pool.h"
 #include "../channel.h"
+#include "../count_evaluator.h"
+#include "../search.h"
 #include "../vulnerability/bayes.h"
 #include "../vulnerability/vulnerability.h"
 
@@ -24,179 +44,321 @@ using namespace channel::vulnerability;
 
 #define MAX_INPUT 3
 #define MAX_OUTPUT 3
+#define MAX_BASE_NORM 500
+
+// The channels kept in memory at once, and the buckets a range of NMI is
+// split in when spilled.
+#define IN_MEMORY (1 << 20)
+#define BUCKETS 64
+
+template <int NIn, int NOut>
+struct Candidate {
+  double nmi;
+  double posterior;
+  double reverse_posterior;
+  array<int, NIn*NOut> counts;
+};
 
-vector<double> prior_distribution;
-Channel best_c1, best_c2;
-vector<vector<int> > best_matrix_c1, best_matrix_c2;
-double best_diff1, best_diff2;
-int BASE_NORM = 20;
-
-
-// This function gets the next vector with size vec.size(),
-// and sum '\sum vec[i]', considering the lexicographical ordering.
-void next_vector(vector<int>& vec) {
-  // TODO: There is a way to implement this in O(1).
-  //       But since I would need some auxiliary variables, this is
-  //       going to be the implementation for now.
-  for(int i = vec.size()-1; i >= 1; i--) {
-    if(vec[i] != 0) {
-      vec[i-1]++;
-      int hue = vec[i]-1;
-      vec[i]=0;
-      vec[vec.size()-1] = hue;
-      break;
+// A pair (c1, c2) of the sorted candidates. The best one has the largest
+// min(diff1, diff2); ties go to the first pair in the candidate order, so
+// the result does not depend on how the work was split.
+struct Best {
+  double score = -1;
+  long long c1 = -1, c2 = -1;
+
+  bool found() const { return this->c1 >= 0; }
+
+  void Offer(double score, long long c1, long long c2) {
+    if(score > this->score ||
+        (score == this->score && make_pair(c1, c2) < make_pair(this->c1, this->c2))) {
+      this->score = score;
+      this->c1 = c1;
+      this->c2 = c2;
     }
   }
+};
+
+Channel to_channel(const int* counts, int ninput, int noutput,
+                   int base_norm) {
+  vector<double> prior_distribution(ninput, 1.0f/ninput);
+  vector<vector<double> > c_matrix(ninput, vector<double>(noutput, 0));
+  for(int i = 0; i < ninput; i++)
+    for(int j = 0; j < noutput; j++)
+      c_matrix[i][j] = ((double)counts[i*noutput + j])/base_norm;
+  return Channel(c_matrix, prior_distribution, base_norm);
 }
 
-// On the lexicographical ordering of vectors, this function checks
-// if vec is the final one.
-bool final_vector(const vector<int>& vec) {
-  bool non_zero = false;
-  for(unsigned i = 1; i < vec.size(); i++)
-    if(vec[i] != 0) {
-      non_zero = true;
-      break;
+// The candidates with an NMI in [lo, hi), in BUCKETS temporary files,
+// one per range of NMI. Every worker buffers its candidates per bucket, and
+// appends them to the file when the buffer fills.
+template <int NIn, int NOut>
+class Spill {
+  public:
+    typedef Candidate<NIn, NOut> C;
+
+    Spill(double lo, double hi, int workers)
+        : lo_(lo), hi_(hi), buckets_(BUCKETS),
+          buffers_(workers, vector<vector<C> >(BUCKETS)) {}
+
+    ~Spill() {
+      for(Bucket& bucket : this->buckets_)
+        if(bucket.file) fclose(bucket.file);
     }
-  return (!non_zero);
-}
 
+    // The range of NMI of the bucket [k].
+    double lo(int k) const {
+      return this->lo_ + (this->hi_ - this->lo_)*k/BUCKETS;
+    }
+    double hi(int k) const { return this->lo(k + 1); }
+    long long size(int k) const { return this->buckets_[k].size; }
 
+    void Add(const C& candidate, int worker) {
+      const double at = (candidate.nmi - this->lo_) / (this->hi_ - this->lo_);
+      const int k = max(0, min(BUCKETS - 1, (int)(at * BUCKETS)));
+      vector<C>& buffer = this->buffers_[worker][k];
+      buffer.push_back(candidate);
+      if(buffer.size() == 256) this->Flush(worker, k);
+    }
 
-void evaluate(const vector<vector<int> >& c1_matrix,
-               const vector<vector<int> >& c2_matrix) {
-  Bayes b;
-  int ninput = c1_matrix.size();
-  int noutput = c1_matrix[0].size();
-  vector<vector<double> > j1_matrix(ninput, vector<double>(noutput, 0));
-  vector<vector<double> > j2_matrix(ninput, vector<double>(noutput, 0));
-  
-  
-  for(int i = 0; i < c1_matrix.size(); i++) {
-    for(int j = 0; j < c1_matrix[i].size(); j++) {
-      j1_matrix[i][j] = ((double)c1_matrix[i][j])/BASE_NORM;
-      j1_matrix[i][j] *= prior_distribution[i];
+    // Writes what is left in the buffers.
+    void Close() {
+      for(int worker = 0; worker < (int)this->buffers_.size(); worker++)
+        for(int k = 0; k < BUCKETS; k++) this->Flush(worker, k);
     }
-  }
-  
-  for(int i = 0; i < c2_matrix.size(); i++) {
-    for(int j = 0; j < c2_matrix[i].size(); j++) {
-      j2_matrix[i][j] = ((double)c2_matrix[i][j])/BASE_NORM;
-      j2_matrix[i][j] *= prior_distribution[i];
+
+    // Calls read(candidates, n) over the whole bucket [k], a block at a
+    // time.
+    template <typename Read>
+    void ForEach(int k, Read read) const {
+      FILE* file = this->buckets_[k].file;
+      if(!file) return;
+      rewind(file);
+      vector<C> block(4096);
+      size_t n;
+      while((n = fread(block.data(), sizeof(C), block.size(), file)) > 0)
+        read(block.data(), n);
     }
-  }
-  
-  Channel c1(j1_matrix, prior_distribution, BASE_NORM);
-  Channel c2(j2_matrix, prior_distribution, BASE_NORM);
-  
-  if(fabs(c1.NormalizedMutualInformation() -
-        c2.NormalizedMutualInformation()) > EPS)
-    return;
-
-  double bLeakagePosterior_c1 = b.LeakageMultPosterior(c1);
-  double bLeakagePosterior_c2 = b.LeakageMultPosterior(c2);
-
-  double bLeakageRevPosterior_c1 = b.LeakageMultReversePosterior(c1);
-  double bLeakageRevPosterior_c2 = b.LeakageMultReversePosterior(c2);
-
-  double diff1 = bLeakagePosterior_c1 - bLeakagePosterior_c2;
-  double diff2 = bLeakageRevPosterior_c2 - bLeakageRevPosterior_c1;
-  if(bLeakagePosterior_c1 > bLeakagePosterior_c2 && 
-      bLeakageRevPosterior_c1 < bLeakageRevPosterior_c2) {
-    if(best_diff1 < diff1 && best_diff2 < diff2) {
-      best_c1 = c1;
-      best_c2 = c2;
-      best_diff1 = diff1;
-      best_diff2 = diff2;
-      best_matrix_c1 = c1_matrix;
-      best_matrix_c2 = c2_matrix;
+
+  private:
+    struct Bucket {
+      mutex lock;
+      FILE* file = nullptr;
+      long long size = 0;
+    };
+
+    void Flush(int worker, int k) {
+      vector<C>& buffer = this->buffers_[worker][k];
+      if(buffer.empty()) return;
+      Bucket& bucket = this->buckets_[k];
+      lock_guard<mutex> lock(bucket.lock);
+      if(!bucket.file && !(bucket.file = tmpfile())) {
+        perror("brutao_memefficient: tmpfile");
+        exit(1);
+      }
+      if(fwrite(buffer.data(), sizeof(C), buffer.size(), bucket.file) !=
+         buffer.size()) {
+        perror("brutao_memefficient: fwrite");
+        exit(1);
+      }
+      bucket.size += buffer.size();
+      buffer.clear();
     }
-  }
+
+    double lo_, hi_;
+    vector<Bucket> buckets_;
+    vector<vector<vector<C> > > buffers_;
+};
+
+// Every canonical channel, with its metrics, spilled by NMI. Channels with
+// no NMI (H(Y) = 0) are within EPS of no other one, and are left out.
+template <int NIn, int NOut>
+unique_ptr<Spill<NIn, NOut> > collect(
+    const search::CountEnumerator& enumerator, base::ThreadPool* pool) {
+  unique_ptr<Spill<NIn, NOut> > spill(new Spill<NIn, NOut>(
+      0, 1, search::CountEnumerator::Workers(pool)));
+  enumerator.ForEach(pool, [&](const int* counts, int worker) {
+    CountEvaluator<NIn, NOut> c(counts);
+    Candidate<NIn, NOut> candidate;
+    candidate.counts = c.counts();
+    candidate.nmi = c.NormalizedMutualInformation();
+    if(std::isnan(candidate.nmi)) return;
+    candidate.posterior = c.LeakageMultPosterior();
+    candidate.reverse_posterior = c.LeakageMultReversePosterior();
+    spill->Add(candidate, worker);
+  });
+  spill->Close();
+  return spill;
 }
 
-// Invariants:
-// * The comparisons made here, are lexicografic comparisons. 
-//
-// 1) Considering just one matrix, c[i] <= c[i+1]
-void brute(vector<vector<int> >& c1_matrix,
-            vector<vector<int> >& c2_matrix, int line,
-            bool fill2=false) {
-  if(fill2 && line == c2_matrix.size()) {
-    evaluate(c1_matrix, c2_matrix);
-    return;
-  }
+// The pairs (a, b), a < b, of the sorted candidates with b >= first, i.e.
+// the ones not already searched with an earlier bucket.
+template <int NIn, int NOut>
+Best search_pairs(const vector<Candidate<NIn, NOut> >& candidates, int first,
+                  base::ThreadPool* pool) {
+  vector<Best> best(search::CountEnumerator::Workers(pool));
+  pool->ParallelFor(0, candidates.size(), [&](int begin, int end) {
+    Best& mine = best[pool->CurrentWorker()];
+    for(int a = begin; a < end; a++) {
+      for(int b = max(a+1, first); b < (int)candidates.size() &&
+          candidates[b].nmi - candidates[a].nmi <= EPS; b++) {
+        // Either of the two may play c1.
+        const Candidate<NIn, NOut>* pair[2] = {&candidates[a], &candidates[b]};
+        for(int k = 0; k < 2; k++) {
+          const Candidate<NIn, NOut>& c1 = *pair[k];
+          const Candidate<NIn, NOut>& c2 = *pair[1-k];
+          double diff1 = c1.posterior - c2.posterior;
+          double diff2 = c2.reverse_posterior - c1.reverse_posterior;
+          if(diff1 > 0 && diff2 > 0)
+            mine.Offer(min(diff1, diff2), k ? b : a, k ? a : b);
+        }
+      }
+    }
+  }, 64);
 
-  if(line == c1_matrix.size()) {
-    brute(c1_matrix, c2_matrix, 0, true);
-    return;
-  }
+  Best merged;
+  for(const Best& b : best)
+    if(b.found()) merged.Offer(b.score, b.c1, b.c2);
+  return merged;
+}
 
-  vector<vector<int> > *cur_matrix = &c1_matrix;
-  if(fill2) cur_matrix = &c2_matrix;
+// The search over the candidates in NMI order, one bucket at a time.
+template <int NIn, int NOut>
+struct Window {
+  // The last candidates so far, the ones within EPS of the next bucket,
+  // and the position of the first of them in the whole sorted order.
+  vector<Candidate<NIn, NOut> > carry;
+  long long offset = 0;
 
-  if(line != 0) {
-    (*cur_matrix)[line] = (*cur_matrix)[line-1];
-  }
-  else if(fill2) {
-    c2_matrix[0] = vector<int>(c2_matrix[0].size(), 0);
-    c2_matrix[0][c2_matrix[0].size()-1] = BASE_NORM;
-  }
+  Best best;
+  array<int, NIn*NOut> best_c1, best_c2;
+};
 
-  while(!final_vector((*cur_matrix)[line])) {
-    brute(c1_matrix, c2_matrix, line+1, fill2);
-    next_vector((*cur_matrix)[line]);
+template <int NIn, int NOut>
+void search_spill(const Spill<NIn, NOut>& spill, Window<NIn, NOut>* window,
+                  base::ThreadPool* pool) {
+  typedef Candidate<NIn, NOut> C;
+  for(int k = 0; k < BUCKETS; k++) {
+    if(spill.size(k) == 0) continue;
+    if(spill.size(k) > IN_MEMORY && spill.hi(k) - spill.lo(k) > EPS) {
+      Spill<NIn, NOut> split(spill.lo(k), spill.hi(k), 1);
+      spill.ForEach(k, [&split](const C* candidates, size_t n) {
+        for(size_t i = 0; i < n; i++) split.Add(candidates[i], 0);
+      });
+      split.Close();
+      search_spill(split, window, pool);
+      continue;
+    }
+
+    // The buckets are in NMI order, so the carried candidates all come
+    // before the ones of this bucket.
+    vector<C> candidates;
+    candidates.swap(window->carry);
+    const int first = candidates.size();
+    spill.ForEach(k, [&candidates](const C* block, size_t n) {
+      candidates.insert(candidates.end(), block, block + n);
+    });
+    sort(candidates.begin() + first, candidates.end(),
+         [](const C& a, const C& b) {
+      if(a.nmi != b.nmi) return a.nmi < b.nmi;
+      return a.counts < b.counts;
+    });
+
+    Best best = search_pairs(candidates, first, pool);
+    if(best.found()) {
+      const long long c1 = window->offset + best.c1;
+      const long long c2 = window->offset + best.c2;
+      window->best.Offer(best.score, c1, c2);
+      if(window->best.c1 == c1 && window->best.c2 == c2) {
+        window->best_c1 = candidates[best.c1].counts;
+        window->best_c2 = candidates[best.c2].counts;
+      }
+    }
+
+    int tail = candidates.size();
+    while(tail > 0 && candidates.back().nmi - candidates[tail-1].nmi <= EPS)
+      tail--;
+    window->carry.assign(candidates.begin() + tail, candidates.end());
+    window->offset += tail;
   }
-  brute(c1_matrix, c2_matrix, line+1, fill2);
 }
 
-void print_matrix(const vector<vector<int> >& matrix) {
-  for(int i = 0; i < matrix.size(); i++) {
-    for(int j = 0; j < matrix[i].size(); j++) {
-      cout << matrix[i][j] << " ";
+void print_matrix(const int* counts, int ninput, int noutput) {
+  for(int i = 0; i < ninput; i++) {
+    for(int j = 0; j < noutput; j++) {
+      cout << counts[i*noutput + j] << " ";
     }
     cout << endl;
   }
 }
 
-int main() {
+template <int NIn, int NOut>
+void brute(base::ThreadPool* pool) {
   Bayes b;
-  for(int i = 2; i <= MAX_INPUT; i++) {
-    for(int j = 2; j <= MAX_OUTPUT; j++) {
-      cout << "Brute-forcing " << i << " X " << j << " ...\n" << std::flush;
-      BASE_NORM = 3;
-      best_diff1 = -1, best_diff2 = -1;
-      best_matrix_c1 = vector<vector<int> > (i, vector<int>(j, 0));
-      best_matrix_c2 = vector<vector<int> > (i, vector<int>(j, 0));
-      while(++BASE_NORM <= 500) {
-        vector<vector<int> > c1(i, vector<int>(j, 0));
-        vector<vector<int> > c2(i, vector<int>(j, 0));
-        prior_distribution = vector<double>(i, 1.0f/i);
-        
-        //cout << "\r" << BASE_NORM << std::flush;
-        c1[0][j-1] = BASE_NORM;
-        c2[0][j-1] = BASE_NORM;
-        brute(c1, c2, 0);
-        if(best_diff1 >= 0 && best_diff2 >= 0) {
-          cout << endl;
-          cout << "OIA: " << i << " X " << j << endl;
-          cout << best_c1.to_string() << endl;
-          print_matrix(best_matrix_c1);
-
-          cout << best_c2.to_string() << endl;
-          print_matrix(best_matrix_c2);
-          
-          cout << "NMI C1: " << best_c1.NormalizedMutualInformation() << endl;
-          cout << "NMI C2: " << best_c2.NormalizedMutualInformation() << endl;
-          cout << b.LeakageMultPosterior(best_c1) << " " <<
-            b.LeakageMultPosterior(best_c2) << endl;
-          cout << b.LeakageMultReversePosterior(best_c1) << " " <<
-            b.LeakageMultReversePosterior(best_c2) << endl;
-          cout << endl << endl;
-        }
-      }
+  const int i = NIn, j = NOut;
+  cout << "Brute-forcing " << i << " X " << j << " ...\n" << std::flush;
+  int BASE_NORM = 3;
+  double best_score = -1;
+  array<int, NIn*NOut> best_matrix_c1, best_matrix_c2;
+  int best_norm = 0;
+  while(++BASE_NORM <= MAX_BASE_NORM) {
+    search::CountEnumerator enumerator(i, j, BASE_NORM);
+    Window<NIn, NOut> window;
+    search_spill(*collect<NIn, NOut>(enumerator, pool), &window, pool);
+    const Best& best = window.best;
+    if(best.found() && best.score > best_score) {
+      best_score = best.score;
+      best_matrix_c1 = window.best_c1;
+      best_matrix_c2 = window.best_c2;
+      best_norm = BASE_NORM;
+    }
+
+    if(best_score >= 0) {
+      Channel best_c1 = to_channel(best_matrix_c1.data(), i, j, best_norm);
+      Channel best_c2 = to_channel(best_matrix_c2.data(), i, j, best_norm);
       cout << endl;
+      cout << "OIA: " << i << " X " << j << endl;
+      cout << best_c1.to_string() << endl;
+      print_matrix(best_matrix_c1.data(), i, j);
+
+      cout << best_c2.to_string() << endl;
+      print_matrix(best_matrix_c2.data(), i, j);
+
+      cout << "NMI C1: " << best_c1.NormalizedMutualInformation() << endl;
+      cout << "NMI C2: " << best_c2.NormalizedMutualInformation() << endl;
+      cout << b.LeakageMultPosterior(best_c1) << " " <<
+        b.LeakageMultPosterior(best_c2) << endl;
+      cout << b.LeakageMultReversePosterior(best_c1) << " " <<
+        b.LeakageMultReversePosterior(best_c2) << endl;
+      cout << endl << endl;
     }
   }
+  cout << endl;
+}
 
+// Runs brute<NIn, NOut> for every size up to MAX_INPUT X MAX_OUTPUT, as the
+// sizes must be known at compile time.
+template <int NIn, int NOut>
+struct BruteAll {
+  static void Run(base::ThreadPool* pool) {
+    brute<NIn, NOut>(pool);
+    BruteAll<NIn, NOut+1>::Run(pool);
+  }
+};
+
+template <int NIn>
+struct BruteAll<NIn, MAX_OUTPUT+1> {
+  static void Run(base::ThreadPool* pool) {
+    BruteAll<NIn+1, 2>::Run(pool);
+  }
+};
+
+template <>
+struct BruteAll<MAX_INPUT+1, 2> {
+  static void Run(base::ThreadPool*) {}
+};
+
+int main() {
+  base::ThreadPool pool;
+  BruteAll<2, 2>::Run(&pool);
   return 0;
 }
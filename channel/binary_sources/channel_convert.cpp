@@ -0,0 +1,41 @@
+// Converts channels between the text format of Channel::ParseFile and the
+// binary format of channel/channel_file.h, in whichever direction the
+// input needs.
+//
+// Usage: channel_convert <input> <output> [--float]
+//   A text input is written as a binary file, of doubles, or of floats
+//   with --float. A binary input is written back as text.
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "../channel.h"
+#include "../channel_file.h"
+
+using namespace std;
+using namespace channel;
+
+int main(int argc, char** argv) {
+  if(argc < 3 || argc > 4 || (argc == 4 && strcmp(argv[3], "--float") != 0)) {
+    cerr << "Usage: " << argv[0] << " <input> <output> [--float]" << endl;
+    return 1;
+  }
+  try {
+    if(IsChannelFile(argv[1])) {
+      ofstream out(argv[2]);
+      out << ReadChannelFile(argv[1]).to_string();
+      if(!out) throw runtime_error(string("can not write ") + argv[2]);
+    } else {
+      Channel c;
+      c.ParseFile(argv[1]);
+      WriteChannelFile(c, argv[2], argc == 4 ? ChannelFilePrecision::kFloat
+                                             : ChannelFilePrecision::kDouble);
+    }
+  } catch(const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
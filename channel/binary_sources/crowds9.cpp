@@ -25,17 +25,17 @@ int main() {
   //cout << id << is << pd << ps;
   //cout << id << std::endl << is*ps;
   Channel x1 = 
-    Channel::hidden_choice( id*pd, is*(ps*ps), q );
+    Channel::hidden_choice( id*pd, q, is*(ps*ps) );
   cout << "X1" << endl;
   cout << x1;
 
   Channel x2 = 
-    Channel::hidden_choice( is*ps, x1, p );
+    Channel::hidden_choice( is*ps, p, x1 );
   cout << "X2" << endl;
   cout << x2;
 
   Channel x3 = 
-    Channel::hidden_choice( id, x2, q);
+    Channel::hidden_choice( id, q, x2 );
   cout << "X3" << endl;
   cout << x3;
 
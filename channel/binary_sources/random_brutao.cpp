@@ -5,14 +5,22 @@
 // 1) I_1(X;Y) = I_2(X;Y)
 // 2) V_1(X|Y) < V_2(X|Y)
 // 3) V_1(Y|X) > V_2(Y|X)
+//
+// The random channels are joint matrices of counts, drawn as in
+// Channel::Randomize, and evaluated without building a Channel.
+//
+// Usage: random_brutao [seed]. Runs with the same seed are the same.
 
 #include <algorithm>
+#include <array>
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
 #include <vector>
 
+#include "../../base/random.h"
 #include "../channel.h"
+#include "../count_evaluator.h"
 #include "../vulnerability/bayes.h"
 
 using namespace std;
@@ -21,56 +29,115 @@ using namespace channel::vulnerability;
 
 #define EPS 1e-4
 
-int main()
-{
+#define MAX_INPUT 9
+#define MAX_OUTPUT 9
+
+template <int NIn, int NOut>
+CountEvaluator<NIn, NOut> random_channel(base::Rng& rng) {
+  array<int, NIn*NOut> counts;
+  for(int& count : counts)
+    count = rng.UniformInt(0, 1000);
+  return CountEvaluator<NIn, NOut>(counts.data());
+}
+
+// The channel with J = counts / total.
+Channel to_channel(const int* counts, int ninput, int noutput) {
+  vector<vector<double> > c_matrix(ninput, vector<double>(noutput, 0));
+  vector<double> prior_distribution(ninput, 0);
+  int total = 0;
+  for(int i = 0; i < ninput; i++) {
+    int row_sum = 0;
+    for(int j = 0; j < noutput; j++)
+      row_sum += counts[i*noutput + j];
+    for(int j = 0; j < noutput; j++)
+      if(row_sum != 0)
+        c_matrix[i][j] = ((double)counts[i*noutput + j])/row_sum;
+    prior_distribution[i] = row_sum;
+    total += row_sum;
+  }
+  for(double& p : prior_distribution)
+    p /= total;
+  return Channel(c_matrix, prior_distribution, total);
+}
+
+template <int NIn, int NOut>
+void random_search(base::Rng& rng) {
   Bayes b;
+  const int i = NIn, j = NOut;
+  CountEvaluator<NIn, NOut> c1 = random_channel<NIn, NOut>(rng);
+  CountEvaluator<NIn, NOut> c2 = random_channel<NIn, NOut>(rng);
+  array<int, NIn*NOut> best_c1, best_c2;
+  double best_diffa = 0, best_diffb = 0;
 
-  for(int i = 2; i < 10; i++) {
-    for(int j = 2; j < 10; j++) {
-      Channel c1(i, j), c2(i, j);
-      Channel best_c1, best_c2;
-      double best_diffa = 0, best_diffb = 0;
-      
-      int ntries = 100000;
-      while((ntries--) > 0 || best_diffa < EPS || best_diffb < EPS) {
-        while(fabs(c1.NormalizedMutualInformation() -
-                    c2.NormalizedMutualInformation()) > EPS) {
-          c1.Randomize();
-          c2.Randomize();
-        }
-        
-        double bLeakagePosterior_c1 = b.LeakageMultPosterior(c1);
-        double bLeakagePosterior_c2 = b.LeakageMultPosterior(c2);
-        
-        double bLeakageRevPosterior_c1 = b.LeakageMultReversePosterior(c1);
-        double bLeakageRevPosterior_c2 = b.LeakageMultReversePosterior(c2);
-        
-        double diff1 = bLeakagePosterior_c1 - bLeakagePosterior_c2;
-        double diff2 = bLeakageRevPosterior_c2 - bLeakageRevPosterior_c1;
-        
-        if(bLeakagePosterior_c1 > bLeakagePosterior_c2 && 
-            bLeakageRevPosterior_c1 < bLeakageRevPosterior_c2) {
-          if(diff1 > best_diffa && diff2 > best_diffb) {
-            best_c1.ParseInput(c1.to_string());
-            best_c2.ParseInput(c2.to_string());
-            best_diffa = diff1;
-            best_diffb = diff2;
-          }
-        }
-        c1.Randomize();
-        c2.Randomize();
-      }
+  int ntries = 100000;
+  while((ntries--) > 0 || best_diffa < EPS || best_diffb < EPS) {
+    while(fabs(c1.NormalizedMutualInformation() -
+                c2.NormalizedMutualInformation()) > EPS) {
+      c1 = random_channel<NIn, NOut>(rng);
+      c2 = random_channel<NIn, NOut>(rng);
+    }
+
+    double bLeakagePosterior_c1 = c1.LeakageMultPosterior();
+    double bLeakagePosterior_c2 = c2.LeakageMultPosterior();
 
-      if(best_diffa > 0 && best_diffb > 0) {
-        cout << "OIA: " << i << " X " << j << endl;
-        cout << best_c1.to_string() << endl;
-        cout << best_c2.to_string() << endl;
-        cout << b.LeakageMultPosterior(best_c1) << " " << b.LeakageMultPosterior(best_c2) << endl;
-        cout << b.LeakageMultReversePosterior(best_c1) << " " << b.LeakageMultReversePosterior(best_c2) << endl;
+    double bLeakageRevPosterior_c1 = c1.LeakageMultReversePosterior();
+    double bLeakageRevPosterior_c2 = c2.LeakageMultReversePosterior();
 
-        cout << endl << endl;
+    double diff1 = bLeakagePosterior_c1 - bLeakagePosterior_c2;
+    double diff2 = bLeakageRevPosterior_c2 - bLeakageRevPosterior_c1;
+
+    if(bLeakagePosterior_c1 > bLeakagePosterior_c2 &&
+        bLeakageRevPosterior_c1 < bLeakageRevPosterior_c2) {
+      if(diff1 > best_diffa && diff2 > best_diffb) {
+        best_c1 = c1.counts();
+        best_c2 = c2.counts();
+        best_diffa = diff1;
+        best_diffb = diff2;
       }
     }
+    c1 = random_channel<NIn, NOut>(rng);
+    c2 = random_channel<NIn, NOut>(rng);
+  }
+
+  if(best_diffa > 0 && best_diffb > 0) {
+    Channel channel_c1 = to_channel(best_c1.data(), i, j);
+    Channel channel_c2 = to_channel(best_c2.data(), i, j);
+    cout << "OIA: " << i << " X " << j << endl;
+    cout << channel_c1.to_string() << endl;
+    cout << channel_c2.to_string() << endl;
+    cout << b.LeakageMultPosterior(channel_c1) << " " << b.LeakageMultPosterior(channel_c2) << endl;
+    cout << b.LeakageMultReversePosterior(channel_c1) << " " << b.LeakageMultReversePosterior(channel_c2) << endl;
+
+    cout << endl << endl;
+  }
+}
+
+// Runs random_search<NIn, NOut> for every size up to MAX_INPUT X
+// MAX_OUTPUT, as the sizes must be known at compile time.
+template <int NIn, int NOut>
+struct SearchAll {
+  static void Run(base::Rng& rng) {
+    random_search<NIn, NOut>(rng);
+    SearchAll<NIn, NOut+1>::Run(rng);
+  }
+};
+
+template <int NIn>
+struct SearchAll<NIn, MAX_OUTPUT+1> {
+  static void Run(base::Rng& rng) {
+    SearchAll<NIn+1, 2>::Run(rng);
   }
+};
+
+template <>
+struct SearchAll<MAX_INPUT+1, 2> {
+  static void Run(base::Rng&) {}
+};
+
+int main(int argc, char** argv)
+{
+  base::Rng rng(argc > 1 ? strtoull(argv[1], nullptr, 10)
+                         : base::ThreadRng()());
+  SearchAll<2, 2>::Run(rng);
   return 0;
 }
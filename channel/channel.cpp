@@ -3,11 +3,19 @@
 #include <cmath>
 #include <cstdlib>
 #include <iomanip>
-#include <random>
 #include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 #define el std::cout << std::endl;
 
 #include "channel.h"
+#include "channel_parser.h"
+#include "../base/distribution.h"
+#include "../base/gemm.h"
+#include "../base/vmath.h"
+#include "vulnerability/gain_function.h"
+#include "vulnerability/gvulnerability.h"
 
 namespace channel {
 
@@ -35,7 +43,7 @@ Channel::Channel(const std::vector<std::vector<double> > & c_matrix,
   this->n_in_  = c_matrix.size();
   this->n_out_ = c_matrix[0].size();
   this->base_norm_ = base_norm;
-  this->build_channel(c_matrix);
+  this->build_channel(base::Matrix(c_matrix));
   this->setup_default_names();
 }
 
@@ -45,39 +53,187 @@ Channel::Channel(const std::vector<std::vector<double> > & c_matrix,
   this->n_in_  = c_matrix.size();
   this->n_out_ = c_matrix[0].size();
   this->base_norm_ = base_norm;
-  this->build_channel(c_matrix, prior_distribution);
+  this->build_channel(base::Matrix(c_matrix), std::move(prior_distribution));
   this->setup_default_names();
 }
 
+Channel::Channel(base::Matrix c_matrix, int base_norm) {
+  this->base_norm_ = base_norm;
+  this->build_channel(std::move(c_matrix));
+  this->setup_default_names();
+}
+
+Channel::Channel(base::Matrix c_matrix,
+                 std::vector<double> prior_distribution,
+                 int base_norm) {
+  this->base_norm_ = base_norm;
+  this->build_channel(std::move(c_matrix), std::move(prior_distribution));
+  this->setup_default_names();
+}
+
+Channel::Channel(base::SparseMatrix c_matrix, int base_norm) {
+  this->base_norm_ = base_norm;
+  std::vector<double> prior_distribution(c_matrix.rows(),
+                                         1.0f/c_matrix.rows());
+  this->build_channel(std::move(c_matrix), std::move(prior_distribution));
+  this->setup_default_names();
+}
+
+Channel::Channel(base::SparseMatrix c_matrix,
+                 std::vector<double> prior_distribution,
+                 int base_norm) {
+  this->base_norm_ = base_norm;
+  this->build_channel(std::move(c_matrix), std::move(prior_distribution));
+  this->setup_default_names();
+}
+
+Channel::Channel(base::Matrix c_matrix,
+                 std::vector<double> prior_distribution,
+                 Alphabet::Ptr in_alphabet, Alphabet::Ptr out_alphabet,
+                 int base_norm) {
+  this->base_norm_ = base_norm;
+  this->build_channel(std::move(c_matrix), std::move(prior_distribution));
+  this->set_in_alphabet(std::move(in_alphabet));
+  this->set_out_alphabet(std::move(out_alphabet));
+}
+
+Channel::Channel(base::SparseMatrix c_matrix,
+                 std::vector<double> prior_distribution,
+                 Alphabet::Ptr in_alphabet, Alphabet::Ptr out_alphabet,
+                 int base_norm) {
+  this->base_norm_ = base_norm;
+  this->build_channel(std::move(c_matrix), std::move(prior_distribution));
+  this->set_in_alphabet(std::move(in_alphabet));
+  this->set_out_alphabet(std::move(out_alphabet));
+}
+
 
 // This function resets the class to an initial state.
 void Channel::Reset() {
   // The prior is a uniform distribution by default.
   this->prior_distribution_.assign(this->n_in_, 1.0f/this->n_in_);
-  this->out_distribution_.assign(this->n_out_, 0);
-
-  this->max_pinput_.assign(this->n_in_, 0);
-
-  this->max_poutput_.assign(this->n_out_, 0);
 
   // Important: The first index of the matrices always represents
   // the x variable.
-  this->c_matrix_.assign(this->n_in_, std::vector<double>(this->n_out_, 0));
-  this->h_matrix_.assign(this->n_in_, std::vector<double>(this->n_out_, 0));
-  this->j_matrix_.assign(this->n_in_, std::vector<double>(this->n_out_, 0));
+  this->c_matrix_.assign(this->n_in_, this->n_out_, 0);
+  this->c_sparse_ = base::SparseMatrix();
+  this->sparse_ = false;
+  this->dense_ready_ = true;
+  this->sparse_ready_ = false;
+
+  // The derived quantities are rebuilt on demand.
+  this->invalidate_derived();
 }
 
 
-void Channel::ParseFile(std::string fname) {
-  std::ifstream f(fname);
-  std::string contentFile;
-  std::string curr_line;
-  while(std::getline(f, curr_line)) {
-    contentFile += curr_line; 
-    contentFile += '\n';
+void Channel::set_prior_distribution(std::vector<double> prior_distribution) {
+  this->prior_distribution_ = std::move(prior_distribution);
+  this->invalidate_derived();
+}
+
+
+void Channel::invalidate_derived() {
+  this->derived_ready_ = false;
+  this->hyper_ready_ = false;
+  this->entropy_ready_ = false;
+  this->joint_ready_ = false;
+}
+
+
+void Channel::set_sparse(bool sparse) {
+  if(sparse == this->sparse_) return;
+  if(sparse) {
+    this->build_sparse();
+    this->c_matrix_ = base::Matrix();
+    this->dense_ready_ = false;
+  } else {
+    this->build_dense();
+    this->c_sparse_ = base::SparseMatrix();
+    this->sparse_ready_ = false;
   }
-  ParseInput(contentFile); 
-  f.close();
+  this->sparse_ = sparse;
+  // The joint matrix is built with the other derived quantities only on
+  // dense channels.
+  this->invalidate_derived();
+}
+
+void Channel::make_dense() {
+  this->set_sparse(false);
+  // The dense form is about to change, so a sparse copy would go stale.
+  this->c_sparse_ = base::SparseMatrix();
+  this->sparse_ready_ = false;
+}
+
+void Channel::build_dense() const {
+  if(this->dense_ready_) return;
+  this->c_matrix_ = this->c_sparse_.ToDense();
+  this->dense_ready_ = true;
+}
+
+void Channel::build_sparse() const {
+  if(this->sparse_ready_) return;
+  this->c_sparse_ = base::SparseMatrix::FromDense(this->c_matrix_);
+  this->sparse_ready_ = true;
+}
+
+
+void Channel::set_row(int x, const double* row) {
+  this->make_dense();
+  double* c_row = this->c_matrix_.row(x).data();
+  if(!this->derived_ready_) {
+    std::copy(row, row + this->n_out_, c_row);
+    this->invalidate_derived();
+    return;
+  }
+
+  // Row x of the joint matrix changes, and with it the columns of the
+  // entries that changed; the rest of the caches stays as it is.
+  double* j_row = this->j_matrix_.row(x).data();
+  double p = this->prior_distribution_[x];
+  double max_in = 0;
+  for(int j = 0; j < this->n_out_; j++) {
+    c_row[j] = row[j];
+    double joint = row[j] * p;
+    max_in = std::max(max_in, joint);
+    if(joint != j_row[j]) {
+      j_row[j] = joint;
+      this->update_column(j);
+    }
+  }
+  this->max_pinput_[x] = max_in;
+  if(this->entropy_ready_) this->update_row_entropy(x);
+}
+
+
+// Recomputes p(y), the maximum p(x, y) and, if it is up to date, column y
+// of h_matrix, in the same order as a full rebuild.
+void Channel::update_column(int y) const {
+  double out = 0, max_out = 0;
+  for(int i = 0; i < this->n_in_; i++) {
+    double joint = this->j_matrix_(i, y);
+    out += joint;
+    max_out = std::max(max_out, joint);
+  }
+  this->out_distribution_[y] = out;
+  this->max_poutput_[y] = max_out;
+  if(this->hyper_ready_) {
+    for(int i = 0; i < this->n_in_; i++)
+      this->h_matrix_(i, y) = (out != 0) ? this->j_matrix_(i, y)/out : 0;
+  }
+}
+
+
+void Channel::ParseFile(std::string fname) {
+  // The file is read with a single call, and parsed from the buffer.
+  std::ifstream f(fname, std::ios::binary | std::ios::ate);
+  if(!f) throw std::runtime_error("can not open channel file " + fname);
+  const std::streamoff size = f.tellg();
+  if(size < 0) throw std::runtime_error("can not size channel file " + fname);
+  std::string content(size, '\0');
+  f.seekg(0);
+  if(!f.read(&content[0], size) || f.gcount() != size)
+    throw std::runtime_error("can not read channel file " + fname);
+  *this = ParseChannel(content.data(), content.data() + content.size(), fname);
 }
 
 
@@ -102,7 +258,7 @@ std::string Channel::to_string() const {
 
   for(int i = 0; i < this->n_in_; i++) {
     for(int j = 0; j < this->n_out_; j++)
-      ss << this->c_matrix_[i][j] << " ";
+      ss << this->c_matrix()[i][j] << " ";
     ss << std::endl;
   }
 
@@ -116,7 +272,8 @@ std::string Channel::to_string() const {
 
 
 bool Channel::CompatibleChannels(const Channel& c1, const Channel& c2) {
-  return (c1.n_in() == c2.n_in() && c1.in_names() == c2.in_names());
+  return (c1.n_in() == c2.n_in() &&
+          Alphabet::Same(c1.in_alphabet(), c2.in_alphabet()));
 }
 
 std::ostream& operator<< (std::ostream& stream, const Channel& channel) {
@@ -124,247 +281,418 @@ std::ostream& operator<< (std::ostream& stream, const Channel& channel) {
   return stream;
 }
 
+// The entropies go through base::Entropy, see base/vmath.h.
 double Channel::ShannonEntropyPrior() const {
-  double entropy = 0;
-  for(int i = 0; i < this->n_in_; i++) {
-    if(this->prior_distribution_[i] != 0)
-      entropy += (this->prior_distribution_[i]*log2(1.0f/this->prior_distribution_[i]));
-  }
-  return entropy;
+  return base::Entropy(this->prior_distribution_.data(), this->n_in_);
 }
 
 
-void Channel::build_channel(std::vector<std::vector<double> > c_matrix) {
-  this->n_in_  = c_matrix.size();
-  this->n_out_ = c_matrix[0].size();
-  this->prior_distribution_ = std::vector<double>(this->n_in_,
-                                                  1.0f/this->n_in_);
-  this->build_channel(c_matrix, this->prior_distribution_);
+void Channel::build_channel(base::Matrix c_matrix) {
+  this->n_in_  = c_matrix.rows();
+  this->n_out_ = c_matrix.cols();
+  std::vector<double> prior_distribution(this->n_in_, 1.0f/this->n_in_);
+  this->build_channel(std::move(c_matrix), std::move(prior_distribution));
 }
 
 
 
-void Channel::build_channel(std::vector<std::vector<double> > c_matrix,
+void Channel::build_channel(base::Matrix c_matrix,
     std::vector<double> prior_distribution) {
-  this->n_in_  = c_matrix.size();
-  this->n_out_ = c_matrix[0].size();
-  this->Reset();
-  this->c_matrix_ = c_matrix;
-  this->prior_distribution_ = prior_distribution;
+  this->n_in_  = c_matrix.rows();
+  this->n_out_ = c_matrix.cols();
+  this->prior_distribution_ = std::move(prior_distribution);
+  this->invalidate_derived();
+
+  const double size = (double)this->n_in_ * this->n_out_;
+  if(base::SparseMatrix::CountNonzeros(c_matrix) <= kSparseDensity * size) {
+    this->c_sparse_ = base::SparseMatrix::FromDense(c_matrix);
+    this->c_matrix_ = base::Matrix();
+    this->sparse_ = true;
+  } else {
+    this->c_matrix_ = std::move(c_matrix);
+    this->c_sparse_ = base::SparseMatrix();
+    this->sparse_ = false;
+  }
+  this->dense_ready_ = !this->sparse_;
+  this->sparse_ready_ = this->sparse_;
+}
 
-  
-  // Filling j_matrix
+
+void Channel::build_channel(base::SparseMatrix c_matrix,
+    std::vector<double> prior_distribution) {
+  this->n_in_  = c_matrix.rows();
+  this->n_out_ = c_matrix.cols();
+  this->prior_distribution_ = std::move(prior_distribution);
+  this->invalidate_derived();
+
+  if(c_matrix.density() <= kSparseDensity) {
+    this->c_sparse_ = std::move(c_matrix);
+    this->c_matrix_ = base::Matrix();
+    this->sparse_ = true;
+  } else {
+    this->c_matrix_ = c_matrix.ToDense();
+    this->c_sparse_ = base::SparseMatrix();
+    this->sparse_ = false;
+  }
+  this->dense_ready_ = !this->sparse_;
+  this->sparse_ready_ = this->sparse_;
+}
+
+
+// This function fills j_matrix, out_distribution, max_pinput and
+// max_poutput from c_matrix and the prior, unless they are up to date.
+void Channel::build_derived() const {
+  if(this->derived_ready_) return;
+
+  this->out_distribution_.assign(this->n_out_, 0);
+  this->max_pinput_.assign(this->n_in_, 0);
+  this->max_poutput_.assign(this->n_out_, 0);
+  double* out = this->out_distribution_.data();
+  double* max_out = this->max_poutput_.data();
+
+  // The zeros add nothing to the sums, nor to the maxima.
+  if(this->sparse_) {
+    for(int i = 0; i < this->n_in_; i++) {
+      base::SparseRow c_row = this->c_sparse_.row(i);
+      double p = this->prior_distribution_[i];
+      double max_in = 0;
+      for(int k = 0; k < c_row.size; k++) {
+        const int j = c_row.col[k];
+        const double joint = c_row.value[k] * p;
+        out[j] += joint;
+        max_in = std::max(max_in, joint);
+        max_out[j] = std::max(max_out[j], joint);
+      }
+      this->max_pinput_[i] = max_in;
+    }
+    this->derived_ready_ = true;
+    return;
+  }
+
+  // Every row is contiguous, so this pass streams through memory.
+  this->j_matrix_.assign(this->n_in_, this->n_out_, 0);
   for(int i = 0; i < this->n_in_; i++) {
+    const double* c_row = this->c_matrix_.row(i).data();
+    double* j_row = this->j_matrix_.row(i).data();
+    double p = this->prior_distribution_[i];
+    double max_in = 0;
     for(int j = 0; j < this->n_out_; j++) {
-      this->j_matrix_[i][j] = this->c_matrix_[i][j] * this->prior_distribution_[i];
+      j_row[j] = c_row[j] * p;
+      out[j] += j_row[j];
+      max_in = std::max(max_in, j_row[j]);
+      max_out[j] = std::max(max_out[j], j_row[j]);
     }
+    this->max_pinput_[i] = max_in;
   }
+  this->derived_ready_ = true;
+  this->joint_ready_ = true;
+}
 
-  // Filling outdistribution, maxpinput and maxpoutput
+
+// This function fills j_matrix, unless it is up to date. On a dense
+// channel it comes with the other derived quantities.
+void Channel::build_joint() const {
+  if(this->joint_ready_) return;
+  if(!this->sparse_) {
+    this->build_derived();
+    return;
+  }
+  this->j_matrix_.assign(this->n_in_, this->n_out_, 0);
   for(int i = 0; i < this->n_in_; i++) {
-    for(int j = 0; j < this->n_out_; j++) {
-      this->out_distribution_[j] += this->j_matrix_[i][j];
-      this->max_pinput_[i] = std::max(this->max_pinput_[i],
-                                     this->j_matrix_[i][j]);
-      this->max_poutput_[j] = std::max(this->max_poutput_[j],
-                                       this->j_matrix_[i][j]);
+    base::SparseRow c_row = this->c_sparse_.row(i);
+    double* j_row = this->j_matrix_.row(i).data();
+    for(int k = 0; k < c_row.size; k++)
+      j_row[c_row.col[k]] = c_row.value[k] * this->prior_distribution_[i];
+  }
+  this->joint_ready_ = true;
+}
+
+
+// This function fills h_matrix, unless it is up to date.
+void Channel::build_hyper() const {
+  if(this->hyper_ready_) return;
+  this->build_derived();
+
+  const double* out = this->out_distribution_.data();
+  this->h_matrix_.assign(this->n_in_, this->n_out_, 0);
+  if(this->sparse_) {
+    for(int i = 0; i < this->n_in_; i++) {
+      base::SparseRow c_row = this->c_sparse_.row(i);
+      double* h_row = this->h_matrix_.row(i).data();
+      for(int k = 0; k < c_row.size; k++) {
+        const int j = c_row.col[k];
+        const double joint = c_row.value[k] * this->prior_distribution_[i];
+        h_row[j] = (out[j] != 0) ? joint/out[j] : 0;
+      }
     }
+    this->hyper_ready_ = true;
+    return;
   }
-  
-  // Filling h_matrix
   for(int i = 0; i < this->n_in_; i++) {
+    const double* j_row = this->j_matrix_.row(i).data();
+    double* h_row = this->h_matrix_.row(i).data();
     for(int j = 0; j < this->n_out_; j++) {
-      this->h_matrix_[i][j] = this->j_matrix_[i][j]/this->out_distribution_[j];
+      // Outputs that never happen have no posterior; they count as zero.
+      h_row[j] = (out[j] != 0) ? j_row[j]/out[j] : 0;
     }
   }
+  this->hyper_ready_ = true;
 }
 
 
+// This function fills the per-x entropy terms, unless they are up to date.
+void Channel::build_entropy() const {
+  if(this->entropy_ready_) return;
+  this->build_derived();
+  this->row_entropy_.assign(this->n_in_, 0);
+  this->joint_row_entropy_.assign(this->n_in_, 0);
+  if(this->sparse_) {
+    // Only the nonzeros have entropy terms.
+    for(int i = 0; i < this->n_in_; i++) {
+      base::SparseRow c_row = this->c_sparse_.row(i);
+      double p = this->prior_distribution_[i];
+      this->row_entropy_[i] = base::Entropy(c_row.value, c_row.size);
+      this->joint_row_entropy_[i] = base::Entropy(c_row.value, c_row.size, p);
+    }
+  } else {
+    for(int i = 0; i < this->n_in_; i++)
+      this->update_row_entropy(i);
+  }
+  this->entropy_ready_ = true;
+}
+
+// p(x, y) is C[x][y] * pi(x), so the joint terms are taken from the row
+// of the channel, scaled.
+void Channel::update_row_entropy(int x) const {
+  const double* c_row = this->c_matrix_.row(x).data();
+  this->row_entropy_[x] = base::Entropy(c_row, this->n_out_);
+  this->joint_row_entropy_[x] =
+      base::Entropy(c_row, this->n_out_, this->prior_distribution_[x]);
+}
+
+
+namespace {
+
+// The sparse form of the matrix of [c]: its own if it is stored sparse,
+// otherwise a copy in [copy], so the operators below do not leave a
+// sparse copy behind in dense operands.
+const base::SparseMatrix& SparseForm(const Channel& c,
+                                     base::SparseMatrix* copy) {
+  if(c.is_sparse()) return c.c_sparse();
+  *copy = base::SparseMatrix::FromDense(c.c_matrix());
+  return *copy;
+}
+
+// The prior of the channels built by the compositions, as the one of
+// Channel(base::Matrix).
+std::vector<double> UniformPrior(int n) {
+  return std::vector<double>(n, 1.0f/n);
+}
+
+}  // namespace
+
 // Parallel Operator
 Channel operator||(const Channel & c1, const Channel & c2) {
   if(!Channel::CompatibleChannels(c1,c2)) {
     std::cerr << "Channels not compatible" << std::endl;
     exit(1);
   }
-  std::vector<std::string> out_names;
-  std::vector<std::vector<double> > c_m(c1.n_in());
-
   int c3_rows = c1.n_in();
   int c3_cols = c1.n_out() * c2.n_out();
 
-  for(int i=0; i<c3_rows; i++) {
-    c_m[i].assign(c3_cols, 0.0);
+  // Only the products of two nonzeros are nonzero; they come out in
+  // column order.
+  if(c1.is_sparse() || c2.is_sparse()) {
+    base::SparseMatrix copy1, copy2;
+    const base::SparseMatrix& s1 = SparseForm(c1, &copy1);
+    const base::SparseMatrix& s2 = SparseForm(c2, &copy2);
+    base::SparseMatrix c_s(c3_cols);
+    for(int k=0; k<c3_rows; k++) {
+      base::SparseRow c1_row = s1.row(k), c2_row = s2.row(k);
+      for(int a=0; a<c1_row.size; a++)
+        for(int b=0; b<c2_row.size; b++)
+          c_s.Add(c1_row.col[a]*c2.n_out() + c2_row.col[b],
+                  c1_row.value[a] * c2_row.value[b]);
+      c_s.EndRow();
+    }
+    return Channel(std::move(c_s), UniformPrior(c3_rows), c1.in_alphabet(),
+                   Alphabet::Default("y", c3_cols, true));
   }
 
-  std::vector<std::vector<double> > c1_c = c1.c_matrix();
-  std::vector<std::vector<double> > c2_c = c2.c_matrix();
+  base::Matrix c_m(c3_rows, c3_cols);
 
-  int col_pos = 0;
-  for(int i=0; i<c1.n_out(); i++) {
-    for(int j=0; j<c2.n_out(); j++) {
+  const base::Matrix& c1_c = c1.c_matrix();
+  const base::Matrix& c2_c = c2.c_matrix();
 
-      //std::string c1_ = c1.out_names()[i];
-      //std::string c2_ = c2.out_names()[j];
-
-      //out_names.push_back(c1_ + '.' + c2_);
-      //std::cout << out_names[out_names.size()-1] << std::endl;
-      for(int k=0; k<c1.n_in(); k++) {
-        //std::cout << i << " " << j << " " << k << std::endl;
-        c_m[k][col_pos] = c1_c[k][i] * c2_c[k][j];
+  // Output (i, j) of c3 is column i*|Y2| + j, so every row of c3 is the
+  // outer product of the same rows of c1 and c2, written in order.
+  for(int k=0; k<c3_rows; k++) {
+    const double* c1_row = c1_c.row(k).data();
+    const double* c2_row = c2_c.row(k).data();
+    double* c3_row = c_m.row(k).data();
+    for(int i=0; i<c1.n_out(); i++) {
+      for(int j=0; j<c2.n_out(); j++) {
+        c3_row[i*c2.n_out() + j] = c1_row[i] * c2_row[j];
       }
-      col_pos++;
     }
   }
-  Channel c3(c_m);
-  c3.set_in_names(c1.in_names());
-  //c3.set_out_names(out_names);
-  return c3;
+  return Channel(std::move(c_m), UniformPrior(c3_rows), c1.in_alphabet(),
+                 Alphabet::Default("y", c3_cols, true));
 }
 
 // Cascade
 Channel operator*(const Channel& c1, const Channel& c2) {
-  std::vector<std::vector<double> > new_c(c1.n_in());
-  std::vector<std::vector<double> > c1_c = c1.c_matrix();
-  std::vector<std::vector<double> > c2_c = c2.c_matrix();
-  for(int i=0; i<c1.n_in(); i++) {
-    new_c[i].resize(c2.n_out());
-    for(int j=0; j<c2.n_out(); j++) {
-      double sum = 0;
-      for(int k=0; k<c1.n_out(); k++) sum += (c1_c[i][k] * c2_c[k][j]);
-      new_c[i][j] = sum;
-    }
-  }
+  return Channel::cascade(c1, c2);
+}
+
+Channel Channel::cascade(const Channel& c1, const Channel& c2, int threads) {
+  // The cascade matrix is the product of both channel matrices.
+  // See base/gemm.h for the tolerance w.r.t. the naive triple loop.
+  // If either one is sparse, so is the product, in the sparse form
+  // of base/sparse_matrix.h, on one thread.
+  base::SparseMatrix copy1, copy2;
   // Is the prior of c3 always uniform?
-  Channel c3(new_c);
-  c3.set_in_names(c1.in_names());
-  c3.set_out_names(c2.out_names());
-  for(int i=0; i<(int)c2.out_names().size(); i++)
-    c3.insert_out_index(c3.out_names()[i], i); 
-  return c3;
+  if(c1.is_sparse() || c2.is_sparse())
+    return Channel(
+        base::Multiply(SparseForm(c1, &copy1), SparseForm(c2, &copy2)),
+        UniformPrior(c1.n_in()), c1.in_alphabet(), c2.out_alphabet());
+  return Channel(base::Multiply(c1.c_matrix(), c2.c_matrix(), threads),
+                 UniformPrior(c1.n_in()), c1.in_alphabet(), c2.out_alphabet());
 }
 
-Channel Channel::hidden_choice (const Channel& c1, const double prob,
-                                       const Channel& c2) {
-  std::vector<std::vector<double> > c_m(c1.n_in());
-  std::vector<std::vector<double> > c1_m = c1.c_matrix();
-  std::vector<std::vector<double> > c2_m = c2.c_matrix();
+namespace {
 
-  std::vector<std::string> c1_n = c1.out_names();
-  std::vector<std::string> c2_n = c2.out_names();
+// The union of the output alphabets of two channels, sorted by name,
+// along with the position, in the union, of every output of each channel.
+struct OutputUnion {
+  Alphabet::Ptr alphabet;
+  std::vector<int> from_c1, from_c2;
+};
 
-  std::vector<std::string> union_out_names;
+OutputUnion UnionOutputs(const Channel& c1, const Channel& c2) {
+  const Alphabet& a1 = *c1.out_alphabet();
+  const Alphabet& a2 = *c2.out_alphabet();
 
-  for(auto it : c1_n)
-    union_out_names.push_back(it);
-  for(auto it : c2_n)
-    union_out_names.push_back(it);
+  // (name, symbol) pairs of both alphabets; names are only compared
+  // while sorting, everything else works on the symbol ids.
+  std::vector<std::pair<const std::string*, int> > all;
+  all.reserve(a1.size() + a2.size());
+  for(int j=0; j<a1.size(); j++)
+    all.emplace_back(&a1.names()[j], a1.symbols()[j]);
+  for(int j=0; j<a2.size(); j++)
+    all.emplace_back(&a2.names()[j], a2.symbols()[j]);
 
   // Removing duplicates
-  sort(union_out_names.begin(), union_out_names.end());
-  union_out_names.erase(unique(union_out_names.begin(), union_out_names.end()), 
-                        union_out_names.end());
-
-  int union_size = union_out_names.size();
-  for(int i=0; i<c1.n_in(); i++) {
-    c_m[i].assign(union_size, 0);
-    for(int j=0; j<union_size; j++) {
-      int c1_j, c2_j;
-      bool f1 = false, f2 = false;
-      std::string target_out = union_out_names[j];
-
-      if( find(c1_n.begin(), c1_n.end(), target_out) != c1_n.end() ) 
-        f1 = true;
-      if( find(c2_n.begin(), c2_n.end(), target_out) != c2_n.end() )
-        f2 = true;
-
-      if( f1 && f2 ) {
-        c1_j = c1.out_index(union_out_names[j]);
-        c2_j = c2.out_index(union_out_names[j]);
-        c_m[i][j] = (prob)*(c1_m[i][c1_j]) + (1-prob)*(c2_m[i][c2_j]);
-      }
-      else if( f1 ) {
-        c1_j = c1.out_index(union_out_names[j]);
-        c_m[i][j] = (prob)*(c1_m[i][c1_j]);
-      }
-      else if( f2 ) {
-        c2_j = c2.out_index(union_out_names[j]);
-        c_m[i][j] = (1-prob)*(c2_m[i][c2_j]);
-      }
-      else 
-        std::cout << "deu ruim no find" << std::endl;
-    }
+  std::sort(all.begin(), all.end(),
+            [](const std::pair<const std::string*, int>& a,
+               const std::pair<const std::string*, int>& b) {
+              return *a.first < *b.first;
+            });
+  std::vector<int> symbols;
+  symbols.reserve(all.size());
+  std::unordered_map<int, int> index;
+  index.reserve(all.size());
+  for(const auto& it : all) {
+    if(index.emplace(it.second, symbols.size()).second)
+      symbols.push_back(it.second);
   }
-  Channel c3(c_m);
-  c3.set_in_names(c1_n);
-  c3.set_out_names(union_out_names);
-  int pos = 0;
-  for(auto it : union_out_names)
-    c3.insert_out_index(it, pos++);
-  return c3; 
-}
 
-// This function parses a channel string.
-void Channel::ParseInput(std::string input_str) {
-  std::stringstream f;
-  f << input_str;
-
-  f >> this->cname_; 
-  f >> this->n_in_;
-  f >> this->n_out_;
-
-  // Initializing every class property.
-  this->Reset();
-
-  std::string s;
-  this->in_names_.resize(this->n_in_);
-  this->out_names_.resize(this->n_out_);
+  OutputUnion u;
+  u.from_c1.resize(a1.size());
+  for(int j=0; j<a1.size(); j++)
+    u.from_c1[j] = index[a1.symbols()[j]];
+  u.from_c2.resize(a2.size());
+  for(int j=0; j<a2.size(); j++)
+    u.from_c2[j] = index[a2.symbols()[j]];
+  u.alphabet = Alphabet::FromSymbols(symbols);
+  return u;
+}
 
-  for(int i=0; i<this->n_in_; i++)  pos_in_names_[in_names_[i]] = i;
-  for(int i=0; i<this->n_out_; i++) pos_out_names_[out_names_[i]] = i;
+}  // namespace
 
-  for(int i = 0; i < this->n_in_; i++) {
-    f >> this->in_names_[i];
-    this->pos_in_names_[this->in_names_[i]] = i;
-  }
-  for(int i = 0; i < this->n_out_; i++) { 
-    f >> this->out_names_[i];
-    this->pos_out_names_[this->out_names_[i]] = i;
+Channel Channel::hidden_choice (const Channel& c1, const double prob,
+                                       const Channel& c2) {
+  // Every output of c1 and c2 is mapped once to its column in c3,
+  // then both matrices are scattered into c3 in a single pass.
+  OutputUnion u = UnionOutputs(c1, c2);
+
+  // The outputs both channels have are summed by EndRow, in the same
+  // order as below.
+  if(c1.is_sparse() || c2.is_sparse()) {
+    base::SparseMatrix copy1, copy2;
+    const base::SparseMatrix& s1 = SparseForm(c1, &copy1);
+    const base::SparseMatrix& s2 = SparseForm(c2, &copy2);
+    base::SparseMatrix c_s(u.alphabet->size());
+    for(int i=0; i<c1.n_in(); i++) {
+      base::SparseRow c1_row = s1.row(i), c2_row = s2.row(i);
+      for(int k=0; k<c1_row.size; k++)
+        c_s.Add(u.from_c1[c1_row.col[k]], (prob)*(c1_row.value[k]));
+      for(int k=0; k<c2_row.size; k++)
+        c_s.Add(u.from_c2[c2_row.col[k]], (1-prob)*(c2_row.value[k]));
+      c_s.EndRow();
+    }
+    return Channel(std::move(c_s), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                   std::move(u.alphabet));
   }
-  for(int i = 0; i < this->n_in_; i++)
-    for(int j = 0; j < this->n_out_; j++)
-      f >> this->c_matrix_[i][j];
 
-  for(int i = 0; i < this->n_in_; i++)
-    f >> this->prior_distribution_[i]; 
+  const base::Matrix& c1_m = c1.c_matrix();
+  const base::Matrix& c2_m = c2.c_matrix();
+  base::Matrix c_m(c1.n_in(), u.alphabet->size());
+  for(int i=0; i<c1.n_in(); i++) {
+    double* c3_row = c_m.row(i).data();
+    const double* c1_row = c1_m.row(i).data();
+    const double* c2_row = c2_m.row(i).data();
+    for(int j=0; j<c1.n_out(); j++)
+      c3_row[u.from_c1[j]] += (prob)*(c1_row[j]);
+    for(int j=0; j<c2.n_out(); j++)
+      c3_row[u.from_c2[j]] += (1-prob)*(c2_row[j]);
+  }
+  return Channel(std::move(c_m), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                 std::move(u.alphabet));
+}
 
-  this->build_channel(this->c_matrix_, this->prior_distribution_);
+// This function parses a channel string.
+void Channel::ParseInput(std::string input_str) {
+  *this = ParseChannel(input_str.data(), input_str.data() + input_str.size());
 }
 
 Channel Channel::visible_choice (const Channel& c1, const double prob, 
                                         const Channel& c2) {
 
-  std::vector<std::vector<double> > c_m(c1.n_in());
-  std::vector<std::string> new_output;
-
-  for(auto it : c1.out_names())
-    new_output.push_back(it);
-  for(auto it : c2.out_names())
-    new_output.push_back(it);
+  std::vector<int> new_output(c1.out_alphabet()->symbols());
+  new_output.insert(new_output.end(), c2.out_alphabet()->symbols().begin(),
+                    c2.out_alphabet()->symbols().end());
+
+  if(c1.is_sparse() || c2.is_sparse()) {
+    base::SparseMatrix copy1, copy2;
+    const base::SparseMatrix& s1 = SparseForm(c1, &copy1);
+    const base::SparseMatrix& s2 = SparseForm(c2, &copy2);
+    base::SparseMatrix c_s(new_output.size());
+    for(int i=0; i<c1.n_in(); i++) {
+      base::SparseRow c1_row = s1.row(i), c2_row = s2.row(i);
+      for(int k=0; k<c1_row.size; k++)
+        c_s.Add(c1_row.col[k], prob * c1_row.value[k]);
+      for(int k=0; k<c2_row.size; k++)
+        c_s.Add(c1.n_out() + c2_row.col[k], (1-prob) * c2_row.value[k]);
+      c_s.EndRow();
+    }
+    return Channel(std::move(c_s), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                   Alphabet::FromSymbols(new_output));
+  }
 
+  const base::Matrix& c1_m = c1.c_matrix();
+  const base::Matrix& c2_m = c2.c_matrix();
+  base::Matrix c_m(c1.n_in(), new_output.size());
   for(int i=0; i<c1.n_in(); i++) {
-    c_m[i].assign(new_output.size(), 0);
+    double* c3_row = c_m.row(i).data();
     int j = 0;
-    for(auto it : c1.c_matrix()[i])
-      c_m[i][j++] = prob * it;
-    for(auto it : c2.c_matrix()[i])
-      c_m[i][j++] = (1-prob) * it;
+    for(double it : c1_m[i])
+      c3_row[j++] = prob * it;
+    for(double it : c2_m[i])
+      c3_row[j++] = (1-prob) * it;
   }
-  Channel c3(c_m);
-  c3.set_in_names(c1.out_names());
-  c3.set_out_names(new_output);
-  for(int i=0; i<(int)new_output.size(); i++)
-    c3.insert_out_index(new_output[i], i);
-  return c3; 
+  return Channel(std::move(c_m), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                 Alphabet::FromSymbols(new_output));
 }
 
 // This function computes the result channel from using the
@@ -373,106 +701,121 @@ Channel Channel::visible_conditional(const Channel& c1,
                                      std::vector<std::string> &A, 
                                      const Channel& c2) {
 
-  std::vector<std::vector<double> > c_m(c1.n_in());
-
-  std::vector<std::string> new_output(c1.out_names());
-  for(auto it : c2.out_names())
-    new_output.push_back(it);
+  std::vector<int> new_output(c1.out_alphabet()->symbols());
+  new_output.insert(new_output.end(), c2.out_alphabet()->symbols().begin(),
+                    c2.out_alphabet()->symbols().end());
+
+  const std::vector<std::string>& input_names = c1.in_names();
+
+  if(c1.is_sparse() || c2.is_sparse()) {
+    base::SparseMatrix copy1, copy2;
+    const base::SparseMatrix& s1 = SparseForm(c1, &copy1);
+    const base::SparseMatrix& s2 = SparseForm(c2, &copy2);
+    base::SparseMatrix c_s(c1.n_out() + c2.n_out());
+    for(int i=0; i<c1.n_in(); i++) {
+      if(std::find(A.begin(), A.end(), input_names[i]) != A.end()) {
+        base::SparseRow c1_row = s1.row(i);
+        for(int k=0; k<c1_row.size; k++)
+          c_s.Add(c1_row.col[k], c1_row.value[k]);
+      } else {
+        base::SparseRow c2_row = s2.row(i);
+        for(int k=0; k<c2_row.size; k++)
+          c_s.Add(c1.n_out() + c2_row.col[k], c2_row.value[k]);
+      }
+      c_s.EndRow();
+    }
+    return Channel(std::move(c_s), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                   Alphabet::FromSymbols(new_output));
+  }
 
-  std::vector<std::string> input_names = c1.in_names();
+  const base::Matrix& c1_m = c1.c_matrix();
+  const base::Matrix& c2_m = c2.c_matrix();
 
+  base::Matrix c_m(c1.n_in(), c1.n_out() + c2.n_out());
   for(int i=0; i<c1.n_in(); i++) {
-    std::string x_name = input_names[i];
-    c_m[i].assign(c1.n_out() + c2.n_out(), 0);
+    const std::string& x_name = input_names[i];
+    double* c3_row = c_m.row(i).data();
     auto it = std::find(A.begin(), A.end(), x_name);
-    if(*it == x_name) 
-      for(int j=0; j<c1.n_out(); j++) 
-        c_m[i][j] = c1.c_matrix()[i][j];
+    if(it != A.end()) 
+      std::copy(c1_m[i].data(), c1_m[i].data() + c1.n_out(), c3_row);
     else 
-      for(int j=0; j<c2.n_out(); j++) 
-        c_m[i][c1.n_out() + j] = c2.c_matrix()[i][j];
+      std::copy(c2_m[i].data(), c2_m[i].data() + c2.n_out(),
+                c3_row + c1.n_out());
   }
-  Channel c3(c_m);
-  c3.set_in_names(input_names);
-  c3.set_out_names(new_output);
-  for(int i=0; i<(int)new_output.size(); i++)
-    c3.insert_out_index(new_output[i], i);
-  return c3; 
+  return Channel(std::move(c_m), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                 Alphabet::FromSymbols(new_output));
 }
 
 Channel Channel::hidden_conditional (const Channel& c1,
                                     std::vector<std::string> &A,
                                     const Channel& c2) {
 
-  std::vector<std::vector<double> > c_m(c1.n_in());
-  std::vector<std::vector<double> > c1_m = c1.c_matrix();
-  std::vector<std::vector<double> > c2_m = c2.c_matrix();
-
-  std::vector<std::string> c1_out = c1.out_names();
-  std::vector<std::string> c2_out = c2.out_names();
-
-  std::vector<std::string> union_out_names(c1_out);
-  union_out_names.insert(union_out_names.end(), c2_out.begin(), c2_out.end());
+  OutputUnion u = UnionOutputs(c1, c2);
+  std::unordered_set<std::string> in_A(A.begin(), A.end());
+
+  const std::vector<std::string>& input_names = c1.in_names();
+  if(c1.is_sparse() || c2.is_sparse()) {
+    base::SparseMatrix copy1, copy2;
+    const base::SparseMatrix& s1 = SparseForm(c1, &copy1);
+    const base::SparseMatrix& s2 = SparseForm(c2, &copy2);
+    base::SparseMatrix c_s(u.alphabet->size());
+    for(int i=0; i<c1.n_in(); i++) {
+      const bool from_c1 = in_A.count(input_names[i]) != 0;
+      base::SparseRow row = from_c1 ? s1.row(i) : s2.row(i);
+      const std::vector<int>& to = from_c1 ? u.from_c1 : u.from_c2;
+      for(int k=0; k<row.size; k++)
+        c_s.Add(to[row.col[k]], row.value[k]);
+      c_s.EndRow();
+    }
+    return Channel(std::move(c_s), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                   std::move(u.alphabet));
+  }
 
-  // Removing duplicates
-  sort(union_out_names.begin(), union_out_names.end());
-  union_out_names.erase( unique(union_out_names.begin(), union_out_names.end()), 
-                         union_out_names.end());
-
-  std::vector<std::string> input_names = c1.in_names();
-  int new_output_size = union_out_names.size();
-  for(unsigned i=0; i<input_names.size(); i++) {
-    std::string x_name = input_names[i];
-    c_m[i].assign(new_output_size, 0);
-    auto it = std::find(A.begin(), A.end(), x_name);
+  const base::Matrix& c1_m = c1.c_matrix();
+  const base::Matrix& c2_m = c2.c_matrix();
+  base::Matrix c_m(c1.n_in(), u.alphabet->size());
+  for(int i=0; i<c1.n_in(); i++) {
+    double* c3_row = c_m.row(i).data();
     // C1
-    if(*it == x_name) {
-      int c3_output_pos = 0;
-      int c1_output_pos = 0;
-      while(c1_output_pos < c1.n_out()) {
-        if(c1_out[c1_output_pos] == union_out_names[c3_output_pos]) {
-          c_m[i][c3_output_pos] = c1_m[i][c1_output_pos];
-          c1_output_pos++;
-        }
-        c3_output_pos++;
-      }
+    if(in_A.count(input_names[i])) {
+      const double* c1_row = c1_m.row(i).data();
+      for(int j=0; j<c1.n_out(); j++)
+        c3_row[u.from_c1[j]] = c1_row[j];
     }
     // C2
     else {
-      int c3_output_pos = 0;
-      int c2_output_pos = 0;
-      while(c2_output_pos < c2.n_out()) {
-        if(c2_out[c2_output_pos] == union_out_names[c3_output_pos]) {
-          c_m[i][c3_output_pos] = c2_m[i][c2_output_pos];
-          c2_output_pos++;
-        }
-        c3_output_pos++;
-      }
+      const double* c2_row = c2_m.row(i).data();
+      for(int j=0; j<c2.n_out(); j++)
+        c3_row[u.from_c2[j]] = c2_row[j];
     }
   }
 
-  Channel c3(c_m);
-  c3.set_in_names(input_names);
-  c3.set_out_names(union_out_names);
-  for(int i=0; i<(int)union_out_names.size(); i++)
-    c3.insert_out_index(union_out_names[i], i);
-  return c3; 
+  return Channel(std::move(c_m), UniformPrior(c1.n_in()), c1.in_alphabet(),
+                 std::move(u.alphabet));
 }
 
 
+void Channel::Identity() {
+  base::SparseMatrix c_matrix(this->n_in_);
+  for(int i = 0; i < this->n_in_; i++) {
+    c_matrix.Add(i, 1);
+    c_matrix.EndRow();
+  }
+  this->build_channel(std::move(c_matrix), this->prior_distribution_);
+  this->set_out_alphabet(this->in_alphabet_);
+}
+
 // This function randomizes the current channel.
 // Maintaining the channel dimensions.
-void Channel::Randomize() {
-  // RNG
-  std::mt19937 rng;
-  rng.seed(std::random_device()());
-  std::uniform_int_distribution<std::mt19937::result_type> dist(0,1000);
+void Channel::Randomize(base::Rng* rng) {
+  base::Rng& random = rng ? *rng : base::ThreadRng();
+  this->make_dense();
 
   this->base_norm_ = 0;
   this->prior_distribution_.assign(this->n_in_, 0);
   for(int i = 0; i < this->n_in_; i++) {
     for(int j = 0; j < this->n_out_; j++) {
-      int neue = dist(rng);
+      int neue = random.UniformInt(0, 1000);
       this->base_norm_ += neue;
       this->c_matrix_[i][j] = neue;
       this->prior_distribution_[i] += neue;
@@ -491,17 +834,18 @@ void Channel::Randomize() {
     this->prior_distribution_[i] /= this->base_norm_;
   }
 
-  this->build_channel(this->c_matrix_, this->prior_distribution_);
+  // The matrix and the prior were generated in place.
+  this->invalidate_derived();
 }
 ////////////////
 // We now define some compositional bounds
 ////////////////
-// Upper and Lower bounds
-std::pair<double, double> 
-  Channel::parallel_vulnerability(const Channel& c1, const Channel& c2,
-                                  std::vector<double> prior,
-                                  std::vector<std::vector<double>> &g) {
+namespace {
 
+// The bounds of parallel_vulnerability, given V_g of both channels.
+std::pair<double, double> ParallelBounds(const Channel& c1, const Channel& c2,
+                                         const std::vector<bool>& has_gain,
+                                         const double v_c1, const double v_c2) {
   double lower, upper;
   double upper_c1 = 0.0, upper_c2 = 0.0;
 
@@ -509,46 +853,83 @@ std::pair<double, double>
   for(int y=0; y<c2.n_out(); y++) {
     double max_ = 0.0;
     for(int x=0; x<c2.n_in(); x++) {
-      double check = 0.0;
-      for(int w=0; w<g.size(); w++)
-        check += g[w][x];
-      if(check == 0.0)
+      if(!has_gain[x])
         continue;
       max_ = std::max(max_, c2.c_matrix()[x][y]);
     }
     upper_c1 += max_;
   }
-  upper_c1 *= c1.PostGVun(prior, g);
+  upper_c1 *= v_c1;
   
   // Upper Bound second term
   for(int y=0; y<c1.n_out(); y++) {
     double max_ = 0.0;
     for(int x=0; x<c1.n_in(); x++) {
-      double check = 0.0;
-      for(int w=0; w<g.size(); w++)
-        check += g[w][x];
-      if(check == 0.0)
+      if(!has_gain[x])
         continue;
       max_ = std::max(max_, c1.c_matrix()[x][y]);
     }
     upper_c2 += max_;
   }
-  upper_c2 *= c2.PostGVun(prior, g);
+  upper_c2 *= v_c2;
 
-  lower = std::max(c1.PostGVun(prior, g), c2.PostGVun(prior, g));
+  lower = std::max(v_c1, v_c2);
   upper = std::min(upper_c1, upper_c2);
 
   return std::pair<double, double>(lower, upper);
 }
 
+} // namespace
+
+// Upper and Lower bounds
+std::pair<double, double> 
+  Channel::parallel_vulnerability(const Channel& c1, const Channel& c2,
+                                  const std::vector<double> &prior,
+                                  std::vector<std::vector<double>> &g) {
+
+  // Secrets that no guess gains anything from do not count in the bounds.
+  std::vector<bool> has_gain(c1.n_in(), false);
+  for(int x=0; x<c1.n_in(); x++) {
+    double check = 0.0;
+    for(int w=0; w<g.size(); w++)
+      check += g[w][x];
+    has_gain[x] = (check != 0.0);
+  }
+  return ParallelBounds(c1, c2, has_gain,
+                        c1.PostGVun(prior, g), c2.PostGVun(prior, g));
+}
+
+std::pair<double, double> 
+  Channel::parallel_vulnerability(const Channel& c1, const Channel& c2,
+                                  const std::vector<double> &prior,
+                                  const vulnerability::GainFunction &g) {
+  std::vector<bool> has_gain(c1.n_in(), false);
+  for(int x=0; x<c1.n_in(); x++)
+    has_gain[x] = g.HasGain(x);
+  return ParallelBounds(c1, c2, has_gain,
+                        c1.PostGVun(prior, g), c2.PostGVun(prior, g));
+}
+
 std::pair<double, double> 
   Channel::hidden_choice_vulnerability(const Channel& c1,
                               const Channel& c2,
                               const double prob,
                               std::vector<std::vector<double>> &g) {
   double lower, upper;
-  lower = std::max( prob*c1.PostGVun(g), (1-prob)*c2.PostGVun(g) );
-  upper = prob*c1.PostGVun(g) + (1 - prob)*c2.PostGVun(g);
+  const double v_c1 = c1.PostGVun(g), v_c2 = c2.PostGVun(g);
+  lower = std::max( prob*v_c1, (1-prob)*v_c2 );
+  upper = prob*v_c1 + (1 - prob)*v_c2;
+  return std::pair<double, double>(lower, upper);
+}
+std::pair<double, double> 
+  Channel::hidden_choice_vulnerability(const Channel& c1,
+                              const Channel& c2,
+                              const double prob,
+                              const vulnerability::GainFunction &g) {
+  double lower, upper;
+  const double v_c1 = c1.PostGVun(g), v_c2 = c2.PostGVun(g);
+  lower = std::max( prob*v_c1, (1-prob)*v_c2 );
+  upper = prob*v_c1 + (1 - prob)*v_c2;
   return std::pair<double, double>(lower, upper);
 }
 std::pair<double, double>
@@ -576,8 +957,10 @@ std::pair<double, double>
     for(int i=0; i<not_A_g[pos].size(); i++)
       not_A_g[pos][i] = 0.0;
   }
-  lower = std::max(c1.PostGVun(prior, A_g), c2.PostGVun(prior, not_A_g)); 
-  upper = c1.PostGVun(prior, A_g) + c2.PostGVun(prior, not_A_g);
+  const double v_c1 = c1.PostGVun(prior, A_g);
+  const double v_c2 = c2.PostGVun(prior, not_A_g);
+  lower = std::max(v_c1, v_c2);
+  upper = v_c1 + v_c2;
   return std::pair<double, double>(lower, upper);
 }
 // Linear Bounds
@@ -588,6 +971,13 @@ double
                                         std::vector<std::vector<double>> &g) {
     return ((prob * c1.PostGVun(g)) + ((1.0 - prob) * c2.PostGVun(g)));
 }
+double 
+  Channel::visible_choice_vulnerability(const Channel& c1,
+                                        const Channel& c2,
+                                        const double prob,
+                                        const vulnerability::GainFunction &g) {
+    return ((prob * c1.PostGVun(g)) + ((1.0 - prob) * c2.PostGVun(g)));
+}
 
 //double 
 //  Channel::visible_conditional (const Channel& c1,
@@ -600,63 +990,34 @@ double
 // We now define some metrics
 ////////////////
 double Channel::ShannonEntropyOut() const {
-  double entropy = 0;
-  for(int i = 0; i < this->n_out_; i++) {
-    if(this->out_distribution_[i] != 0)
-      entropy += (this->out_distribution_[i]*log2(1.0f/this->out_distribution_[i]));
-  }
-  return entropy;
+  return base::Entropy(this->out_distribution().data(), this->n_out_);
 }
 
-// H(X|Y)
+// H(X|Y) = H(X, Y) - H(Y)
 double Channel::ConditionalEntropyHyper() const {
-  double entropy = 0;
-  for(int j = 0; j < this->n_out_; j++) {
-    double conditional_entropy_X = 0;
-    for(int i = 0; i < this->n_in_; i++) {
-      if(this->h_matrix_[i][j] != 0)
-        conditional_entropy_X += (this->h_matrix_[i][j] * log2(1.0f/this->h_matrix_[i][j]));
-    }
-    entropy += (this->out_distribution_[j] * conditional_entropy_X);
-  }
-  return entropy;
+  return this->JointEntropy() - this->ShannonEntropyOut();
 }
 
 
 // H(Y|X)
 double Channel::ConditionalEntropy() const {
+  this->build_entropy();
   double entropy = 0;
-  for(int i = 0; i < this->n_in_; i++) {
-    double conditional_entropy_Y = 0;
-    for(int j = 0; j < this->n_out_; j++) {
-      if(this->c_matrix_[i][j] != 0)
-        conditional_entropy_Y += (this->c_matrix_[i][j] * log2(1.0f/this->c_matrix_[i][j]));
-    }
-    entropy += (this->prior_distribution_[i] * conditional_entropy_Y);
-  }
+  for(int i = 0; i < this->n_in_; i++)
+    entropy += (this->prior_distribution_[i] * this->row_entropy_[i]);
   return entropy;
-
 }
 
 double Channel::JointEntropy() const {
+  this->build_entropy();
   double entropy = 0;
-  for(int i = 0; i < this->n_in_; i++) {
-    for(int j = 0; j < this->n_out_; j++) {
-      if(this->j_matrix_[i][j] != 0)
-        entropy += (this->j_matrix_[i][j]*log2(1.0f/this->j_matrix_[i][j]));
-    }
-  }
+  for(int i = 0; i < this->n_in_; i++)
+    entropy += this->joint_row_entropy_[i];
   return entropy;
 }
 
 double Channel::GuessingEntropy() const {
-  double entropy = 0;
-  std::vector<double> v = this->prior_distribution_;
-  std::sort(v.begin(),v.end());
-  std::reverse(v.begin(), v.end());
-  for(int i = 1; i <= this->n_in_; i++)
-    entropy += (i*v[i-1]);
-  return entropy;
+  return base::DistributionView(this->prior_distribution_).GuessingEntropy();
 }
 
 // 
@@ -664,88 +1025,56 @@ double Channel::MutualInformation() const {
   return (this->ShannonEntropyPrior() - this->ConditionalEntropyHyper());
 }
 
+// H(X) and H(Y) are computed once each; see channel_metrics.h for all
+// the metrics in one traversal.
 double Channel::NormalizedMutualInformation() const {
-  return this->MutualInformation() / sqrt(this->ShannonEntropyPrior()*this->ShannonEntropyOut());
+  const double hx = this->ShannonEntropyPrior(), hy = this->ShannonEntropyOut();
+  const double mutual_information = hx - (this->JointEntropy() - hy);
+  return mutual_information / sqrt(hx*hy);
 }
 
 double Channel::SymmetricUncertainty() const {
-  return 2*this->MutualInformation() / (this->ShannonEntropyPrior() + this->ShannonEntropyOut());
+  const double hx = this->ShannonEntropyPrior(), hy = this->ShannonEntropyOut();
+  const double mutual_information = hx - (this->JointEntropy() - hy);
+  return 2*mutual_information / (hx + hy);
 }
 
-double Channel::PriorGVun(std::vector<std::vector<double> > g) const {
-	double max_ = 0;
-	for(int w_i = 0; w_i<(int)g.size(); w_i++) {
-		double max_w = 0;
-		for(int x_i = 0; x_i<this->n_in(); x_i++) {
-			max_w += this->prior_distribution()[x_i] * g[w_i][x_i];
-		}
-		max_ = std::max(max_, max_w);
-	}
-	return max_;
+// See vulnerability/gvulnerability.h for the batched versions.
+double Channel::PriorGVun(const std::vector<std::vector<double> > &g) const {
+	return vulnerability::PriorGVulnerability(g, this->prior_distribution_);
 }
 
 double Channel::PostGVun(const std::vector<std::vector<double> > &g) const {
-	double sum_ = 0;
-	for(int y_i = 0; y_i<this->n_out(); y_i++) {
-		double max_w = 0;
-		for(int w_i = 0; w_i<(int)g.size(); w_i++) {
-			double new_max_w = 0;
-			for(int x_i = 0; x_i<this->n_in(); x_i++) {
-				new_max_w += this->prior_distribution()[x_i] * 
-					this->c_matrix()[x_i][y_i] * g[w_i][x_i];
-			}
-			max_w = std::max(max_w, new_max_w);
-		}
-		sum_ += max_w;
-	}
-	return sum_;
+	return this->PostGVun(this->prior_distribution_, g);
 }
 
 double Channel::PostGVun(const std::vector<double> &prior_distribution,
                          const std::vector<std::vector<double> > &g) const {
-	double sum_ = 0;
-	for(int y_i = 0; y_i<this->n_out(); y_i++) {
-		double max_w = 0;
-		for(int w_i = 0; w_i<(int)g.size(); w_i++) {
-			double new_max_w = 0;
-			for(int x_i = 0; x_i<this->n_in(); x_i++) {
-				new_max_w += prior_distribution[x_i] * 
-					           this->c_matrix()[x_i][y_i] * g[w_i][x_i];
-			}
-			max_w = std::max(max_w, new_max_w);
-		}
-		sum_ += max_w;
-	}
-	return sum_;
+	if(this->sparse_)
+		return vulnerability::PostGVulnerability(this->c_sparse_, g,
+		                                         prior_distribution);
+	return vulnerability::PostGVulnerability(this->c_matrix_, g,
+	                                         prior_distribution);
 }
 
-void Channel::setup_default_names() {
-  int input_size = this->n_in(), output_size = this->n_out();
-  std::vector<std::string> input, output;
-
-  for(int i=0; i<input_size; i++)
-    input.push_back("x" + std::to_string(i));
-
-  for(int i=0; i<output_size; i++) {
-    std::string num = std::to_string(i);
-
-    while(num.size() < std::to_string(output_size).size())
-      num = "0" + num;
-
-    output.push_back("y" + num);
-  }
+double Channel::PriorGVun(const vulnerability::GainFunction &g) const {
+  return g.PriorVulnerability(this->prior_distribution_);
+}
 
-  this->set_in_names(input);
-  this->set_out_names(output);
+double Channel::PostGVun(const vulnerability::GainFunction &g) const {
+  return this->PostGVun(this->prior_distribution_, g);
+}
 
-  this->setup_in_out_map();
+double Channel::PostGVun(const std::vector<double> &prior_distribution,
+                         const vulnerability::GainFunction &g) const {
+  if(this->sparse_)
+    return g.PostVulnerability(this->c_sparse_, prior_distribution);
+  return g.PostVulnerability(this->c_matrix_, prior_distribution);
 }
 
-void Channel::setup_in_out_map() {
-  int input_size = this->n_in(), output_size = this->n_out();
-  for(int i=0; i<input_size; i++)
-    this->insert_in_index(this->in_names()[i], i);
-  for(int i=0; i<output_size; i++) 
-    this->insert_out_index(this->out_names()[i], i);
+void Channel::setup_default_names() {
+  // Default alphabets are shared by every channel of the same size.
+  this->set_in_alphabet(Alphabet::Default("x", this->n_in(), false));
+  this->set_out_alphabet(Alphabet::Default("y", this->n_out(), true));
 }
 }  // namespace channel
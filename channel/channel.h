@@ -4,11 +4,27 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <utility>
 
 #include <iostream>
 
+#include "alphabet.h"
+#include "../base/matrix.h"
+#include "../base/random.h"
+#include "../base/sparse_matrix.h"
+
 namespace channel {
 
+namespace vulnerability {
+class GainFunction;
+}
+
+// Channel matrices with at most this share of nonzero entries are stored
+// in sparse form. A nonzero takes 12 bytes in sparse form instead of 8,
+// and is read through its column, so below a quarter the sparse form is
+// both smaller and faster to walk.
+const double kSparseDensity = 0.25;
+
 class Channel {
   public:
     Channel(int n_in=2, int n_out=2);
@@ -23,6 +39,32 @@ class Channel {
             std::vector<double> prior_distribution,
             int base_norm=0);
 
+    // These take the matrix by value, so a freshly built matrix can be
+    // moved in without being copied.
+    explicit Channel(base::Matrix c_matrix, int base_norm=0);
+
+    Channel(base::Matrix c_matrix,
+            std::vector<double> prior_distribution,
+            int base_norm=0);
+
+    explicit Channel(base::SparseMatrix c_matrix, int base_norm=0);
+
+    Channel(base::SparseMatrix c_matrix,
+            std::vector<double> prior_distribution,
+            int base_norm=0);
+
+    // Over the given names, for the callers that name the channel
+    // themselves; the default names are not built.
+    Channel(base::Matrix c_matrix,
+            std::vector<double> prior_distribution,
+            Alphabet::Ptr in_alphabet, Alphabet::Ptr out_alphabet,
+            int base_norm=0);
+
+    Channel(base::SparseMatrix c_matrix,
+            std::vector<double> prior_distribution,
+            Alphabet::Ptr in_alphabet, Alphabet::Ptr out_alphabet,
+            int base_norm=0);
+
     std::string cname() const {
       return this->cname_;
     }
@@ -40,92 +82,164 @@ class Channel {
       return this->n_out_;
     }
 
-    void set_in_names(std::vector<std::string> in_names) {
-      this->in_names_ = in_names;
+    // The common denominator of the entries, when they are fractions of
+    // integers; 0 if unknown.
+    int base_norm() const {
+      return this->base_norm_;
+    }
+
+    void set_in_names(const std::vector<std::string>& in_names) {
+      this->in_alphabet_ = Alphabet::Make(in_names);
+    }
+
+    void set_out_names(const std::vector<std::string>& out_names) {
+      this->out_alphabet_ = Alphabet::Make(out_names);
+    }
+
+    // Channels over the same names share the same Alphabet object,
+    // so passing names around is just copying a pointer.
+    void set_in_alphabet(Alphabet::Ptr in_alphabet) {
+      this->in_alphabet_ = std::move(in_alphabet);
+    }
+
+    void set_out_alphabet(Alphabet::Ptr out_alphabet) {
+      this->out_alphabet_ = std::move(out_alphabet);
     }
 
-    void set_out_names(std::vector<std::string> out_names) {
-      this->out_names_ = out_names;
+    const Alphabet::Ptr& in_alphabet() const {
+      return this->in_alphabet_;
     }
 
-    std::vector<std::string> in_names() const {
-      return this->in_names_;
+    const Alphabet::Ptr& out_alphabet() const {
+      return this->out_alphabet_;
     }
 
-    std::vector<std::string> out_names() const {
-      return this->out_names_;
+    const std::vector<std::string>& in_names() const {
+      return this->in_alphabet_->names();
+    }
+
+    const std::vector<std::string>& out_names() const {
+      return this->out_alphabet_->names();
     }
 
     const std::vector<double>& prior_distribution() const {
       return this->prior_distribution_;
     }
 
+    // Replaces the prior, keeping the channel matrix.
+    void set_prior_distribution(std::vector<double> prior_distribution);
+
+    // Replaces row [x] of the channel matrix, keeping the prior.
+    // A sparse channel is made dense first.
+    // The derived quantities that are up to date are updated rather than
+    // dropped: row x of j_matrix and its entropy terms, and the columns of
+    // out_distribution, max_poutput and h_matrix whose entry changed.
+    // That is O(n_out) plus O(n_in) per changed column, instead of a full
+    // O(n_in * n_out) rebuild, and gives the same values as a rebuild.
+    void set_row(int x, const double* row);
+    void set_row(int x, const std::vector<double>& row) {
+      this->set_row(x, row.data());
+    }
+
+    // The quantities below are derived from c_matrix and the prior.
+    // They are only computed the first time someone asks for them,
+    // and are dropped whenever the matrix or the prior change.
+    // Note: because of that, the first call on a shared channel must not
+    //       race with another one from a different thread.
     const std::vector<double>& out_distribution() const {
+      this->build_derived();
       return this->out_distribution_;
     }
 
     const std::vector<double>& max_pinput() const {
+      this->build_derived();
       return this->max_pinput_;
     }
 
     const std::vector<double>& max_poutput() const {
+      this->build_derived();
       return this->max_poutput_;
     }
 
-    const std::map<std::string,int>& pos_in_names() const {
-      return this->pos_in_names_;
+    // The channel matrix is stored in one of two forms. Matrices with at
+    // most kSparseDensity of their entries nonzero (identities, most
+    // deterministic channels, parallel compositions of those) are kept
+    // as a base::SparseMatrix, and the rest as a dense base::Matrix. The
+    // choice is made whenever the matrix is replaced.
+    //
+    // On a sparse channel the derived vectors, the Shannon and Bayes
+    // metrics, PostGVun and the composition operators take time
+    // proportional to the nonzeros. c_matrix, j_matrix and h_matrix are
+    // dense, and are only built if someone asks for them.
+    bool is_sparse() const {
+      return this->sparse_;
     }
 
-    const std::map<std::string,int>& pos_out_names() const {
-      return this->pos_out_names_;
-    }
+    // Forces one of the forms, until the matrix is replaced.
+    void set_sparse(bool sparse);
 
-    const std::vector<std::vector<double> >& c_matrix() const {
+    const base::Matrix& c_matrix() const {
+        this->build_dense();
         return this->c_matrix_;
     }
 
-    const std::vector<std::vector<double> >& j_matrix() const {
+    // The channel matrix in sparse form; built on first use if the
+    // channel is dense.
+    const base::SparseMatrix& c_sparse() const {
+        this->build_sparse();
+        return this->c_sparse_;
+    }
+
+    const base::Matrix& j_matrix() const {
+        this->build_joint();
         return this->j_matrix_;
     }
     
-    const std::vector<std::vector<double> >& h_matrix() const {
+    const base::Matrix& h_matrix() const {
+        this->build_hyper();
         return this->h_matrix_;
     }
 
-    const int in_index(std::string s) const {
-        return this->pos_in_names_.at(s);
-    }
-
-    const int out_index(std::string s) const {
-        return this->pos_out_names_.at(s);
-    }
-
-    void insert_in_index(std::string s, int i) {
-        this->pos_in_names_[s] = i;
+    // These functions map a name to its index.
+    // They throw std::out_of_range for unknown names.
+    int in_index(const std::string& s) const {
+        return this->in_alphabet_->index(s);
     }
 
-    void insert_out_index(std::string s, int i) {
-        this->pos_out_names_[s] = i;
+    int out_index(const std::string& s) const {
+        return this->out_alphabet_->index(s);
     }
 
-    // This function parses a channel string.
+    // This function parses a channel string, in the format of to_string.
+    // Throws ParseError (see channel_parser.h) for malformed input.
     void ParseInput(std::string input_str);
 
-    // This function parses a channel file.
+    // This function parses a channel file. Throws std::runtime_error if
+    // the file can not be read, and ParseError for malformed input.
     void ParseFile(std::string fname);
 
     // This function resets the class to an initial state.
     void Reset();
 
-    // Make identity channel
+    // Makes this channel the identity on its inputs, keeping the prior.
+    // The outputs take the names of the inputs. See DeterministicChannel
+    // for a deterministic channel that is kept as a map.
     void Identity();
 
+    // This function randomizes the current channel, maintaining its
+    // dimensions: the joint counts are drawn uniformly from [0, 1000],
+    // and both the prior and the matrix follow from them. It draws from
+    // [rng], or from the generator of the calling thread by default (see
+    // base::ThreadRng). For channels uniform on the simplex, see
+    // base::RandomStochasticMatrix.
+    void Randomize(base::Rng* rng=nullptr);
+
     // This function returns a string that represents the
     // current channel.
     std::string to_string() const;
 
     // Two channels are compatible if they have the same input set.
-    // This function checks that.
+    // This function checks that. It is O(1), see Alphabet.
     static bool CompatibleChannels(const Channel& c1, const Channel& c2);
 
 
@@ -135,6 +249,10 @@ class Channel {
 
     friend Channel operator* (const Channel& c1, const Channel& c2);
 
+    // Same as c1 * c2, splitting the rows of c1 among [threads] threads.
+    static Channel cascade (const Channel& c1, const Channel& c2,
+                            int threads=1);
+
     static Channel hidden_choice (const Channel& c1, const double prob, 
                                   const Channel& c2);
 
@@ -152,8 +270,12 @@ class Channel {
     // Upper n Lower Bounds
     static std::pair<double, double> 
       parallel_vulnerability (const Channel& c1, const Channel& c2,
-                              std::vector<double> prior,
+                              const std::vector<double> &prior,
                               std::vector<std::vector<double>> &g);
+    static std::pair<double, double> 
+      parallel_vulnerability (const Channel& c1, const Channel& c2,
+                              const std::vector<double> &prior,
+                              const vulnerability::GainFunction &g);
 
     // Linear Bounds
     static double 
@@ -162,11 +284,22 @@ class Channel {
                                     const double prob,
                                     std::vector<std::vector<double>> &g);
 
+    static double 
+      visible_choice_vulnerability (const Channel& c1,
+                                    const Channel& c2,
+                                    const double prob,
+                                    const vulnerability::GainFunction &g);
+
     static std::pair<double, double> 
       hidden_choice_vulnerability (const Channel& c1,
                                    const Channel& c2,
                                    const double prob,
                                    std::vector<std::vector<double>> &g);
+    static std::pair<double, double> 
+      hidden_choice_vulnerability (const Channel& c1,
+                                   const Channel& c2,
+                                   const double prob,
+                                   const vulnerability::GainFunction &g);
 
     static double 
       visible_conditional_vulnerability (const Channel& c1,
@@ -189,38 +322,59 @@ class Channel {
     double NormalizedMutualInformation() const;
     double SymmetricUncertainty() const;
     //double PriorGVun() const; // G_ID
-		double PriorGVun(std::vector<std::vector<double> > g) const;
+		double PriorGVun(const std::vector<std::vector<double> > &g) const;
     //double PostGVun() const; // G_ID
 		double PostGVun(const std::vector<std::vector<double> > &g) const;
 		double PostGVun(const std::vector<double> &prior_distribution, 
                     const std::vector<std::vector<double> > &g) const;
+    // The same, for gain functions that are not kept as dense matrices;
+    // see vulnerability/gain_function.h.
+    double PriorGVun(const vulnerability::GainFunction &g) const;
+    double PostGVun(const vulnerability::GainFunction &g) const;
+    double PostGVun(const std::vector<double> &prior_distribution,
+                    const vulnerability::GainFunction &g) const;
 
-    // Maps input/output names to their index
-    std::map<std::string, int> pos_in_names_, pos_out_names_;
   private:
     // Channel Name
     std::string cname_ = "";
 
     // This is the channel matrix. ( p(y|x) )
-    std::vector<std::vector<double> > c_matrix_;
+    // One of the two is the matrix, depending on sparse_; the other one
+    // is a copy, up to date if dense_ready_ or sparse_ready_ say so.
+    mutable base::Matrix c_matrix_;
+    mutable base::SparseMatrix c_sparse_;
+    bool sparse_ = false;
+    mutable bool dense_ready_ = true, sparse_ready_ = false;
 
     // This is the posterior probability matrix. ( hyper distribution p(x|y) )
-    std::vector<std::vector<double> > h_matrix_;
+    mutable base::Matrix h_matrix_;
 
     // This is the prior distribution.
     std::vector<double> prior_distribution_;
 
     // This is the output distribution.
-    std::vector<double> out_distribution_;
+    mutable std::vector<double> out_distribution_;
 
     // This is the joint matrix. ( p(x,y) )
-    std::vector<std::vector<double> > j_matrix_;
+    mutable base::Matrix j_matrix_;
 
     // The maximum p(x, y) per x; used by the bayes' metrics.
-    std::vector<double> max_pinput_;
+    mutable std::vector<double> max_pinput_;
 
     // The maximum p(x, y) per y; used by the bayes' metrics.
-    std::vector<double> max_poutput_;
+    mutable std::vector<double> max_poutput_;
+
+    // The entropy terms of each x: H(Y|X=x), and the share of x in the
+    // joint entropy, sum_y p(x, y) log2(1 / p(x, y)).
+    mutable std::vector<double> row_entropy_;
+    mutable std::vector<double> joint_row_entropy_;
+
+    // Whether the derived quantities above are up to date.
+    // derived_ready_ covers out_distribution and the max vectors, and on
+    // a dense channel j_matrix, which joint_ready_ covers on its own.
+    // hyper_ready_ covers h_matrix and entropy_ready_ the entropy terms.
+    mutable bool derived_ready_ = false, hyper_ready_ = false;
+    mutable bool entropy_ready_ = false, joint_ready_ = false;
 
     // These ints keep the number of input lines we have,
     // and the number of output lines.
@@ -229,21 +383,42 @@ class Channel {
     // This is the norm used to randomly generate the channel.
     int base_norm_;
 
-    // These vectors keep the names of each input line and
-    // each output line
-    std::vector<std::string> in_names_, out_names_;
+    // The names of each input line and each output line.
+    Alphabet::Ptr in_alphabet_, out_alphabet_;
 
-    // This function randomizes the current channel.
-    // Maintaining the channel dimensions.
-    void Randomize();
+    void build_channel(base::Matrix c_matrix);
 
-    void build_channel(std::vector<std::vector<double> > c_matrix);
-
-    void build_channel(std::vector<std::vector<double> > c_matrix,
+    void build_channel(base::Matrix c_matrix,
                         std::vector<double> prior_distribution);
 
+    void build_channel(base::SparseMatrix c_matrix,
+                       std::vector<double> prior_distribution);
+
+    // These functions build the form of the matrix that is not stored,
+    // if it is stale.
+    void build_dense() const;
+    void build_sparse() const;
+
+    // This function makes the dense form the stored one, for the
+    // functions that write the matrix in place, and drops the sparse
+    // copy.
+    void make_dense();
+
+    // These functions fill the derived quantities, if they are stale.
+    void build_derived() const;
+    void build_joint() const;
+    void build_hyper() const;
+    void build_entropy() const;
+
+    // These functions recompute the derived quantities of one row or one
+    // column, for set_row.
+    void update_row_entropy(int x) const;
+    void update_column(int y) const;
+
+    // This function marks every derived quantity as stale.
+    void invalidate_derived();
+
     void setup_default_names();
-    void setup_in_out_map();
 };
 
 } // namespace channel
@@ -0,0 +1,204 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "channel_file.h"
+
+namespace channel {
+
+namespace {
+
+const char kMagic[8] = {'Q', 'I', 'F', 'C', 'H', 'A', 'N', '\0'};
+const uint32_t kVersion = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  // 8 for doubles, 4 for floats.
+  uint32_t value_size;
+  int32_t n_in;
+  int32_t n_out;
+  int32_t base_norm;
+  uint32_t reserved;
+  // Where the values start, from the start of the file.
+  uint64_t values_offset;
+};
+
+void Fail(const std::string& path, const std::string& what) {
+  throw std::runtime_error("channel file " + path + ": " + what);
+}
+
+void WriteName(std::ofstream& f, const std::string& name) {
+  uint32_t size = name.size();
+  f.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  f.write(name.data(), size);
+}
+
+// Reads one name at [*offset], moving past it.
+std::string ReadName(const char* data, size_t size, size_t* offset,
+                     const std::string& path) {
+  uint32_t length;
+  if(size - *offset < sizeof(length)) Fail(path, "truncated names");
+  std::memcpy(&length, data + *offset, sizeof(length));
+  *offset += sizeof(length);
+  if(size - *offset < length) Fail(path, "truncated names");
+  std::string name(data + *offset, length);
+  *offset += length;
+  return name;
+}
+
+}  // namespace
+
+void WriteChannelFile(const Channel& channel, const std::string& path,
+                      ChannelFilePrecision precision) {
+  std::ofstream f(path, std::ios::binary | std::ios::trunc);
+  if(!f) Fail(path, "can not be opened for writing");
+
+  size_t names_size = sizeof(uint32_t) + channel.cname().size();
+  for(const std::string& name : channel.in_names())
+    names_size += sizeof(uint32_t) + name.size();
+  for(const std::string& name : channel.out_names())
+    names_size += sizeof(uint32_t) + name.size();
+
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.value_size =
+    (precision == ChannelFilePrecision::kFloat) ? sizeof(float) : sizeof(double);
+  header.n_in = channel.n_in();
+  header.n_out = channel.n_out();
+  header.base_norm = channel.base_norm();
+  header.reserved = 0;
+  header.values_offset = (sizeof(header) + names_size + 7) / 8 * 8;
+  f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  WriteName(f, channel.cname());
+  for(const std::string& name : channel.in_names()) WriteName(f, name);
+  for(const std::string& name : channel.out_names()) WriteName(f, name);
+  const char padding[8] = {0};
+  f.write(padding, header.values_offset - sizeof(header) - names_size);
+
+  // The matrix rows, then the prior.
+  std::vector<double> values(channel.c_matrix().data(),
+                             channel.c_matrix().data() +
+                             (size_t)channel.n_in() * channel.n_out());
+  values.insert(values.end(), channel.prior_distribution().begin(),
+                channel.prior_distribution().end());
+  if(precision == ChannelFilePrecision::kFloat) {
+    std::vector<float> floats(values.begin(), values.end());
+    f.write(reinterpret_cast<const char*>(floats.data()),
+            floats.size() * sizeof(float));
+  } else {
+    f.write(reinterpret_cast<const char*>(values.data()),
+            values.size() * sizeof(double));
+  }
+  if(!f) Fail(path, "write failed");
+}
+
+bool IsChannelFile(const std::string& path) {
+  std::ifstream f(path, std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return f.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+MappedChannel::MappedChannel(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) Fail(path, "can not be opened");
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileHeader)) {
+    close(fd);
+    Fail(path, "too short for a header");
+  }
+  this->size_ = st.st_size;
+  this->map_ = mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(this->map_ == MAP_FAILED) {
+    this->map_ = nullptr;
+    Fail(path, "can not be mapped");
+  }
+
+  // The destructor does not run if the constructor throws.
+  try {
+    const char* data = static_cast<const char*>(this->map_);
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if(std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+      Fail(path, "not a channel file");
+    if(header.version != kVersion)
+      Fail(path, "unsupported version " + std::to_string(header.version));
+    if(header.value_size != sizeof(double) && header.value_size != sizeof(float))
+      Fail(path, "unsupported value size");
+    if(header.n_in <= 0 || header.n_out <= 0)
+      Fail(path, "invalid dimensions");
+    this->n_in_ = header.n_in;
+    this->n_out_ = header.n_out;
+    this->base_norm_ = header.base_norm;
+
+    size_t offset = sizeof(header);
+    this->cname_ = ReadName(data, this->size_, &offset, path);
+
+    // Every name takes at least its length, so a header that claims more
+    // names or values than the file can hold fails before anything is
+    // allocated for them.
+    const uint64_t count = (uint64_t)this->n_in_ * this->n_out_ + this->n_in_;
+    const size_t left = this->size_ - offset;
+    if(((uint64_t)this->n_in_ + this->n_out_) * sizeof(uint32_t) > left)
+      Fail(path, "truncated names");
+    if(left / header.value_size < count)
+      Fail(path, "truncated values");
+
+    this->in_names_.resize(this->n_in_);
+    this->out_names_.resize(this->n_out_);
+    for(std::string& name : this->in_names_)
+      name = ReadName(data, this->size_, &offset, path);
+    for(std::string& name : this->out_names_)
+      name = ReadName(data, this->size_, &offset, path);
+
+    if(header.values_offset < offset || header.values_offset % 8 != 0 ||
+       header.values_offset > this->size_ ||
+       (this->size_ - header.values_offset) / header.value_size < count)
+      Fail(path, "truncated values");
+
+    const char* values = data + header.values_offset;
+    if(header.value_size == sizeof(double)) {
+      this->values_ = reinterpret_cast<const double*>(values);
+    } else {
+      const float* floats = reinterpret_cast<const float*>(values);
+      this->converted_.assign(floats, floats + count);
+      this->values_ = this->converted_.data();
+    }
+  } catch(...) {
+    munmap(this->map_, this->size_);
+    throw;
+  }
+}
+
+MappedChannel::~MappedChannel() {
+  munmap(this->map_, this->size_);
+}
+
+Channel MappedChannel::ToChannel() const {
+  base::Matrix c_matrix(this->n_in_, this->n_out_);
+  std::memcpy(c_matrix.data(), this->values_,
+              sizeof(double) * (size_t)this->n_in_ * this->n_out_);
+  std::vector<double> prior(this->prior_distribution(),
+                            this->prior_distribution() + this->n_in_);
+  Channel channel(std::move(c_matrix), std::move(prior),
+                  Alphabet::Make(this->in_names_),
+                  Alphabet::Make(this->out_names_), this->base_norm_);
+  channel.set_cname(this->cname_);
+  return channel;
+}
+
+Channel ReadChannelFile(const std::string& path) {
+  return MappedChannel(path).ToChannel();
+}
+
+} // namespace channel
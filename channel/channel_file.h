@@ -0,0 +1,91 @@
+#ifndef _channel_channel_file_h
+#define _channel_channel_file_h
+
+#include <string>
+#include <vector>
+
+#include "channel.h"
+#include "../base/matrix.h"
+
+namespace channel {
+
+// A binary file format for channels, much faster to load than the text
+// one of Channel::ParseFile and Channel::to_string. Files are written in
+// the byte order of the machine that writes them, and have:
+// - a fixed header: the magic "QIFCHAN", the version, the size of the
+//   stored values (8 for double, 4 for float), n_in, n_out, the base norm,
+//   and the offset of the values;
+// - the names: the channel name, then the input and output names, each
+//   one as a 32-bit length and its bytes;
+// - the values, aligned to 8 bytes: the channel matrix row by row, then
+//   the prior.
+// Every function here throws std::runtime_error for files that can not be
+// read or written, or are not valid channel files.
+
+enum class ChannelFilePrecision { kDouble, kFloat };
+
+// Writes [channel] to [path]. Floats halve the size of the values, at the
+// cost of their precision.
+void WriteChannelFile(const Channel& channel, const std::string& path,
+                      ChannelFilePrecision precision=ChannelFilePrecision::kDouble);
+
+// Returns true if [path] starts with the magic of a channel file.
+bool IsChannelFile(const std::string& path);
+
+// A channel file mapped into memory. The channel matrix and the prior of a
+// double file are read in place, without being copied, so a large channel
+// is available as soon as it is mapped; the pages are only read when they
+// are used. Float files are converted to doubles when opened.
+//
+// The views stay valid for as long as the MappedChannel lives. Any code
+// that takes a base::MatrixView (e.g. vulnerability::LeakageSweep or the
+// batched g-vulnerabilities) works on the mapping directly; ToChannel
+// copies it into a Channel, once, for everything else.
+class MappedChannel {
+  public:
+    explicit MappedChannel(const std::string& path);
+    ~MappedChannel();
+
+    MappedChannel(const MappedChannel&) = delete;
+    MappedChannel& operator=(const MappedChannel&) = delete;
+
+    const std::string& cname() const { return this->cname_; }
+    int n_in() const { return this->n_in_; }
+    int n_out() const { return this->n_out_; }
+    int base_norm() const { return this->base_norm_; }
+    const std::vector<std::string>& in_names() const { return this->in_names_; }
+    const std::vector<std::string>& out_names() const { return this->out_names_; }
+
+    base::MatrixView c_matrix() const {
+      return base::MatrixView(this->values_, this->n_in_, this->n_out_);
+    }
+
+    // [n_in] values.
+    const double* prior_distribution() const {
+      return this->values_ + (long long)this->n_in_ * this->n_out_;
+    }
+
+    // Copies the matrix, the prior and the names into a new Channel; only
+    // c_matrix() and prior_distribution() read the file in place.
+    Channel ToChannel() const;
+
+  private:
+    void* map_ = nullptr;
+    size_t size_ = 0;
+
+    std::string cname_;
+    int n_in_, n_out_, base_norm_;
+    std::vector<std::string> in_names_, out_names_;
+
+    // The matrix then the prior; in the mapping, or in converted_.
+    const double* values_ = nullptr;
+    std::vector<double> converted_;
+};
+
+// Reads a channel file into a Channel. The values are copied out of the
+// mapping; use MappedChannel to work on them in place.
+Channel ReadChannelFile(const std::string& path);
+
+} // namespace channel
+
+#endif
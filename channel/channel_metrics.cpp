@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "channel_metrics.h"
+#include "../base/vmath.h"
+
+namespace channel {
+
+namespace {
+
+typedef ChannelMetrics M;
+
+// What the selected fields need from the traversal.
+const unsigned kNeedPriorEntropy = M::kShannonEntropyPrior |
+    M::kMutualInformation | M::kNormalizedMutualInformation |
+    M::kSymmetricUncertainty;
+const unsigned kNeedRowEntropy = M::kConditionalEntropy;
+const unsigned kNeedJointEntropy = M::kConditionalEntropyHyper |
+    M::kJointEntropy | M::kMutualInformation |
+    M::kNormalizedMutualInformation | M::kSymmetricUncertainty;
+const unsigned kNeedOutEntropy = M::kShannonEntropyOut |
+    M::kConditionalEntropyHyper | M::kMutualInformation |
+    M::kNormalizedMutualInformation | M::kSymmetricUncertainty;
+const unsigned kNeedOut = kNeedOutEntropy | M::kBayesOut |
+    M::kBayesMaxPosterior | M::kBayesLeakageMultReversePosterior;
+const unsigned kNeedMaxOut = M::kBayesPosterior | M::kBayesMaxPosterior |
+    M::kBayesLeakageMultPosterior;
+const unsigned kNeedMaxIn = M::kBayesReversePosterior |
+    M::kBayesLeakageMultReversePosterior;
+const unsigned kNeedBayesPrior = M::kBayesPrior | M::kBayesLeakageMultPosterior;
+
+// The sums and maxima of one traversal, fed one nonzero entry of the
+// channel matrix at a time; the entropies are taken a row at a time.
+class Accumulator {
+  public:
+    Accumulator(int n_out, unsigned fields)
+        : row_entropy_(fields & kNeedRowEntropy),
+          joint_entropy_(fields & kNeedJointEntropy),
+          out_(fields & kNeedOut),
+          max_out_(fields & kNeedMaxOut),
+          max_in_(fields & kNeedMaxIn),
+          max_c_(fields & M::kBayesMaxReversePosterior) {
+      if(this->out_) this->out.assign(n_out, 0);
+      if(this->max_out_) this->max_out.assign(n_out, 0);
+    }
+
+    // [row] holds the [n] values of row x, or its nonzeros; p = pi(x).
+    void BeginRow(const double* row, int n, double p) {
+      this->p_ = p;
+      this->max_in = 0;
+      if(this->row_entropy_)
+        this->conditional_entropy += (p * base::Entropy(row, n));
+      if(this->joint_entropy_)
+        this->joint_entropy += base::Entropy(row, n, p);
+    }
+
+    // c = C[x][y] != 0.
+    void Add(int y, double c) {
+      const double joint = c * this->p_;
+      if(this->out_) this->out[y] += joint;
+      if(this->max_out_) this->max_out[y] = std::max(this->max_out[y], joint);
+      if(this->max_in_) this->max_in = std::max(this->max_in, joint);
+      if(this->max_c_) this->max_c = std::max(this->max_c, c);
+    }
+
+    void EndRow() {
+      this->reverse_posterior += this->max_in;
+    }
+
+    // p(y) and max_x p(x, y), if needed.
+    std::vector<double> out, max_out;
+    // Over the current row.
+    double max_in = 0;
+    // Over the rows so far.
+    double conditional_entropy = 0, joint_entropy = 0;
+    double reverse_posterior = 0, max_c = 0;
+
+  private:
+    const bool row_entropy_, joint_entropy_, out_, max_out_, max_in_, max_c_;
+    double p_ = 0;
+};
+
+} // namespace
+
+
+ChannelMetrics ComputeChannelMetrics(const Channel& channel,
+                                     unsigned fields) {
+  fields &= ChannelMetrics::kAll;
+  const std::vector<double>& prior = channel.prior_distribution();
+  const int n_in = channel.n_in(), n_out = channel.n_out();
+  Accumulator acc(n_out, fields);
+
+  // The zeros add nothing to the sums, nor to the maxima, nor to the
+  // entropies.
+  if(fields & ~(kNeedPriorEntropy | kNeedBayesPrior)) {
+    if(channel.is_sparse()) {
+      const base::SparseMatrix& c = channel.c_sparse();
+      for(int i = 0; i < n_in; i++) {
+        base::SparseRow row = c.row(i);
+        acc.BeginRow(row.value, row.size, prior[i]);
+        for(int k = 0; k < row.size; k++)
+          acc.Add(row.col[k], row.value[k]);
+        acc.EndRow();
+      }
+    } else {
+      const base::Matrix& c = channel.c_matrix();
+      for(int i = 0; i < n_in; i++) {
+        const double* row = c.row(i).data();
+        acc.BeginRow(row, n_out, prior[i]);
+        for(int j = 0; j < n_out; j++)
+          if(row[j] != 0) acc.Add(j, row[j]);
+        acc.EndRow();
+      }
+    }
+  }
+
+  double prior_entropy = 0, bayes_prior = 0;
+  if(fields & kNeedPriorEntropy)
+    prior_entropy = base::Entropy(prior.data(), n_in);
+  if(fields & kNeedBayesPrior) {
+    for(int i = 0; i < n_in; i++)
+      bayes_prior = std::max(bayes_prior, prior[i]);
+  }
+
+  double out_entropy = 0, bayes_out = 0, posterior = 0, max_posterior = 0;
+  if(fields & kNeedOutEntropy)
+    out_entropy = base::Entropy(acc.out.data(), acc.out.size());
+  for(int j = 0; j < (int)acc.out.size(); j++) {
+    const double out = acc.out[j];
+    bayes_out = std::max(bayes_out, out);
+    // max_x p(x|y) = max_x p(x, y) / p(y).
+    if((fields & M::kBayesMaxPosterior) && out != 0)
+      max_posterior = std::max(max_posterior, acc.max_out[j]/out);
+  }
+  for(double max_out : acc.max_out)
+    posterior += max_out;
+
+  ChannelMetrics m;
+  m.fields = fields;
+  const double hyper = acc.joint_entropy - out_entropy;
+  const double mutual_information = prior_entropy - hyper;
+  if(fields & M::kShannonEntropyPrior) m.shannon_entropy_prior = prior_entropy;
+  if(fields & M::kShannonEntropyOut) m.shannon_entropy_out = out_entropy;
+  if(fields & M::kConditionalEntropy)
+    m.conditional_entropy = acc.conditional_entropy;
+  if(fields & M::kConditionalEntropyHyper) m.conditional_entropy_hyper = hyper;
+  if(fields & M::kJointEntropy) m.joint_entropy = acc.joint_entropy;
+  if(fields & M::kMutualInformation) m.mutual_information = mutual_information;
+  if(fields & M::kNormalizedMutualInformation)
+    m.normalized_mutual_information =
+        mutual_information / sqrt(prior_entropy*out_entropy);
+  if(fields & M::kSymmetricUncertainty)
+    m.symmetric_uncertainty =
+        2*mutual_information / (prior_entropy + out_entropy);
+
+  if(fields & M::kBayesPrior) m.bayes_prior = bayes_prior;
+  if(fields & M::kBayesOut) m.bayes_out = bayes_out;
+  if(fields & M::kBayesPosterior) m.bayes_posterior = posterior;
+  if(fields & M::kBayesReversePosterior)
+    m.bayes_reverse_posterior = acc.reverse_posterior;
+  if(fields & M::kBayesMaxPosterior) m.bayes_max_posterior = max_posterior;
+  if(fields & M::kBayesMaxReversePosterior)
+    m.bayes_max_reverse_posterior = acc.max_c;
+  if(fields & M::kBayesLeakageMultPosterior)
+    m.bayes_leakage_mult_posterior = posterior / bayes_prior;
+  if(fields & M::kBayesLeakageMultReversePosterior)
+    m.bayes_leakage_mult_reverse_posterior = acc.reverse_posterior / bayes_out;
+  return m;
+}
+
+} // namespace channel
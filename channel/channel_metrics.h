@@ -0,0 +1,80 @@
+#ifndef _channel_channel_metrics_h
+#define _channel_channel_metrics_h
+
+#include "channel.h"
+
+namespace channel {
+
+// The Shannon and Bayes metrics of a channel, as given one by one by
+// Channel and vulnerability::Bayes.
+struct ChannelMetrics {
+  // The fields, as the bits of a mask.
+  enum Field : unsigned {
+    kShannonEntropyPrior = 1u << 0,
+    kShannonEntropyOut = 1u << 1,
+    kConditionalEntropy = 1u << 2,
+    kConditionalEntropyHyper = 1u << 3,
+    kJointEntropy = 1u << 4,
+    kMutualInformation = 1u << 5,
+    kNormalizedMutualInformation = 1u << 6,
+    kSymmetricUncertainty = 1u << 7,
+    kBayesPrior = 1u << 8,
+    kBayesOut = 1u << 9,
+    kBayesPosterior = 1u << 10,
+    kBayesReversePosterior = 1u << 11,
+    kBayesMaxPosterior = 1u << 12,
+    kBayesMaxReversePosterior = 1u << 13,
+    kBayesLeakageMultPosterior = 1u << 14,
+    kBayesLeakageMultReversePosterior = 1u << 15,
+
+    kShannon = (1u << 8) - 1,
+    kBayes = ((1u << 16) - 1) & ~((1u << 8) - 1),
+    kAll = (1u << 16) - 1,
+  };
+
+  // The fields that were computed; the others are 0.
+  unsigned fields = 0;
+
+  bool has(unsigned field) const {
+    return (this->fields & field) == field;
+  }
+
+  // H(X), H(Y), H(Y|X), H(X|Y), H(X, Y), I(X;Y), and the normalized
+  // mutual information and symmetric uncertainty.
+  double shannon_entropy_prior = 0;
+  double shannon_entropy_out = 0;
+  double conditional_entropy = 0;
+  double conditional_entropy_hyper = 0;
+  double joint_entropy = 0;
+  double mutual_information = 0;
+  double normalized_mutual_information = 0;
+  double symmetric_uncertainty = 0;
+
+  // V(X), V(Y), V(X|Y), V(Y|X), max_y V(X|Y=y), max_x V(Y|X=x), and
+  // V(X|Y) / V(X) and V(Y|X) / V(Y), for Bayes vulnerability.
+  double bayes_prior = 0;
+  double bayes_out = 0;
+  double bayes_posterior = 0;
+  double bayes_reverse_posterior = 0;
+  double bayes_max_posterior = 0;
+  double bayes_max_reverse_posterior = 0;
+  double bayes_leakage_mult_posterior = 0;
+  double bayes_leakage_mult_reverse_posterior = 0;
+};
+
+// Computes the [fields] of the metrics of [channel] in one traversal of
+// its matrix, from the channel matrix and the prior; the caches of the
+// channel are neither used nor filled. Each intermediate (the entropy of
+// the prior, p(y), the maxima of p(x, y)) is computed once, and only if
+// a selected field needs it; e.g. the logarithms are skipped when no
+// Shannon field is selected. Sparse channels are walked over their
+// nonzeros.
+//
+// The values are the ones of the Channel and Bayes functions, summed in
+// the same order.
+ChannelMetrics ComputeChannelMetrics(const Channel& channel,
+                                     unsigned fields=ChannelMetrics::kAll);
+
+} // namespace channel
+
+#endif
@@ -0,0 +1,382 @@
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <locale>
+#include <sstream>
+#include <vector>
+
+#include "channel_parser.h"
+#include "channel.h"
+#include "../base/matrix.h"
+
+namespace channel {
+
+namespace {
+
+struct Token {
+  const char* begin;
+  const char* end;
+  int line, column;
+
+  std::string str() const { return std::string(this->begin, this->end); }
+};
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+         c == '\v' || c == '\f';
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// The powers of ten that are exact doubles.
+const double kPowersOfTen[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Reads [begin, end) as a decimal number, e.g. 0.25, -1, 3.5e-2, and
+// returns false if it is not one. A mantissa of up to 2^53 with a power of
+// ten of up to 22 is converted with one exact multiplication or division,
+// so the result is correctly rounded; this covers every value written by
+// Channel::to_string. Longer numbers go to a stream in the classic locale.
+bool ParseDouble(const char* begin, const char* end, double* out) {
+  const char* p = begin;
+  bool negative = false;
+  if(p != end && (*p == '+' || *p == '-')) negative = (*p++ == '-');
+
+  uint64_t mantissa = 0;
+  int exponent = 0, digits = 0;
+  bool exact = true;
+  for(; p != end && IsDigit(*p); p++, digits++) {
+    if(mantissa < (1ULL << 53) / 10) {
+      mantissa = mantissa * 10 + (*p - '0');
+    } else {
+      // The digit is dropped, and the mantissa scaled instead.
+      exponent++;
+      if(*p != '0') exact = false;
+    }
+  }
+  if(p != end && *p == '.') {
+    for(p++; p != end && IsDigit(*p); p++, digits++) {
+      if(mantissa < (1ULL << 53) / 10) {
+        mantissa = mantissa * 10 + (*p - '0');
+        exponent--;
+      } else if(*p != '0') {
+        exact = false;
+      }
+    }
+  }
+  if(digits == 0) return false;
+
+  if(p != end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negative_exponent = false;
+    if(p != end && (*p == '+' || *p == '-'))
+      negative_exponent = (*p++ == '-');
+    if(p == end || !IsDigit(*p)) return false;
+    int e = 0;
+    for(; p != end && IsDigit(*p); p++)
+      if(e < 100000) e = e * 10 + (*p - '0');
+    exponent += negative_exponent ? -e : e;
+  }
+  if(p != end) return false;
+
+  if(exact && exponent >= -22 && exponent <= 22) {
+    double value = (double)mantissa;
+    if(exponent < 0) value /= kPowersOfTen[-exponent];
+    else value *= kPowersOfTen[exponent];
+    *out = negative ? -value : value;
+  } else {
+    std::istringstream stream(std::string(begin, end));
+    stream.imbue(std::locale::classic());
+    if(!(stream >> *out)) return false;
+  }
+  return std::isfinite(*out);
+}
+
+// Reads [begin, end) as a non-negative int.
+bool ParseInt(const char* begin, const char* end, int* out) {
+  if(begin == end) return false;
+  long long value = 0;
+  for(const char* p = begin; p != end; p++) {
+    if(!IsDigit(*p)) return false;
+    value = value * 10 + (*p - '0');
+    if(value > INT_MAX) return false;
+  }
+  *out = value;
+  return true;
+}
+
+// Reads the tokens of the input, left to right, keeping track of the line
+// and column. A copy of a cursor is a saved position.
+class Cursor {
+  public:
+    Cursor(const char* begin, const char* end)
+      : p_(begin), end_(end), line_start_(begin) {}
+
+    // Moves to the next token, and returns false at the end of the input.
+    bool Next(Token* token) {
+      this->SkipSpace();
+      if(this->p_ == this->end_) return false;
+      token->begin = this->p_;
+      token->line = this->line_;
+      token->column = this->p_ - this->line_start_ + 1;
+      while(this->p_ != this->end_ && !IsSpace(*this->p_)) this->p_++;
+      token->end = this->p_;
+      return true;
+    }
+
+    // The number of bytes left to read.
+    size_t Remaining() const {
+      return this->end_ - this->p_;
+    }
+
+    // The position of the end of the input.
+    void End(int* line, int* column) {
+      this->SkipSpace();
+      *line = this->line_;
+      *column = this->p_ - this->line_start_ + 1;
+    }
+
+  private:
+    void SkipSpace() {
+      for(; this->p_ != this->end_ && IsSpace(*this->p_); this->p_++) {
+        if(*this->p_ == '\n') {
+          this->line_++;
+          this->line_start_ = this->p_ + 1;
+        }
+      }
+    }
+
+    const char* p_;
+    const char* end_;
+    const char* line_start_;
+    int line_ = 1;
+};
+
+// The position of a token, for the errors found after it is read.
+struct Position {
+  int line = 0, column = 0;
+
+  Position() {}
+  explicit Position(const Token& token)
+    : line(token.line), column(token.column) {}
+};
+
+class Parser {
+  public:
+    Parser(const char* begin, const char* end, const std::string& source)
+      : cursor_(begin, end), source_(source) {}
+
+    Channel Parse();
+
+  private:
+    [[noreturn]] void Fail(const Position& at,
+                           const std::string& message) const {
+      throw ParseError(this->source_, at.line, at.column, message);
+    }
+
+    [[noreturn]] void Fail(const Token& token,
+                           const std::string& message) const {
+      this->Fail(Position(token), message);
+    }
+
+    [[noreturn]] void FailAtEnd(const std::string& message) {
+      Position end;
+      this->cursor_.End(&end.line, &end.column);
+      this->Fail(end, message);
+    }
+
+    int ReadInt(const Token& token, const char* what) const {
+      int value;
+      if(!ParseInt(token.begin, token.end, &value))
+        this->Fail(token, std::string("expected ") + what + ", got \"" +
+                          token.str() + "\"");
+      return value;
+    }
+
+    double ReadProbability(const Token& token) const {
+      double value;
+      if(!ParseDouble(token.begin, token.end, &value))
+        this->Fail(token, "expected a probability, got \"" + token.str() + "\"");
+      if(value < 0)
+        this->Fail(token, "negative probability " + token.str());
+      return value;
+    }
+
+    // Checks that the [n] values at [values], read from [at] on, sum to 1.
+    void CheckDistribution(const double* values, int n, const Position& at,
+                           const std::string& what) const {
+      double sum = 0;
+      for(int i = 0; i < n; i++) sum += values[i];
+      if(std::fabs(sum - 1) > kStochasticTolerance) {
+        std::ostringstream message;
+        message.imbue(std::locale::classic());
+        message << what << " sums to " << sum << ", not 1";
+        this->Fail(at, message.str());
+      }
+    }
+
+    Cursor cursor_;
+    const std::string& source_;
+};
+
+// The input is read once, token by token, and the numbers go straight into
+// the matrix. Only one question is left open along the way: whether the
+// base norm is there, which the format tells by the number of tokens. The
+// token after the names is the first probability without a base norm,
+// and the last output name with one; every token after it is a number
+// either way. So the tokens up to it are kept, the numbers after it are
+// stored one slot ahead of their place without a base norm, and moved
+// back by one, at the end, if there was a base norm.
+Channel Parser::Parse() {
+  Token first, second, third;
+  if(!this->cursor_.Next(&first)) this->FailAtEnd("empty channel");
+
+  // The name is left out if the first line is "n_in n_out".
+  int unused;
+  std::string cname;
+  Token n_in_token = first, n_out_token;
+  Cursor after_first = this->cursor_;
+  const bool has_second = this->cursor_.Next(&second);
+  Cursor after_second = this->cursor_;
+  if(has_second && second.line == first.line &&
+     (!this->cursor_.Next(&third) || third.line != first.line) &&
+     ParseInt(first.begin, first.end, &unused) &&
+     ParseInt(second.begin, second.end, &unused)) {
+    n_out_token = second;
+    this->cursor_ = after_second;
+  } else {
+    cname = first.str();
+    this->cursor_ = after_first;
+    if(!this->cursor_.Next(&n_in_token) || !this->cursor_.Next(&n_out_token))
+      this->FailAtEnd("expected the channel dimensions");
+  }
+
+  const int n_in = this->ReadInt(n_in_token, "the number of inputs");
+  const int n_out = this->ReadInt(n_out_token, "the number of outputs");
+  if(n_in == 0) this->Fail(n_in_token, "the channel needs at least one input");
+  if(n_out == 0)
+    this->Fail(n_out_token, "the channel needs at least one output");
+
+  // Every name and number takes a byte and a separator, so dimensions
+  // that the rest of the input can not hold fail here, before anything is
+  // allocated for them.
+  const size_t names = (size_t)n_in + n_out;
+  const size_t cells = (size_t)n_in * n_out;
+  if(names + cells > (this->cursor_.Remaining() + 1) / 2)
+    this->Fail(n_in_token, "a " + n_in_token.str() + " x " +
+                           n_out_token.str() + " channel does not fit in "
+                           "the rest of the input");
+
+  // The tokens up to the one after the names, as [base norm,] names.
+  std::vector<Token> head(names + 1);
+  size_t left = 0;
+  while(left < head.size() && this->cursor_.Next(&head[left])) left++;
+
+  // The numbers after head, where number v goes to slot v + 1 of the
+  // matrix and then of tail. The rows and the prior start at a multiple
+  // of n_out of the numbers with a base norm, and one before without.
+  base::Matrix c_matrix(n_in, n_out);
+  double* flat = c_matrix.data();
+  std::vector<double> tail(n_in + 1);
+  std::vector<Position> starts_with(n_in + 1), starts_without(n_in + 1);
+  const size_t max_numbers = cells + n_in;
+  const size_t m = n_out;
+  Token token;
+  if(left == head.size()) {
+    for(size_t v = 0; this->cursor_.Next(&token); v++) {
+      if(v == max_numbers)
+        this->Fail(token, "unexpected \"" + token.str() +
+                          "\" after the prior");
+      const double value = this->ReadProbability(token);
+      if(v + 1 < cells) flat[v + 1] = value;
+      else tail[v + 1 - cells] = value;
+      if(v % m == 0 && v / m <= (size_t)n_in)
+        starts_with[v / m] = Position(token);
+      if(v % m == m - 1 && v / m < (size_t)n_in)
+        starts_without[v / m] = Position(token);
+      left++;
+    }
+  }
+
+  // The base norm and the prior are optional, and told apart by the
+  // number of values left.
+  bool has_base_norm, has_prior;
+  if(left == names + cells + n_in) {
+    has_base_norm = false;
+    has_prior = true;
+  } else if(left == names + cells + n_in + 1) {
+    has_base_norm = has_prior = true;
+  } else if(left == names + cells) {
+    has_base_norm = has_prior = false;
+  } else if(left == names + cells + 1) {
+    has_base_norm = true;
+    has_prior = false;
+  } else if(left < names + cells) {
+    this->FailAtEnd("unexpected end of input, a " + std::to_string(n_in) +
+                    "x" + std::to_string(n_out) + " channel needs " +
+                    std::to_string(names + cells - left) + " more values");
+  } else {
+    this->FailAtEnd("unexpected end of input, the prior needs " +
+                    std::to_string(n_in) + " values");
+  }
+
+  int base_norm = 0;
+  if(has_base_norm) base_norm = this->ReadInt(head[0], "the base norm");
+  const Token* name = has_base_norm ? &head[1] : &head[0];
+  std::vector<std::string> in_names(n_in), out_names(n_out);
+  for(std::string& in_name : in_names) in_name = (name++)->str();
+  for(std::string& out_name : out_names) out_name = (name++)->str();
+
+  // Where row i, and the prior (row n_in), start.
+  auto start = [&](int i) {
+    if(has_base_norm) return starts_with[i];
+    return i == 0 ? Position(head[names]) : starts_without[i - 1];
+  };
+  const double* prior_values;
+  if(has_base_norm) {
+    std::copy(flat + 1, flat + cells, flat);
+    flat[cells - 1] = tail[0];
+    prior_values = tail.data() + 1;
+  } else {
+    flat[0] = this->ReadProbability(head[names]);
+    prior_values = tail.data();
+  }
+  for(int i = 0; i < n_in; i++)
+    this->CheckDistribution(c_matrix.row(i).data(), n_out, start(i),
+                            "row " + std::to_string(i + 1) + " of the matrix");
+
+  // Without a prior, the prior is the one of Channel(base::Matrix).
+  std::vector<double> prior(n_in, 1.0f/n_in);
+  if(has_prior) {
+    prior.assign(prior_values, prior_values + n_in);
+    this->CheckDistribution(prior.data(), n_in, start(n_in), "the prior");
+  }
+  Channel channel(std::move(c_matrix), std::move(prior),
+                  Alphabet::Make(in_names), Alphabet::Make(out_names),
+                  base_norm);
+  channel.set_cname(cname);
+  return channel;
+}
+
+std::string Describe(const std::string& source, int line, int column,
+                     const std::string& message) {
+  return source + ":" + std::to_string(line) + ":" + std::to_string(column) +
+         ": " + message;
+}
+
+}  // namespace
+
+ParseError::ParseError(const std::string& source, int line, int column,
+                       const std::string& message)
+  : std::runtime_error(Describe(source, line, column, message)),
+    line_(line), column_(column) {}
+
+Channel ParseChannel(const char* begin, const char* end,
+                     const std::string& source) {
+  return Parser(begin, end, source).Parse();
+}
+
+} // namespace channel
@@ -0,0 +1,55 @@
+#ifndef _channel_channel_parser_h
+#define _channel_channel_parser_h
+
+#include <stdexcept>
+#include <string>
+
+namespace channel {
+
+class Channel;
+
+// Thrown for malformed channel text, with the position of the problem.
+class ParseError : public std::runtime_error {
+  public:
+    ParseError(const std::string& source, int line, int column,
+               const std::string& message);
+
+    // 1-based; the end of the input if the problem is missing data.
+    int line() const { return this->line_; }
+    int column() const { return this->column_; }
+
+  private:
+    int line_, column_;
+};
+
+// Parses a channel in the text format of Channel::to_string:
+//
+//   [name]
+//   n_in n_out
+//   [base_norm]
+//   n_in input names
+//   n_out output names
+//   n_in rows of n_out probabilities
+//   [n_in prior probabilities]
+//
+// Tokens are separated by any whitespace. The name is left out when the
+// first line is just two integers. The base norm and the prior are told
+// apart by the number of tokens; without a prior, the prior is uniform.
+// When a single-input channel could be read both ways, the last value is
+// taken as the prior, as the older files have no base norm.
+//
+// Numbers are read by hand, in one pass over the buffer and straight
+// into the matrix, and do not depend on the locale. Rows of the matrix, and the prior, must be
+// non-negative and sum to one within kStochasticTolerance, which
+// allows for values rounded to a few digits, e.g. six times 0.167.
+//
+// Throws ParseError, naming [source] and the line and column, for any
+// input that does not follow the format.
+Channel ParseChannel(const char* begin, const char* end,
+                     const std::string& source="<input>");
+
+const double kStochasticTolerance = 1e-2;
+
+} // namespace channel
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef _channel_count_evaluator_h
+#define _channel_count_evaluator_h
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "../base/vmath.h"
+
+namespace channel {
+
+// The metrics of a channel given as an NIn x NOut matrix of non-negative
+// integer counts, read row by row, whose joint distribution is
+// J(x, y) = counts(x, y) / total. When every row sums to the same base
+// norm N, that is the channel C = counts / N under a uniform prior, which
+// is what the brute-force searches enumerate.
+//
+// Everything lives on the stack and no Channel is built, so a search can
+// evaluate millions of candidates without touching the heap. The metrics
+// match the ones of Channel and vulnerability::Bayes on the same joint
+// distribution, up to rounding. The counts are copied, so they may change
+// after construction.
+template <int NIn, int NOut>
+class CountEvaluator {
+  public:
+    static const int kInputs = NIn;
+    static const int kOutputs = NOut;
+
+    explicit CountEvaluator(const int* counts) {
+      std::copy(counts, counts + NIn*NOut, this->counts_.begin());
+      this->row_sums_.fill(0);
+      this->column_sums_.fill(0);
+      this->total_ = 0;
+      for(int i = 0; i < NIn; i++) {
+        for(int j = 0; j < NOut; j++) {
+          int count = this->counts_[i*NOut + j];
+          this->row_sums_[i] += count;
+          this->column_sums_[j] += count;
+        }
+        this->total_ += this->row_sums_[i];
+      }
+    }
+
+    const std::array<int, NIn*NOut>& counts() const { return this->counts_; }
+    int total() const { return this->total_; }
+
+    // H(X)
+    double ShannonEntropyPrior() const {
+      return Entropy(this->row_sums_.data(), NIn);
+    }
+
+    // H(Y)
+    double ShannonEntropyOut() const {
+      return Entropy(this->column_sums_.data(), NOut);
+    }
+
+    // H(X, Y)
+    double JointEntropy() const {
+      return Entropy(this->counts_.data(), NIn*NOut);
+    }
+
+    // H(X|Y) = H(X, Y) - H(Y)
+    double ConditionalEntropyHyper() const {
+      return this->JointEntropy() - this->ShannonEntropyOut();
+    }
+
+    double MutualInformation() const {
+      return this->ShannonEntropyPrior() - this->ConditionalEntropyHyper();
+    }
+
+    // Each entropy is taken once, as in Channel.
+    double NormalizedMutualInformation() const {
+      const double hx = this->ShannonEntropyPrior();
+      const double hy = this->ShannonEntropyOut();
+      const double mutual_information = hx - (this->JointEntropy() - hy);
+      return mutual_information / std::sqrt(hx*hy);
+    }
+
+    // Bayes V(X|Y) / V(X) = sum_y max_x c_xy / max_x r_x, for the row
+    // sums r.
+    double LeakageMultPosterior() const {
+      int sum = 0;
+      for(int j = 0; j < NOut; j++) {
+        int best = 0;
+        for(int i = 0; i < NIn; i++)
+          best = std::max(best, this->counts_[i*NOut + j]);
+        sum += best;
+      }
+      return (double)sum / *std::max_element(this->row_sums_.begin(),
+                                             this->row_sums_.end());
+    }
+
+    // Bayes V(Y|X) / V(Y) = sum_x max_y c_xy / max_y s_y.
+    double LeakageMultReversePosterior() const {
+      int sum = 0;
+      for(int i = 0; i < NIn; i++)
+        sum += *std::max_element(&this->counts_[i*NOut],
+                                 &this->counts_[i*NOut] + NOut);
+      return (double)sum / *std::max_element(this->column_sums_.begin(),
+                                             this->column_sums_.end());
+    }
+
+  private:
+    // The entropy of the distribution counts / total, through the kernel
+    // of base/vmath.h.
+    double Entropy(const int* counts, int size) const {
+      std::array<double, NIn*NOut> p;
+      for(int k = 0; k < size; k++) p[k] = counts[k];
+      return base::Entropy(p.data(), size, 1.0 / this->total_);
+    }
+
+    std::array<int, NIn*NOut> counts_;
+    std::array<int, NIn> row_sums_;
+    std::array<int, NOut> column_sums_;
+    int total_;
+};
+
+} // namespace channel
+
+#endif
@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+#include "deterministic_channel.h"
+#include "../base/sparse_matrix.h"
+#include "../base/vmath.h"
+#include "vulnerability/gvulnerability.h"
+
+namespace channel {
+
+namespace {
+
+void Fail(const std::string& what) {
+  throw std::invalid_argument("DeterministicChannel: " + what);
+}
+
+std::vector<double> UniformPrior(int n) {
+  return std::vector<double>(n, 1.0/n);
+}
+
+// The uniform prior of Channel(base::SparseMatrix), for the compositions
+// with a Channel.
+std::vector<double> ChannelPrior(int n) {
+  return std::vector<double>(n, 1.0f/n);
+}
+
+double Entropy(const std::vector<double>& distribution) {
+  return base::Entropy(distribution.data(), distribution.size());
+}
+
+// The output of a deterministic row, or -1 if the row is not one.
+int RowOutput(const Channel& channel, int x) {
+  if(channel.is_sparse()) {
+    base::SparseRow row = channel.c_sparse().row(x);
+    return (row.size == 1 && row.value[0] == 1) ? row.col[0] : -1;
+  }
+  int y = -1;
+  const double* row = channel.c_matrix().row(x).data();
+  for(int j = 0; j < channel.n_out(); j++) {
+    if(row[j] == 0) continue;
+    if(row[j] != 1 || y != -1) return -1;
+    y = j;
+  }
+  return y;
+}
+
+// The sparse form of [c]; see the one in channel.cpp.
+const base::SparseMatrix& SparseForm(const Channel& c,
+                                     base::SparseMatrix* copy) {
+  if(c.is_sparse()) return c.c_sparse();
+  *copy = base::SparseMatrix::FromDense(c.c_matrix());
+  return *copy;
+}
+
+void CheckCompatible(const Alphabet::Ptr& in1, const Alphabet::Ptr& in2) {
+  if(!Alphabet::Same(in1, in2)) Fail("channels not compatible");
+}
+
+}  // namespace
+
+DeterministicChannel::DeterministicChannel(std::vector<int> map, int n_out)
+  : DeterministicChannel(map, n_out, UniformPrior(map.size())) {}
+
+DeterministicChannel::DeterministicChannel(std::vector<int> map, int n_out,
+                                           std::vector<double> prior_distribution)
+  : map_(std::move(map)), n_out_(n_out) {
+  for(int y : this->map_)
+    if(y < 0 || y >= n_out) Fail("output out of range");
+  this->set_prior_distribution(std::move(prior_distribution));
+}
+
+DeterministicChannel::DeterministicChannel(const Channel& channel)
+  : cname_(channel.cname()), map_(channel.n_in()), n_out_(channel.n_out()),
+    prior_distribution_(channel.prior_distribution()),
+    in_alphabet_(channel.in_alphabet()), out_alphabet_(channel.out_alphabet()) {
+  for(int x = 0; x < channel.n_in(); x++) {
+    this->map_[x] = RowOutput(channel, x);
+    if(this->map_[x] < 0) Fail("row " + std::to_string(x) + " is not deterministic");
+  }
+}
+
+DeterministicChannel DeterministicChannel::Identity(int n) {
+  std::vector<int> map(n);
+  for(int x = 0; x < n; x++) map[x] = x;
+  DeterministicChannel identity(std::move(map), n);
+  identity.set_out_alphabet(identity.in_alphabet());
+  return identity;
+}
+
+bool DeterministicChannel::IsDeterministic(const Channel& channel) {
+  for(int x = 0; x < channel.n_in(); x++)
+    if(RowOutput(channel, x) < 0) return false;
+  return true;
+}
+
+Channel DeterministicChannel::ToChannel() const {
+  base::SparseMatrix c_matrix(this->n_out_);
+  c_matrix.reserve(this->map_.size());
+  for(int y : this->map_) {
+    c_matrix.Add(y, 1);
+    c_matrix.EndRow();
+  }
+  Channel channel(std::move(c_matrix), this->prior_distribution_,
+                  this->in_alphabet(), this->out_alphabet());
+  channel.set_cname(this->cname_);
+  return channel;
+}
+
+void DeterministicChannel::set_prior_distribution(
+    std::vector<double> prior_distribution) {
+  if(prior_distribution.size() != this->map_.size())
+    Fail("the prior does not match the inputs");
+  this->prior_distribution_ = std::move(prior_distribution);
+}
+
+const Alphabet::Ptr& DeterministicChannel::in_alphabet() const {
+  if(!this->in_alphabet_)
+    this->in_alphabet_ = Alphabet::Default("x", this->n_in(), false);
+  return this->in_alphabet_;
+}
+
+const Alphabet::Ptr& DeterministicChannel::out_alphabet() const {
+  if(!this->out_alphabet_)
+    this->out_alphabet_ = Alphabet::Default("y", this->n_out_, true);
+  return this->out_alphabet_;
+}
+
+void DeterministicChannel::set_in_names(const std::vector<std::string>& in_names) {
+  this->set_in_alphabet(Alphabet::Make(in_names));
+}
+
+void DeterministicChannel::set_out_names(const std::vector<std::string>& out_names) {
+  this->set_out_alphabet(Alphabet::Make(out_names));
+}
+
+void DeterministicChannel::set_in_alphabet(Alphabet::Ptr in_alphabet) {
+  if(in_alphabet->size() != this->n_in()) Fail("wrong number of input names");
+  this->in_alphabet_ = std::move(in_alphabet);
+}
+
+void DeterministicChannel::set_out_alphabet(Alphabet::Ptr out_alphabet) {
+  if(out_alphabet->size() != this->n_out_) Fail("wrong number of output names");
+  this->out_alphabet_ = std::move(out_alphabet);
+}
+
+std::vector<double> DeterministicChannel::out_distribution() const {
+  std::vector<double> out(this->n_out_, 0);
+  for(int x = 0; x < this->n_in(); x++)
+    out[this->map_[x]] += this->prior_distribution_[x];
+  return out;
+}
+
+// Cascade: an index gather.
+DeterministicChannel operator*(const DeterministicChannel& c1,
+                               const DeterministicChannel& c2) {
+  if(c1.n_out() != c2.n_in()) Fail("cascade of mismatched channels");
+  std::vector<int> map(c1.n_in());
+  for(int x = 0; x < c1.n_in(); x++)
+    map[x] = c2.map_[c1.map_[x]];
+  DeterministicChannel c3(std::move(map), c2.n_out());
+  c3.in_alphabet_ = c1.in_alphabet_;
+  c3.out_alphabet_ = c2.out_alphabet_;
+  return c3;
+}
+
+// Parallel: the pair of outputs (y1, y2) is output y1*|Y2| + y2.
+DeterministicChannel operator||(const DeterministicChannel& c1,
+                                const DeterministicChannel& c2) {
+  CheckCompatible(c1.in_alphabet(), c2.in_alphabet());
+  if((long long)c1.n_out() * c2.n_out() > INT_MAX) Fail("too many outputs");
+  std::vector<int> map(c1.n_in());
+  for(int x = 0; x < c1.n_in(); x++)
+    map[x] = c1.map_[x]*c2.n_out() + c2.map_[x];
+  DeterministicChannel c3(std::move(map), c1.n_out() * c2.n_out());
+  c3.in_alphabet_ = c1.in_alphabet_;
+  return c3;
+}
+
+Channel operator*(const Channel& c1, const DeterministicChannel& c2) {
+  if(c1.n_out() != c2.n_in()) Fail("cascade of mismatched channels");
+  // The columns that go to the same output are summed by EndRow.
+  base::SparseMatrix copy;
+  const base::SparseMatrix& s1 = SparseForm(c1, &copy);
+  base::SparseMatrix c_s(c2.n_out());
+  c_s.reserve(s1.nonzeros());
+  for(int x = 0; x < c1.n_in(); x++) {
+    base::SparseRow row = s1.row(x);
+    for(int k = 0; k < row.size; k++)
+      c_s.Add(c2(row.col[k]), row.value[k]);
+    c_s.EndRow();
+  }
+  return Channel(std::move(c_s), ChannelPrior(c1.n_in()), c1.in_alphabet(),
+                 c2.out_alphabet());
+}
+
+Channel operator*(const DeterministicChannel& c1, const Channel& c2) {
+  if(c1.n_out() != c2.n_in()) Fail("cascade of mismatched channels");
+  base::SparseMatrix copy;
+  const base::SparseMatrix& s2 = SparseForm(c2, &copy);
+  base::SparseMatrix c_s(c2.n_out());
+  for(int x = 0; x < c1.n_in(); x++) {
+    base::SparseRow row = s2.row(c1(x));
+    for(int k = 0; k < row.size; k++)
+      c_s.Add(row.col[k], row.value[k]);
+    c_s.EndRow();
+  }
+  return Channel(std::move(c_s), ChannelPrior(c1.n_in()), c1.in_alphabet(),
+                 c2.out_alphabet());
+}
+
+Channel operator||(const Channel& c1, const DeterministicChannel& c2) {
+  CheckCompatible(c1.in_alphabet(), c2.in_alphabet());
+  if((long long)c1.n_out() * c2.n_out() > INT_MAX) Fail("too many outputs");
+  base::SparseMatrix copy;
+  const base::SparseMatrix& s1 = SparseForm(c1, &copy);
+  base::SparseMatrix c_s(c1.n_out() * c2.n_out());
+  c_s.reserve(s1.nonzeros());
+  for(int x = 0; x < c1.n_in(); x++) {
+    base::SparseRow row = s1.row(x);
+    for(int k = 0; k < row.size; k++)
+      c_s.Add(row.col[k]*c2.n_out() + c2(x), row.value[k]);
+    c_s.EndRow();
+  }
+  return Channel(std::move(c_s), ChannelPrior(c1.n_in()), c1.in_alphabet(),
+                 Alphabet::Default("y", c1.n_out() * c2.n_out(), true));
+}
+
+Channel operator||(const DeterministicChannel& c1, const Channel& c2) {
+  CheckCompatible(c1.in_alphabet(), c2.in_alphabet());
+  if((long long)c1.n_out() * c2.n_out() > INT_MAX) Fail("too many outputs");
+  base::SparseMatrix copy;
+  const base::SparseMatrix& s2 = SparseForm(c2, &copy);
+  base::SparseMatrix c_s(c1.n_out() * c2.n_out());
+  c_s.reserve(s2.nonzeros());
+  for(int x = 0; x < c1.n_in(); x++) {
+    base::SparseRow row = s2.row(x);
+    for(int k = 0; k < row.size; k++)
+      c_s.Add(c1(x)*c2.n_out() + row.col[k], row.value[k]);
+    c_s.EndRow();
+  }
+  return Channel(std::move(c_s), ChannelPrior(c1.n_in()), c1.in_alphabet(),
+                 Alphabet::Default("y", c1.n_out() * c2.n_out(), true));
+}
+
+////////////////
+// Metrics
+////////////////
+double DeterministicChannel::ShannonEntropyPrior() const {
+  return Entropy(this->prior_distribution_);
+}
+
+double DeterministicChannel::ShannonEntropyOut() const {
+  return Entropy(this->out_distribution());
+}
+
+double DeterministicChannel::ConditionalEntropy() const {
+  return 0;
+}
+
+// H(X|Y) = H(X, Y) - H(Y)
+double DeterministicChannel::ConditionalEntropyHyper() const {
+  return this->JointEntropy() - this->ShannonEntropyOut();
+}
+
+// The only nonzero p(x, y) are the pi(x), at y = map[x].
+double DeterministicChannel::JointEntropy() const {
+  return this->ShannonEntropyPrior();
+}
+
+double DeterministicChannel::MutualInformation() const {
+  return this->ShannonEntropyPrior() - this->ConditionalEntropyHyper();
+}
+
+double DeterministicChannel::NormalizedMutualInformation() const {
+  return this->MutualInformation() /
+    sqrt(this->ShannonEntropyPrior()*this->ShannonEntropyOut());
+}
+
+double DeterministicChannel::VulnerabilityPrior() const {
+  double vulnerability = 0;
+  for(double p : this->prior_distribution_)
+    vulnerability = std::max(vulnerability, p);
+  return vulnerability;
+}
+
+double DeterministicChannel::VulnerabilityOut() const {
+  double vulnerability = 0;
+  for(double p : this->out_distribution())
+    vulnerability = std::max(vulnerability, p);
+  return vulnerability;
+}
+
+// V(X|Y) = sum_y max_{x: map[x] = y} pi(x)
+double DeterministicChannel::VulnerabilityPosterior() const {
+  std::vector<double> max_out(this->n_out_, 0);
+  for(int x = 0; x < this->n_in(); x++) {
+    double& max_y = max_out[this->map_[x]];
+    max_y = std::max(max_y, this->prior_distribution_[x]);
+  }
+  double vulnerability = 0;
+  for(double p : max_out) vulnerability += p;
+  return vulnerability;
+}
+
+// V(Y|X) = sum_x pi(x), as every row has its max, 1, at map[x].
+double DeterministicChannel::VulnerabilityReversePosterior() const {
+  double vulnerability = 0;
+  for(double p : this->prior_distribution_) vulnerability += p;
+  return vulnerability;
+}
+
+double DeterministicChannel::LeakageMultPosterior() const {
+  return this->VulnerabilityPosterior() / this->VulnerabilityPrior();
+}
+
+double DeterministicChannel::LeakageMultReversePosterior() const {
+  return this->VulnerabilityReversePosterior() / this->VulnerabilityOut();
+}
+
+double DeterministicChannel::PriorGVun(
+    const std::vector<std::vector<double> >& g) const {
+  return vulnerability::PriorGVulnerability(g, this->prior_distribution_);
+}
+
+// V_g = sum_y max_w sum_{x: map[x] = y} pi(x) g(w, x)
+double DeterministicChannel::PostGVun(
+    const std::vector<std::vector<double> >& g) const {
+  std::vector<double> best(this->n_out_, 0), score(this->n_out_);
+  for(const std::vector<double>& g_w : g) {
+    std::fill(score.begin(), score.end(), 0);
+    for(int x = 0; x < this->n_in(); x++)
+      score[this->map_[x]] += g_w[x] * this->prior_distribution_[x];
+    for(int y = 0; y < this->n_out_; y++)
+      best[y] = std::max(best[y], score[y]);
+  }
+  double vulnerability = 0;
+  for(double v : best) vulnerability += v;
+  return vulnerability;
+}
+
+} // namespace channel
@@ -0,0 +1,156 @@
+#ifndef _channel_deterministic_channel_h
+#define _channel_deterministic_channel_h
+
+#include <string>
+#include <vector>
+
+#include "alphabet.h"
+#include "channel.h"
+
+namespace channel {
+
+// A deterministic channel: every input x gives one output, map[x], with
+// probability 1. It is kept as that int array, so
+// - cascading two of them is an index gather, map2[map1[x]];
+// - their parallel composition packs the outputs into one index,
+//   map1[x] * n_out2 + map2[x], the column order of Channel's ||;
+// - the metrics group the prior by output, e.g. V(X|Y) is the sum over
+//   y of the largest pi(x) with map[x] = y.
+// All of these are O(n_in + n_out), instead of O(n_in * n_out).
+//
+// The operators below mix deterministic channels and Channels, and give
+// Channels. ToChannel converts, into the sparse form of Channel whenever
+// the density allows it. As with Channel's operators, the results of the
+// operators have the uniform prior, the input names of the first channel
+// and, for cascades, the output names of the second one.
+//
+// The constructors and operators throw std::invalid_argument for maps,
+// priors or channels that do not fit.
+class DeterministicChannel {
+  public:
+    // [map] gives an output in [0, n_out) for each input; the prior is
+    // uniform and the names are the default ones.
+    DeterministicChannel(std::vector<int> map, int n_out);
+
+    DeterministicChannel(std::vector<int> map, int n_out,
+                         std::vector<double> prior_distribution);
+
+    // Takes the map, prior and names of [channel], whose rows must all
+    // be a single 1 among zeros.
+    explicit DeterministicChannel(const Channel& channel);
+
+    // The n x n identity, with the same names on both sides.
+    static DeterministicChannel Identity(int n);
+
+    // Whether every row of [channel] is a single 1 among zeros.
+    static bool IsDeterministic(const Channel& channel);
+
+    Channel ToChannel() const;
+
+    std::string cname() const {
+      return this->cname_;
+    }
+
+    void set_cname(std::string cname) {
+      this->cname_ = cname;
+    }
+
+    int n_in() const {
+      return this->map_.size();
+    }
+
+    int n_out() const {
+      return this->n_out_;
+    }
+
+    // The output of input [x].
+    int operator()(int x) const {
+      return this->map_[x];
+    }
+
+    const std::vector<int>& map() const {
+      return this->map_;
+    }
+
+    const std::vector<double>& prior_distribution() const {
+      return this->prior_distribution_;
+    }
+
+    void set_prior_distribution(std::vector<double> prior_distribution);
+
+    // The default alphabets are only made when first asked for, as the
+    // outputs of a parallel composition can be many.
+    const Alphabet::Ptr& in_alphabet() const;
+    const Alphabet::Ptr& out_alphabet() const;
+
+    const std::vector<std::string>& in_names() const {
+      return this->in_alphabet()->names();
+    }
+
+    const std::vector<std::string>& out_names() const {
+      return this->out_alphabet()->names();
+    }
+
+    void set_in_names(const std::vector<std::string>& in_names);
+    void set_out_names(const std::vector<std::string>& out_names);
+    void set_in_alphabet(Alphabet::Ptr in_alphabet);
+    void set_out_alphabet(Alphabet::Ptr out_alphabet);
+
+    // p(y): the sum of pi(x) over the x with map[x] = y.
+    std::vector<double> out_distribution() const;
+
+    friend DeterministicChannel operator* (const DeterministicChannel& c1,
+                                           const DeterministicChannel& c2);
+    friend DeterministicChannel operator|| (const DeterministicChannel& c1,
+                                            const DeterministicChannel& c2);
+
+    ////////////////
+    // Shannon metrics, as in Channel.
+    ////////////////
+    double ShannonEntropyPrior() const;
+    double ShannonEntropyOut() const;
+    // H(Y|X), which is 0.
+    double ConditionalEntropy() const;
+    double ConditionalEntropyHyper() const;
+    // H(X, Y), which is H(X).
+    double JointEntropy() const;
+    double MutualInformation() const;
+    double NormalizedMutualInformation() const;
+
+    ////////////////
+    // Bayes vulnerabilities, as in vulnerability::Bayes.
+    ////////////////
+    double VulnerabilityPrior() const;
+    double VulnerabilityOut() const;
+    double VulnerabilityPosterior() const;
+    double VulnerabilityReversePosterior() const;
+    double LeakageMultPosterior() const;
+    double LeakageMultReversePosterior() const;
+
+    ////////////////
+    // g-vulnerabilities, as in Channel. PostGVun is O(|W| * (n_in + n_out)).
+    ////////////////
+    double PriorGVun(const std::vector<std::vector<double> >& g) const;
+    double PostGVun(const std::vector<std::vector<double> >& g) const;
+
+  private:
+    std::string cname_ = "";
+    std::vector<int> map_;
+    int n_out_;
+    std::vector<double> prior_distribution_;
+    mutable Alphabet::Ptr in_alphabet_, out_alphabet_;
+};
+
+// Channel * DeterministicChannel merges the columns that go to the same
+// output; DeterministicChannel * Channel gathers the rows of the Channel.
+Channel operator* (const Channel& c1, const DeterministicChannel& c2);
+Channel operator* (const DeterministicChannel& c1, const Channel& c2);
+
+// Every row is the row of the Channel, moved to the block of the output
+// of the deterministic channel.
+Channel operator|| (const Channel& c1, const DeterministicChannel& c2);
+Channel operator|| (const DeterministicChannel& c1, const Channel& c2);
+
+} // namespace channel
+
+#endif
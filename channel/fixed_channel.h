@@ -0,0 +1,242 @@
+#ifndef _channel_fixed_channel_h
+#define _channel_fixed_channel_h
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "channel.h"
+#include "../base/matrix.h"
+#include "../base/vmath.h"
+
+namespace channel {
+
+// A channel whose dimensions are known at compile time, for the small
+// channels (2x2 to 10x10) that the searches evaluate millions of times.
+//
+// Everything is held in std::arrays, so a FixedChannel lives on the stack
+// and every loop has a constant trip count that the compiler can unroll
+// and vectorize. The derived quantities are computed eagerly when the
+// channel is built, which costs NIn * NOut operations. There are no names;
+// converting to a Channel gives the default ones.
+//
+// The metrics match the ones of Channel and vulnerability::Bayes, up to
+// rounding.
+template <int NIn, int NOut>
+class FixedChannel {
+  public:
+    typedef std::array<std::array<double, NOut>, NIn> CMatrix;
+    typedef std::array<double, NIn> Prior;
+
+    static const int kInputs = NIn;
+    static const int kOutputs = NOut;
+
+    // A channel with every row equal to the uniform distribution, under a
+    // uniform prior.
+    FixedChannel() {
+      CMatrix c_matrix;
+      for(auto& row : c_matrix) row.fill(1.0/NOut);
+      Prior prior;
+      prior.fill(1.0/NIn);
+      this->build_channel(c_matrix, prior);
+    }
+
+    explicit FixedChannel(const CMatrix& c_matrix) {
+      Prior prior;
+      prior.fill(1.0/NIn);
+      this->build_channel(c_matrix, prior);
+    }
+
+    FixedChannel(const CMatrix& c_matrix, const Prior& prior_distribution) {
+      this->build_channel(c_matrix, prior_distribution);
+    }
+
+    // Copies the matrix and the prior of [channel]. Throws
+    // std::invalid_argument if its dimensions are not NIn x NOut.
+    explicit FixedChannel(const Channel& channel) {
+      if(channel.n_in() != NIn || channel.n_out() != NOut)
+        throw std::invalid_argument("FixedChannel: dimensions do not match");
+      CMatrix c_matrix;
+      Prior prior;
+      for(int i = 0; i < NIn; i++) {
+        for(int j = 0; j < NOut; j++)
+          c_matrix[i][j] = channel.c_matrix()(i, j);
+        prior[i] = channel.prior_distribution()[i];
+      }
+      this->build_channel(c_matrix, prior);
+    }
+
+    Channel ToChannel() const {
+      base::Matrix c_matrix(NIn, NOut);
+      for(int i = 0; i < NIn; i++)
+        for(int j = 0; j < NOut; j++)
+          c_matrix(i, j) = this->c_matrix_[i][j];
+      return Channel(std::move(c_matrix),
+                     std::vector<double>(this->prior_distribution_.begin(),
+                                         this->prior_distribution_.end()));
+    }
+
+    // Replaces the matrix and the prior, and recomputes what derives from
+    // them.
+    void build_channel(const CMatrix& c_matrix, const Prior& prior_distribution) {
+      this->c_matrix_ = c_matrix;
+      this->prior_distribution_ = prior_distribution;
+      this->out_distribution_.fill(0);
+      this->max_poutput_.fill(0);
+      for(int i = 0; i < NIn; i++) {
+        double max_in = 0;
+        for(int j = 0; j < NOut; j++) {
+          double joint = c_matrix[i][j] * prior_distribution[i];
+          this->j_matrix_[i][j] = joint;
+          this->out_distribution_[j] += joint;
+          max_in = std::max(max_in, joint);
+          this->max_poutput_[j] = std::max(this->max_poutput_[j], joint);
+        }
+        this->max_pinput_[i] = max_in;
+      }
+    }
+
+    const CMatrix& c_matrix() const { return this->c_matrix_; }
+    const CMatrix& j_matrix() const { return this->j_matrix_; }
+    const Prior& prior_distribution() const { return this->prior_distribution_; }
+    const std::array<double, NOut>& out_distribution() const {
+      return this->out_distribution_;
+    }
+    const std::array<double, NIn>& max_pinput() const { return this->max_pinput_; }
+    const std::array<double, NOut>& max_poutput() const { return this->max_poutput_; }
+
+    ////////////////
+    // Shannon metrics, as in Channel.
+    ////////////////
+    double ShannonEntropyPrior() const {
+      return Entropy(this->prior_distribution_);
+    }
+
+    double ShannonEntropyOut() const {
+      return Entropy(this->out_distribution_);
+    }
+
+    // H(Y|X)
+    double ConditionalEntropy() const {
+      double entropy = 0;
+      for(int i = 0; i < NIn; i++)
+        entropy += this->prior_distribution_[i] * Entropy(this->c_matrix_[i]);
+      return entropy;
+    }
+
+    // H(X|Y) = H(X, Y) - H(Y)
+    double ConditionalEntropyHyper() const {
+      return this->JointEntropy() - this->ShannonEntropyOut();
+    }
+
+    double JointEntropy() const {
+      double entropy = 0;
+      for(int i = 0; i < NIn; i++) entropy += Entropy(this->j_matrix_[i]);
+      return entropy;
+    }
+
+    double MutualInformation() const {
+      return this->ShannonEntropyPrior() - this->ConditionalEntropyHyper();
+    }
+
+    // H(X) and H(Y) are computed once each, as in Channel.
+    double NormalizedMutualInformation() const {
+      const double hx = this->ShannonEntropyPrior();
+      const double hy = this->ShannonEntropyOut();
+      const double mutual_information = hx - (this->JointEntropy() - hy);
+      return mutual_information / std::sqrt(hx*hy);
+    }
+
+    ////////////////
+    // Bayes vulnerabilities, as in vulnerability::Bayes.
+    ////////////////
+    // V(X)
+    double VulnerabilityPrior() const {
+      return *std::max_element(this->prior_distribution_.begin(),
+                               this->prior_distribution_.end());
+    }
+
+    // V(Y)
+    double VulnerabilityOut() const {
+      return *std::max_element(this->out_distribution_.begin(),
+                               this->out_distribution_.end());
+    }
+
+    // V(X|Y)
+    double VulnerabilityPosterior() const {
+      double vulnerability = 0;
+      for(int j = 0; j < NOut; j++) vulnerability += this->max_poutput_[j];
+      return vulnerability;
+    }
+
+    // V(Y|X)
+    double VulnerabilityReversePosterior() const {
+      double vulnerability = 0;
+      for(int i = 0; i < NIn; i++) vulnerability += this->max_pinput_[i];
+      return vulnerability;
+    }
+
+    double LeakageMultPosterior() const {
+      return this->VulnerabilityPosterior() / this->VulnerabilityPrior();
+    }
+
+    double LeakageMultReversePosterior() const {
+      return this->VulnerabilityReversePosterior() / this->VulnerabilityOut();
+    }
+
+    ////////////////
+    // g-vulnerabilities, as in Channel::PriorGVun and PostGVun, for a gain
+    // function with NW guesses, g[w][x].
+    ////////////////
+    template <size_t NW>
+    double PriorGVun(const std::array<std::array<double, NIn>, NW>& g) const {
+      double vulnerability = 0;
+      for(size_t w = 0; w < NW; w++) {
+        double gain = 0;
+        for(int i = 0; i < NIn; i++)
+          gain += this->prior_distribution_[i] * g[w][i];
+        vulnerability = std::max(vulnerability, gain);
+      }
+      return vulnerability;
+    }
+
+    template <size_t NW>
+    double PostGVun(const std::array<std::array<double, NIn>, NW>& g) const {
+      // gains[w][y] = sum_x g(w, x) p(x, y), built row by row of J.
+      std::array<std::array<double, NOut>, NW> gains;
+      for(size_t w = 0; w < NW; w++) {
+        gains[w].fill(0);
+        for(int i = 0; i < NIn; i++)
+          for(int j = 0; j < NOut; j++)
+            gains[w][j] += g[w][i] * this->j_matrix_[i][j];
+      }
+      double vulnerability = 0;
+      for(int j = 0; j < NOut; j++) {
+        double best = 0;
+        for(size_t w = 0; w < NW; w++) best = std::max(best, gains[w][j]);
+        vulnerability += best;
+      }
+      return vulnerability;
+    }
+
+  private:
+    template <size_t N>
+    static double Entropy(const std::array<double, N>& distribution) {
+      return base::Entropy(distribution.data(), N);
+    }
+
+    CMatrix c_matrix_;
+    Prior prior_distribution_;
+
+    // p(x, y), p(y), and the maxima of p(x, y) per x and per y.
+    CMatrix j_matrix_;
+    std::array<double, NOut> out_distribution_;
+    std::array<double, NIn> max_pinput_;
+    std::array<double, NOut> max_poutput_;
+};
+
+} // namespace channel
+
+#endif
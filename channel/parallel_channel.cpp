@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "parallel_channel.h"
+#include "../base/vmath.h"
+
+namespace channel {
+
+ParallelChannel::ParallelChannel(const Channel& c) : n_in_(0), n_out_(1) {
+  this->Add(c);
+}
+
+ParallelChannel::ParallelChannel(const std::vector<Channel>& factors)
+    : n_in_(0), n_out_(1) {
+  for(const Channel& c : factors)
+    this->Add(c);
+}
+
+ParallelChannel& ParallelChannel::Add(const Channel& c) {
+  if(!this->factors_.empty() &&
+     !Channel::CompatibleChannels(this->factors_[0], c)) {
+    std::cerr << "Channels not compatible" << std::endl;
+    exit(1);
+  }
+  if(this->factors_.empty()) {
+    this->n_in_ = c.n_in();
+    this->prior_distribution_.assign(this->n_in_, 1.0f/this->n_in_);
+  }
+  if(c.n_out() > 0 && this->n_out_ > LLONG_MAX / c.n_out())
+    throw std::invalid_argument("ParallelChannel: too many outputs");
+  this->factors_.push_back(c);
+  this->columns_.push_back(c.c_matrix().Transposed());
+  this->n_out_ *= c.n_out();
+  return *this;
+}
+
+ParallelChannel operator||(const ParallelChannel& c1, const Channel& c2) {
+  ParallelChannel c3(c1);
+  c3.Add(c2);
+  return c3;
+}
+
+// This function calls fn(y, joint) for every output y of the composed
+// channel, where joint[x] = p(x, y).
+void ParallelChannel::ForEachJointColumn(
+    const std::vector<double>& prior_distribution,
+    const std::function<void(long long, const double*)>& fn) const {
+  const int k = this->factors_.size();
+  const int n = this->n_in_;
+  if(k == 0) return;
+
+  // partial[l][x] is the product of p(y_t|x) for t <= l. When the tuple
+  // moves on, only the levels from the first digit that changed onwards
+  // are recomputed, so most steps cost a single O(|X|) product.
+  std::vector<int> digit(k, 0);
+  std::vector<double> partial((std::size_t)k*n);
+  std::vector<double> joint(n);
+  auto fill = [&](int l) {
+    const double* col = this->columns_[l].row(digit[l]).data();
+    double* cur = partial.data() + (std::size_t)l*n;
+    if(l == 0) {
+      std::copy(col, col + n, cur);
+      return;
+    }
+    const double* prev = cur - n;
+    for(int x = 0; x < n; x++)
+      cur[x] = prev[x] * col[x];
+  };
+
+  for(int l = 0; l < k; l++) fill(l);
+  const double* last = partial.data() + (std::size_t)(k-1)*n;
+  for(long long y = 0; ; y++) {
+    for(int x = 0; x < n; x++)
+      joint[x] = last[x] * prior_distribution[x];
+    fn(y, joint.data());
+
+    int l = k-1;
+    while(l >= 0 && ++digit[l] == this->factors_[l].n_out()) {
+      digit[l] = 0;
+      l--;
+    }
+    if(l < 0) break;
+    for(int t = l; t < k; t++) fill(t);
+  }
+}
+
+Channel ParallelChannel::ToChannel() const {
+  if(this->n_out_ > INT_MAX)
+    throw std::length_error("ParallelChannel: too many outputs for a matrix");
+  base::Matrix c_m(this->n_in_, (int)this->n_out_);
+  std::vector<double> ones(this->n_in_, 1);
+  this->ForEachJointColumn(ones, [&c_m](long long y, const double* column) {
+    for(int x = 0; x < c_m.rows(); x++)
+      c_m(x, y) = column[x];
+  });
+  if(this->factors_.empty())
+    return Channel(std::move(c_m), this->prior_distribution_);
+  return Channel(std::move(c_m), this->prior_distribution_,
+                 this->factors_[0].in_alphabet(),
+                 Alphabet::Default("y", (int)this->n_out_, true));
+}
+
+// V(X)
+double ParallelChannel::BayesVulnerabilityPrior() const {
+  double vulnerability = 0;
+  for(double p : this->prior_distribution_)
+    vulnerability = std::max(vulnerability, p);
+  return vulnerability;
+}
+
+// V(X|Y) = sum_y max_x p(x, y)
+double ParallelChannel::BayesVulnerabilityPosterior() const {
+  double vulnerability = 0;
+  const int n = this->n_in_;
+  this->ForEachJointColumn(this->prior_distribution_,
+      [&vulnerability, n](long long, const double* joint) {
+        vulnerability += *std::max_element(joint, joint + n);
+      });
+  return vulnerability;
+}
+
+double ParallelChannel::ShannonEntropyPrior() const {
+  return base::Entropy(this->prior_distribution_.data(),
+                       this->prior_distribution_.size());
+}
+
+// The p(y) are buffered, so their entropy is taken a block at a time.
+double ParallelChannel::ShannonEntropyOut() const {
+  const int kBlock = 256;
+  double entropy = 0;
+  double out[kBlock];
+  int size = 0;
+  const int n = this->n_in_;
+  this->ForEachJointColumn(this->prior_distribution_,
+      [&entropy, &out, &size, n](long long, const double* joint) {
+        double p_y = 0;
+        for(int x = 0; x < n; x++) p_y += joint[x];
+        out[size++] = p_y;
+        if(size == kBlock) {
+          entropy += base::Entropy(out, size);
+          size = 0;
+        }
+      });
+  return entropy + base::Entropy(out, size);
+}
+
+// H(Y|X)
+// Given x, the factor outputs are independent, so
+// H(Y|X=x) = H(Y1|X=x) + ... + H(Yk|X=x), and no tuple is visited.
+double ParallelChannel::ConditionalEntropy() const {
+  double entropy = 0;
+  for(int x = 0; x < this->n_in_; x++) {
+    double conditional_entropy_Y = 0;
+    for(const Channel& c : this->factors_)
+      conditional_entropy_Y += base::Entropy(c.c_matrix().row(x).data(),
+                                             c.n_out());
+    entropy += (this->prior_distribution_[x] * conditional_entropy_Y);
+  }
+  return entropy;
+}
+
+// H(X|Y) = H(X) + H(Y|X) - H(Y)
+double ParallelChannel::ConditionalEntropyHyper() const {
+  return this->JointEntropy() - this->ShannonEntropyOut();
+}
+
+// H(X,Y) = H(X) + H(Y|X)
+double ParallelChannel::JointEntropy() const {
+  return this->ShannonEntropyPrior() + this->ConditionalEntropy();
+}
+
+// I(X;Y) = H(Y) - H(Y|X)
+double ParallelChannel::MutualInformation() const {
+  return this->ShannonEntropyOut() - this->ConditionalEntropy();
+}
+
+double ParallelChannel::NormalizedMutualInformation() const {
+  double h_out = this->ShannonEntropyOut();
+  double mutual_information = h_out - this->ConditionalEntropy();
+  return mutual_information / sqrt(this->ShannonEntropyPrior()*h_out);
+}
+
+double ParallelChannel::SymmetricUncertainty() const {
+  double h_out = this->ShannonEntropyOut();
+  double mutual_information = h_out - this->ConditionalEntropy();
+  return 2*mutual_information / (this->ShannonEntropyPrior() + h_out);
+}
+
+double ParallelChannel::PriorGVun(const std::vector<std::vector<double> > &g) const {
+  double max_ = 0;
+  for(const std::vector<double>& g_w : g) {
+    double max_w = 0;
+    for(int x = 0; x < this->n_in_; x++)
+      max_w += this->prior_distribution_[x] * g_w[x];
+    max_ = std::max(max_, max_w);
+  }
+  return max_;
+}
+
+double ParallelChannel::PostGVun(const std::vector<std::vector<double> > &g) const {
+  return this->PostGVun(this->prior_distribution_, g);
+}
+
+double ParallelChannel::PostGVun(const std::vector<double> &prior_distribution,
+                                 const std::vector<std::vector<double> > &g) const {
+  double sum_ = 0;
+  const int n = this->n_in_;
+  this->ForEachJointColumn(prior_distribution,
+      [&sum_, &g, n](long long, const double* joint) {
+        double max_w = 0;
+        for(const std::vector<double>& g_w : g) {
+          double new_max_w = 0;
+          for(int x = 0; x < n; x++)
+            new_max_w += joint[x] * g_w[x];
+          max_w = std::max(max_w, new_max_w);
+        }
+        sum_ += max_w;
+      });
+  return sum_;
+}
+
+}  // namespace channel
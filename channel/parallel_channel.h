@@ -0,0 +1,105 @@
+#ifndef _channel_parallel_channel_h
+#define _channel_parallel_channel_h
+#include <functional>
+#include <vector>
+
+#include "channel.h"
+#include "../base/matrix.h"
+
+namespace channel {
+
+// The parallel composition c1 || c2 || ... || ck, kept as the list of its
+// factors. The composed output space has |Y1|*...*|Yk| elements, which
+// quickly stops fitting in memory, so it is never materialized: metrics
+// that need the columns of the composed channel walk the output tuples
+// one at a time, with O(k * |X|) memory.
+//
+// Outputs are numbered as in operator||, i.e. the tuple (y1, ..., yk) is
+// the output y1*|Y2|*...*|Yk| + ... + yk.
+class ParallelChannel {
+  public:
+    ParallelChannel() : n_in_(0), n_out_(1) {}
+
+    explicit ParallelChannel(const Channel& c);
+
+    ParallelChannel(const std::vector<Channel>& factors);
+
+    // Appends a factor. It must be compatible with the current ones, and
+    // the number of outputs must fit in a long long.
+    ParallelChannel& Add(const Channel& c);
+
+    int n_in() const {
+      return this->n_in_;
+    }
+
+    // The number of outputs of the composed channel.
+    long long n_out() const {
+      return this->n_out_;
+    }
+
+    int n_factors() const {
+      return this->factors_.size();
+    }
+
+    const Channel& factor(int i) const {
+      return this->factors_[i];
+    }
+
+    // The prior is uniform until it is set.
+    const std::vector<double>& prior_distribution() const {
+      return this->prior_distribution_;
+    }
+
+    void set_prior_distribution(std::vector<double> prior_distribution) {
+      this->prior_distribution_ = std::move(prior_distribution);
+    }
+
+    // This function calls fn(y, joint) for every output y of the composed
+    // channel, in order, where joint[x] = p(x, y) for the given prior.
+    // joint is only valid during the call.
+    void ForEachJointColumn(const std::vector<double>& prior_distribution,
+        const std::function<void(long long, const double*)>& fn) const;
+
+    // Builds the composed channel matrix. Only for small compositions: it
+    // throws std::length_error when n_out() does not fit in an int.
+    Channel ToChannel() const;
+
+    // Bayes vulnerabilities, as in vulnerability::Bayes.
+    // V(X)
+    double BayesVulnerabilityPrior() const;
+    // V(X|Y)
+    double BayesVulnerabilityPosterior() const;
+
+    double ShannonEntropyPrior() const;
+    double ShannonEntropyOut() const;
+    double ConditionalEntropy() const;
+    double ConditionalEntropyHyper() const;
+    double JointEntropy() const;
+    double MutualInformation() const;
+    double NormalizedMutualInformation() const;
+    double SymmetricUncertainty() const;
+
+    double PriorGVun(const std::vector<std::vector<double> > &g) const;
+    double PostGVun(const std::vector<std::vector<double> > &g) const;
+    double PostGVun(const std::vector<double> &prior_distribution,
+                    const std::vector<std::vector<double> > &g) const;
+
+    friend ParallelChannel operator|| (const ParallelChannel& c1,
+                                       const Channel& c2);
+
+  private:
+    std::vector<Channel> factors_;
+
+    // The factor matrices, transposed, so p(y_k|x) for a fixed y_k is
+    // a contiguous row.
+    std::vector<base::Matrix> columns_;
+
+    std::vector<double> prior_distribution_;
+
+    int n_in_;
+    long long n_out_;
+};
+
+} // namespace channel
+
+#endif
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <numeric>
+
+#include "search.h"
+
+namespace channel {
+namespace search {
+
+namespace {
+
+// Column symmetry costs n_out! permutations per matrix; past this many
+// outputs only the rows are reduced.
+const int kMaxPermutedColumns = 6;
+
+// Lexicographic comparison of two rows of [size] counts.
+int CompareRows(const int* a, const int* b, int size) {
+  for(int i = 0; i < size; i++) {
+    if(a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+}  // namespace
+
+bool NextRow(int* row, int size) {
+  // The last non-zero count past the first position gives one unit to
+  // the count before it, and the rest goes to the end of the row.
+  int j = size - 1;
+  while(j >= 1 && row[j] == 0) j--;
+  if(j < 1) return false;
+  int rest = row[j] - 1;
+  row[j] = 0;
+  row[j-1]++;
+  row[size-1] = rest;
+  return true;
+}
+
+CountEnumerator::CountEnumerator(int n_in, int n_out, int base_norm,
+                                 bool symmetric)
+    : n_in_(n_in), n_out_(n_out), base_norm_(base_norm),
+      symmetric_(symmetric) {
+  // The smallest row of a canonical matrix is its first one, and it can
+  // not be made smaller by permuting its columns, so it is sorted.
+  std::vector<int> row(n_out, 0);
+  row[n_out-1] = base_norm;
+  do {
+    if(!symmetric || std::is_sorted(row.begin(), row.end()))
+      this->first_rows_.push_back(row);
+  } while(NextRow(row.data(), n_out));
+
+  if(symmetric && n_out <= kMaxPermutedColumns) {
+    std::vector<int> permutation(n_out);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    while(std::next_permutation(permutation.begin(), permutation.end()))
+      this->column_permutations_.push_back(permutation);
+  }
+}
+
+bool CountEnumerator::IsCanonical(const int* counts) const {
+  std::vector<int> image(this->n_in_ * this->n_out_);
+  return this->IsCanonical(counts, image.data());
+}
+
+bool CountEnumerator::IsCanonical(const int* counts, int* image) const {
+  const int n = this->n_in_, m = this->n_out_;
+  for(const std::vector<int>& permutation : this->column_permutations_) {
+    for(int x = 0; x < n; x++)
+      for(int y = 0; y < m; y++)
+        image[x*m + y] = counts[x*m + permutation[y]];
+
+    // Insertion sort of the rows; there are only a few of them.
+    for(int x = 1; x < n; x++) {
+      for(int k = x; k > 0 &&
+          CompareRows(&image[k*m], &image[(k-1)*m], m) < 0; k--)
+        std::swap_ranges(&image[k*m], &image[k*m] + m, &image[(k-1)*m]);
+    }
+    for(int x = 0; x < n; x++) {
+      int c = CompareRows(&image[x*m], counts + x*m, m);
+      if(c < 0) return false;
+      if(c > 0) break;
+    }
+  }
+  return true;
+}
+
+void CountEnumerator::Extend(
+    int* counts, int* image, int row,
+    int worker, const std::function<void(const int*, int)>& visit) const {
+  const int m = this->n_out_;
+  if(row == this->n_in_) {
+    if(!this->symmetric_ || this->IsCanonical(counts, image))
+      visit(counts, worker);
+    return;
+  }
+
+  // With symmetry, rows never decrease; otherwise each one starts over.
+  int* current = counts + row*m;
+  if(this->symmetric_) {
+    std::copy(current - m, current, current);
+  } else {
+    std::fill(current, current + m, 0);
+    current[m-1] = this->base_norm_;
+  }
+  do {
+    this->Extend(counts, image, row + 1, worker, visit);
+  } while(NextRow(current, m));
+}
+
+void CountEnumerator::ForEach(
+    base::ThreadPool* pool,
+    const std::function<void(const int*, int)>& visit) const {
+  const int items = this->first_rows_.size();
+  auto run = [&](int begin, int end, int worker) {
+    std::vector<int> counts(this->n_in_ * this->n_out_);
+    std::vector<int> image(counts.size());
+    for(int item = begin; item < end; item++) {
+      std::copy(this->first_rows_[item].begin(), this->first_rows_[item].end(),
+                counts.begin());
+      this->Extend(counts.data(), image.data(), 1, worker, visit);
+    }
+  };
+  if(pool == nullptr) {
+    run(0, items, 0);
+    return;
+  }
+  pool->ParallelFor(0, items, [&](int begin, int end) {
+    run(begin, end, pool->CurrentWorker());
+  });
+}
+
+} // namespace search
+} // namespace channel
@@ -0,0 +1,79 @@
+#ifndef _channel_search_h
+#define _channel_search_h
+#include <functional>
+#include <vector>
+
+#include "../base/thread_pool.h"
+
+namespace channel {
+namespace search {
+
+// Exhaustive enumeration of the channels with a given resolution: the
+// n_in x n_out matrices of non-negative counts whose rows sum to
+// base_norm, i.e. the channels with C(x, y) = counts(x, y) / base_norm.
+//
+// Relabeling the inputs or the outputs of a channel does not change any
+// metric under a uniform prior, so by default only one matrix is visited
+// per class of row and column permutations: the canonical one, which is
+// the lexicographically smallest of the class (rows sorted, read row by
+// row). That cuts the space by up to n_in! * n_out!.
+//
+// The matrices are split in work items, one per first row, that run on
+// a base::ThreadPool; the items near the start of the order have many
+// more matrices than the ones near its end, and the pool balances them
+// by work stealing.
+class CountEnumerator {
+  public:
+    CountEnumerator(int n_in, int n_out, int base_norm, bool symmetric=true);
+
+    int n_in() const { return this->n_in_; }
+    int n_out() const { return this->n_out_; }
+    int base_norm() const { return this->base_norm_; }
+
+    // The number of slots for per-worker results that ForEach needs.
+    static int Workers(const base::ThreadPool* pool) {
+      return pool == nullptr ? 1 : pool->size();
+    }
+
+    // Calls visit(counts, worker) for every matrix, where counts holds the
+    // n_in x n_out counts row by row and is only valid during the call,
+    // and worker is in [0, Workers(pool)). Calls with the same worker never
+    // run at the same time, so visit can update the results of its worker
+    // without locks. Without a pool, the matrices are visited in order on
+    // the calling thread.
+    void ForEach(base::ThreadPool* pool,
+                 const std::function<void(const int*, int)>& visit) const;
+
+    // Returns true if [counts], with sorted rows, is the canonical matrix
+    // of its class.
+    bool IsCanonical(const int* counts) const;
+
+  private:
+    // IsCanonical, with [image] room for n_in x n_out counts to permute
+    // the columns into.
+    bool IsCanonical(const int* counts, int* image) const;
+
+    // Visits every matrix whose rows before [row] are already in counts.
+    // [image] is the room IsCanonical needs, allocated once per work item.
+    void Extend(int* counts, int* image, int row, int worker,
+                const std::function<void(const int*, int)>& visit) const;
+
+    int n_in_, n_out_, base_norm_;
+    bool symmetric_;
+
+    // The first rows, one per work item.
+    std::vector<std::vector<int> > first_rows_;
+
+    // Every column permutation other than the identity.
+    std::vector<std::vector<int> > column_permutations_;
+};
+
+// Moves to the next row of [size] counts with the same sum, in
+// lexicographic order, from (0, ..., 0, sum) to (sum, 0, ..., 0).
+// Returns false, leaving the row unchanged, if it was the last one.
+bool NextRow(int* row, int size);
+
+} // namespace search
+} // namespace channel
+
+#endif
@@ -40,24 +40,49 @@ double Bayes::VulnerabilityReversePosterior(const Channel& channel) const {
 
 // V(X|Y) = max_{y} V(X|Y=y) 
 double Bayes::VulnerabilityMaxPosterior(const Channel& channel) const {
-  double vulnerability = 0;
-  for(int j = 0; j < channel.n_out(); j++) {
-    double vxy = 0;
+  // The max over y of the max over x is the max of the whole matrix,
+  // so it is taken in storage order. On a sparse channel only the
+  // nonzeros can be the max.
+  if(channel.is_sparse()) {
+    const base::SparseMatrix& c = channel.c_sparse();
+    const std::vector<double>& prior = channel.prior_distribution();
+    const std::vector<double>& out = channel.out_distribution();
+    double vulnerability = 0;
     for(int i = 0; i < channel.n_in(); i++) {
-      vxy = std::max(vxy, channel.h_matrix()[i][j]);
+      base::SparseRow row = c.row(i);
+      for(int k = 0; k < row.size; k++) {
+        const int j = row.col[k];
+        if(out[j] != 0)
+          vulnerability = std::max(vulnerability, row.value[k]*prior[i]/out[j]);
+      }
     }
-    vulnerability = std::max(vulnerability, vxy);
+    return vulnerability;
   }
+  const base::Matrix& h_matrix = channel.h_matrix();
+  const double* h = h_matrix.data();
+  const long long size = (long long)channel.n_in() * channel.n_out();
+  double vulnerability = 0;
+  for(long long k = 0; k < size; k++)
+    vulnerability = std::max(vulnerability, h[k]);
   return vulnerability;
 }
 
 // V(Y|X) = max_{x} V(Y|X=x)
 double Bayes::VulnerabilityMaxReversePosterior(const Channel& channel) const {
   double vulnerability = 0;
+  if(channel.is_sparse()) {
+    const base::SparseMatrix& c = channel.c_sparse();
+    for(int i = 0; i < channel.n_in(); i++) {
+      base::SparseRow row = c.row(i);
+      for(int k = 0; k < row.size; k++)
+        vulnerability = std::max(vulnerability, row.value[k]);
+    }
+    return vulnerability;
+  }
   for(int i = 0; i < channel.n_in(); i++) {
     double vyx = 0;
-    for(int j = 0; j < channel.n_out(); j++) {
-      vyx = std::max(vyx, channel.c_matrix()[i][j]);
+    for(double value : channel.c_matrix()[i]) {
+      vyx = std::max(vyx, value);
     }
     vulnerability = std::max(vulnerability, vyx);
   }
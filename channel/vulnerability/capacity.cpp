@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+
+#include "capacity.h"
+#include "gvulnerability.h"
+#include "../../base/gemm.h"
+#include "../../base/simplex.h"
+#include "../../base/vmath.h"
+
+
+namespace channel {
+namespace vulnerability {
+
+namespace {
+
+typedef std::vector<std::vector<double> > Gain;
+
+// Probabilities below this are set to zero by ShannonCapacity.
+const double kNegligible = 1e-200;
+
+// Up to this many strategies, all of them are tried.
+const double kAllStrategies = 4096;
+
+enum class Leakage { kAdditive, kMultiplicative };
+
+// The best guess for every output under the prior pi, i.e. the strategy
+// with s(y) = argmax_w sum_x pi(x) C(x, y) g(w, x).
+std::vector<int> BestStrategy(const base::Matrix& c, const base::Matrix& g,
+                              const std::vector<double>& pi) {
+  base::Matrix joint(c.rows(), c.cols());
+  for(int x = 0; x < c.rows(); x++)
+    for(int y = 0; y < c.cols(); y++)
+      joint(x, y) = pi[x] * c(x, y);
+  base::Matrix scores = base::Multiply(g, joint);
+
+  std::vector<int> s(c.cols(), 0);
+  std::vector<double> best(scores.row(0).to_vector());
+  for(int w = 1; w < g.rows(); w++) {
+    const double* s_w = scores.row(w).data();
+    for(int y = 0; y < c.cols(); y++) {
+      if(s_w[y] > best[y]) {
+        best[y] = s_w[y];
+        s[y] = w;
+      }
+    }
+  }
+  return s;
+}
+
+// a(x) = sum_y C(x, y) g(s(y), x), so that the strategy s gains a.pi.
+std::vector<double> StrategyGain(const base::Matrix& c, const base::Matrix& g,
+                                 const std::vector<int>& s) {
+  std::vector<double> a(c.rows(), 0);
+  for(int x = 0; x < c.rows(); x++)
+    for(int y = 0; y < c.cols(); y++)
+      a[x] += c(x, y) * g(s[y], x);
+  return a;
+}
+
+// The leakage of the channel under pi.
+double Evaluate(const base::Matrix& c, const Gain& g,
+                const std::vector<double>& pi, Leakage leakage) {
+  double posterior = PostGVulnerability(c, g, pi);
+  double prior = PriorGVulnerability(g, pi);
+  if(leakage == Leakage::kAdditive)
+    return posterior - prior;
+  return prior > 0 ? posterior / prior : 0;
+}
+
+// Solves the linear program of the strategy with gains a, and returns
+// false if it has no usable solution.
+bool BestPrior(const std::vector<double>& a, const base::Matrix& g,
+               Leakage leakage, std::vector<double>* pi) {
+  const int n = a.size();
+  if(leakage == Leakage::kAdditive) {
+    // Variables pi, t+ and t-, where t = t+ - t- >= V_g(pi):
+    //   max a.pi - t  s.t.  g_w.pi - t <= 0,  sum pi = 1
+    base::LinearProgram lp(n + 2);
+    std::vector<double> c(a);
+    c.push_back(-1);
+    c.push_back(1);
+    lp.SetObjective(c);
+    for(int w = 0; w < g.rows(); w++) {
+      std::vector<double> row(g.row(w).to_vector());
+      row.push_back(-1);
+      row.push_back(1);
+      lp.AddLessEqual(row, 0);
+    }
+    std::vector<double> ones(n, 1);
+    ones.resize(n + 2, 0);
+    lp.AddEqual(ones, 1);
+
+    base::LpResult r = lp.Maximize();
+    if(r.status != base::LpStatus::kOptimal) return false;
+    pi->assign(r.x.begin(), r.x.begin() + n);
+  } else {
+    // With z = pi / V_g(pi) (Charnes-Cooper):
+    //   max a.z  s.t.  g_w.z <= 1,  z >= 0,  and pi = z / sum z
+    // For non-negative gains it is bounded: a(x) = 0 for every secret
+    // that no guess gains anything from.
+    base::LinearProgram lp(n);
+    lp.SetObjective(a);
+    for(int w = 0; w < g.rows(); w++)
+      lp.AddLessEqual(g.row(w).to_vector(), 1);
+    base::LpResult r = lp.Maximize();
+    if(r.status != base::LpStatus::kOptimal) return false;
+    *pi = r.x;
+  }
+
+  double sum = 0;
+  for(double p : *pi) sum += std::max(p, 0.0);
+  if(sum <= 0) return false;
+  for(double& p : *pi) p = std::max(p, 0.0) / sum;
+  return true;
+}
+
+// Solves the program of every strategy. Exact, as the capacity is the
+// best of these programs.
+CapacityResult AllStrategies(const base::Matrix& c, const Gain& g,
+                             const base::Matrix& g_m, Leakage leakage) {
+  CapacityResult best;
+  best.capacity = -std::numeric_limits<double>::infinity();
+  best.rounds = 0;
+  best.exact = true;
+  std::vector<int> s(c.cols(), 0);
+  while(true) {
+    best.rounds++;
+    std::vector<double> pi;
+    if(BestPrior(StrategyGain(c, g_m, s), g_m, leakage, &pi)) {
+      double value = Evaluate(c, g, pi, leakage);
+      if(value > best.capacity) {
+        best.capacity = value;
+        best.prior.swap(pi);
+      }
+    }
+    int y = c.cols() - 1;
+    while(y >= 0 && ++s[y] == g_m.rows()) s[y--] = 0;
+    if(y < 0) break;
+  }
+  return best;
+}
+
+CapacityResult GainCapacity(const Channel& channel, const Gain& g,
+                            Leakage leakage, int restarts, int max_rounds,
+                            base::Rng* rng) {
+  const base::Matrix& c = channel.c_matrix();
+  const int n = channel.n_in();
+  const base::Matrix g_m(g);
+
+  double strategies = std::pow((double)g_m.rows(), c.cols());
+  if(strategies <= kAllStrategies)
+    return AllStrategies(c, g, g_m, leakage);
+
+  // The uniform prior, then random ones.
+  std::vector<std::vector<double> > starts(1, std::vector<double>(n, 1.0/n));
+  base::Rng& random = rng ? *rng : base::ThreadRng();
+  for(int r = 0; r < restarts; r++) {
+    std::vector<double> pi(n);
+    base::RandomDistribution(random, pi.data(), n);
+    starts.push_back(pi);
+  }
+
+  CapacityResult best;
+  best.capacity = -std::numeric_limits<double>::infinity();
+  best.rounds = 0;
+  best.exact = false;
+  for(const std::vector<double>& start : starts) {
+    std::vector<double> pi(start);
+    double value = Evaluate(c, g, pi, leakage);
+    std::vector<int> s = BestStrategy(c, g_m, pi);
+    std::set<std::vector<int> > seen;
+    for(int round = 0; round < max_rounds; round++) {
+      // The strategy is either the best answer to the current prior, or
+      // when that one was already tried, a change of a single guess that
+      // improves on it. A strategy is never solved for twice.
+      bool moved = false;
+      if(seen.insert(s).second) {
+        best.rounds++;
+        std::vector<double> next;
+        if(BestPrior(StrategyGain(c, g_m, s), g_m, leakage, &next)) {
+          double next_value = Evaluate(c, g, next, leakage);
+          if(next_value > value) {
+            pi.swap(next);
+            value = next_value;
+            moved = true;
+          }
+        }
+      }
+      for(int y = 0; !moved && y < c.cols(); y++) {
+        for(int w = 0; !moved && w < g_m.rows(); w++) {
+          std::vector<int> t(s);
+          t[y] = w;
+          if(!seen.insert(t).second) continue;
+          best.rounds++;
+          std::vector<double> next;
+          if(!BestPrior(StrategyGain(c, g_m, t), g_m, leakage, &next)) continue;
+          double next_value = Evaluate(c, g, next, leakage);
+          if(next_value > value) {
+            pi.swap(next);
+            value = next_value;
+            moved = true;
+          }
+        }
+      }
+      if(!moved) break;
+      s = BestStrategy(c, g_m, pi);
+    }
+    if(value > best.capacity) {
+      best.capacity = value;
+      best.prior = pi;
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+CapacityResult BayesMultCapacity(const Channel& channel) {
+  CapacityResult result;
+  result.capacity = 0;
+  result.rounds = 0;
+  result.exact = true;
+  result.prior.assign(channel.n_in(), 1.0/channel.n_in());
+
+  // The column maxima, gathered one row at a time.
+  const base::Matrix& c = channel.c_matrix();
+  std::vector<double> max_x(c.row(0).to_vector());
+  for(int x = 1; x < c.rows(); x++) {
+    const double* c_x = c.row(x).data();
+    for(int y = 0; y < c.cols(); y++)
+      max_x[y] = std::max(max_x[y], c_x[y]);
+  }
+  for(double m : max_x)
+    result.capacity += m;
+  return result;
+}
+
+CapacityResult GainAddCapacity(const Channel& channel, const Gain& g,
+                               int restarts, int max_rounds, base::Rng* rng) {
+  return GainCapacity(channel, g, Leakage::kAdditive, restarts, max_rounds,
+                      rng);
+}
+
+CapacityResult GainMultCapacity(const Channel& channel, const Gain& g,
+                                int restarts, int max_rounds, base::Rng* rng) {
+  return GainCapacity(channel, g, Leakage::kMultiplicative, restarts,
+                      max_rounds, rng);
+}
+
+CapacityResult ShannonCapacity(const Channel& channel,
+                               const std::vector<double>& start,
+                               double tolerance, int max_iterations) {
+  const base::Matrix& c = channel.c_matrix();
+  const int n = c.rows(), m = c.cols();
+
+  CapacityResult result;
+  result.rounds = 0;
+  result.exact = false;
+  result.prior.assign(n, 1.0/n);
+  if((int)start.size() == n) {
+    const double lift = 1e-6;
+    double sum = 0;
+    for(int x = 0; x < n; x++)
+      sum += (result.prior[x] = (1 - lift)*start[x] + lift/n);
+    for(double& p : result.prior) p /= sum;
+  }
+  std::vector<double>& pi = result.prior;
+
+  // neg_h[x] = sum_y C(x, y) ln C(x, y), i.e. -H(Y|X=x) in nats.
+  std::vector<double> neg_h(n, 0), log_row(m);
+  for(int x = 0; x < n; x++) {
+    const double* c_x = c.row(x).data();
+    base::Log(c_x, log_row.data(), m);
+    for(int y = 0; y < m; y++)
+      if(c_x[y] > 0) neg_h[x] += c_x[y] * log_row[y];
+  }
+
+  std::vector<double> q(m), log_q(m), d(n), e_d(n);
+  const double tolerance_nats = tolerance * std::log(2.0);
+  double information = 0;
+  while(true) {
+    // q(y) = sum_x pi(x) C(x, y)
+    std::fill(q.begin(), q.end(), 0);
+    for(int x = 0; x < n; x++) {
+      const double* c_x = c.row(x).data();
+      const double pi_x = pi[x];
+      if(pi_x == 0) continue;
+      for(int y = 0; y < m; y++)
+        q[y] += pi_x * c_x[y];
+    }
+    base::Log(q.data(), log_q.data(), m);
+    for(int y = 0; y < m; y++)
+      if(q[y] <= 0) log_q[y] = 0;
+
+    // d(x) = D(C(x, .) || q) = sum_y C(x, y) ln(C(x, y) / q(y)).
+    // Four partial sums keep the additions independent of each other.
+    double upper = 0;
+    information = 0;
+    for(int x = 0; x < n; x++) {
+      const double* c_x = c.row(x).data();
+      double cross[4] = {0, 0, 0, 0};
+      int y = 0;
+      for(; y + 4 <= m; y += 4)
+        for(int k = 0; k < 4; k++)
+          cross[k] += c_x[y+k] * log_q[y+k];
+      for(; y < m; y++)
+        cross[0] += c_x[y] * log_q[y];
+      d[x] = neg_h[x] - ((cross[0] + cross[1]) + (cross[2] + cross[3]));
+      upper = std::max(upper, d[x]);
+      information += pi[x] * d[x];
+    }
+    result.exact = (upper - information <= tolerance_nats);
+    if(result.exact || result.rounds >= max_iterations)
+      break;
+
+    // pi(x) <- pi(x) exp(d(x)) / sum_x' pi(x') exp(d(x'))
+    base::Exp(d.data(), e_d.data(), n);
+    // Inputs out of the support of the capacity-achieving prior decay
+    // geometrically. Once negligible they are dropped, before they turn
+    // into subnormal numbers, which are very slow to multiply.
+    double sum = 0;
+    for(int x = 0; x < n; x++)
+      sum += (pi[x] *= e_d[x]);
+    for(int x = 0; x < n; x++) {
+      pi[x] /= sum;
+      if(pi[x] < kNegligible) pi[x] = 0;
+    }
+    result.rounds++;
+  }
+  result.capacity = information / std::log(2.0);
+  return result;
+}
+
+} // namespace vulnerability
+} // namespace channel
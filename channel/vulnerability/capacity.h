@@ -0,0 +1,87 @@
+#ifndef _channel_vulnerability_capacity_h
+#define _channel_vulnerability_capacity_h
+
+#include <vector>
+
+#include "../channel.h"
+#include "../../base/random.h"
+
+
+namespace channel {
+namespace vulnerability {
+
+// A capacity, i.e. the largest leakage of a channel over all priors, and
+// a prior that reaches it.
+struct CapacityResult {
+  double capacity;
+  std::vector<double> prior;
+
+  // Strategies whose linear program was solved, iterations for
+  // ShannonCapacity, or 0 for closed forms.
+  int rounds;
+
+  // Whether [capacity] is the capacity itself. When it is not, it is a
+  // lower bound reached by [prior]: the local search of the g-capacities,
+  // or ShannonCapacity stopped by max_iterations before its tolerance.
+  bool exact;
+};
+
+// ML^x_1(C) = max_pi V(X|Y) / V(X) = sum_y max_x C(x, y)
+// Multiplicative Bayes capacity, in closed form: it is always reached by
+// the uniform prior. O(|X||Y|).
+CapacityResult BayesMultCapacity(const Channel& channel);
+
+// The g-capacities below go through strategies s: Y -> W, a guess for
+// every output. For a fixed strategy, the best prior is a linear program
+// (see base/simplex.h):
+//   additive:        max_pi sum_{x,y} pi(x) C(x, y) g(s(y), x) - V_g(pi)
+//   multiplicative:  the same ratio, linearized by Charnes-Cooper,
+// and the capacity is the best of these programs over all strategies.
+//
+// When there are at most 4096 strategies, all of them are solved and the
+// result is exact. Otherwise the search alternates between the best
+// strategy for the current prior and the best prior for that strategy,
+// trying single guess changes when it stalls, from the uniform prior and
+// [restarts] random ones, for at most [max_rounds] steps each. That
+// result is a local optimum, i.e. a lower bound on the capacity, and is
+// returned with exact unset: additive capacity is NP-hard in general,
+// even for Bayes gains.
+//
+// [g] is a |W| x |X| gain matrix, as in Channel::PostGVun, with
+// non-negative gains. The random priors are drawn from [rng], or from the
+// generator of the calling thread by default (see base::ThreadRng).
+
+// ML^+_g(C) = max_pi V_g[pi > C] - V_g(pi)
+CapacityResult GainAddCapacity(const Channel& channel,
+                               const std::vector<std::vector<double> >& g,
+                               int restarts=4, int max_rounds=100,
+                               base::Rng* rng=nullptr);
+
+// ML^x_g(C) = max_pi V_g[pi > C] / V_g(pi)
+CapacityResult GainMultCapacity(const Channel& channel,
+                                const std::vector<std::vector<double> >& g,
+                                int restarts=4, int max_rounds=100,
+                                base::Rng* rng=nullptr);
+
+// C(X;Y) = max_pi I(X;Y), the Shannon capacity, in bits.
+// Blahut-Arimoto iterations over the channel matrix, each a pass over C
+// to get p(y), a vector log of p(y), a pass over C to get the divergence
+// D(C(x, .) || p(y)) of every input, and a vector exp of those.
+// They stop once the bound max_x D(C(x, .) || p(y)) on the capacity is
+// within [tolerance] bits of the mutual information of the current
+// prior, or after [max_iterations].
+//
+// [start] is a prior to start from, e.g. the result of an earlier call on
+// a similar channel; by default, the uniform prior. An input with no
+// probability there would never get any, so every input is given at
+// least 1e-6 of it.
+CapacityResult ShannonCapacity(const Channel& channel,
+                               const std::vector<double>& start=
+                                   std::vector<double>(),
+                               double tolerance=1e-9,
+                               int max_iterations=100000);
+
+} // namespace vulnerability
+} // namespace channel
+
+#endif
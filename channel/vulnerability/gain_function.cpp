@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+#include "gain_function.h"
+#include "joint_columns.h"
+
+namespace channel {
+namespace vulnerability {
+
+namespace {
+
+// The buffers of the functions below, kept per thread so that repeated
+// evaluations do not allocate.
+struct Scratch {
+  // The weight vectors being scored: the prior, or the joint columns.
+  JointColumns columns;
+  // For the scores themselves.
+  std::vector<double> values;
+  std::vector<std::pair<double, double> > points;
+  std::vector<double> score;
+  std::vector<char> touched;
+  std::vector<int> guesses;
+};
+
+Scratch& ThreadScratch() {
+  thread_local Scratch scratch;
+  return scratch;
+}
+
+// Scores every joint column of a channel.
+template <typename Matrix>
+double ScoreColumns(const GainFunction& g, const Matrix& c,
+                    const std::vector<double>& prior) {
+  JointColumns& columns = ThreadScratch().columns;
+  columns.Fill(c, prior);
+  double vulnerability = 0;
+  for(int y = 0; y < columns.cols(); y++)
+    vulnerability += g.Score(columns.secret(y), columns.weight(y),
+                             columns.size(y));
+  return vulnerability;
+}
+
+} // namespace
+
+
+////////////////
+// GainFunction
+////////////////
+double GainFunction::PriorVulnerability(
+    const std::vector<double>& prior) const {
+  std::vector<int> secret;
+  std::vector<double> weight;
+  for(int x = 0; x < (int)prior.size(); x++) {
+    if(prior[x] == 0) continue;
+    secret.push_back(x);
+    weight.push_back(prior[x]);
+  }
+  return this->Score(secret.data(), weight.data(), secret.size());
+}
+
+double GainFunction::PostVulnerability(
+    const base::MatrixView& c, const std::vector<double>& prior) const {
+  return ScoreColumns(*this, c, prior);
+}
+
+double GainFunction::PostVulnerability(
+    const base::SparseMatrix& c, const std::vector<double>& prior) const {
+  return ScoreColumns(*this, c, prior);
+}
+
+
+////////////////
+// IdentityGain
+////////////////
+IdentityGain::IdentityGain(int n_secrets) : n_secrets_(n_secrets) {}
+
+double IdentityGain::Score(const int*, const double* weight, int n) const {
+  double score = 0;
+  for(int k = 0; k < n; k++) score = std::max(score, weight[k]);
+  return score;
+}
+
+
+////////////////
+// KTriesGain
+////////////////
+KTriesGain::KTriesGain(int n_secrets, int k) : n_secrets_(n_secrets), k_(k) {
+  if(k < 1 || k > n_secrets)
+    throw std::invalid_argument("KTriesGain: k must be in [1, n_secrets]");
+}
+
+double KTriesGain::Score(const int*, const double* weight, int n) const {
+  std::vector<double>& values = ThreadScratch().values;
+  values.assign(weight, weight + n);
+  const int top = std::min(n, this->k_);
+  std::nth_element(values.begin(), values.begin() + top, values.end(),
+                   std::greater<double>());
+  double score = 0;
+  for(int k = 0; k < top; k++) score += values[k];
+  return score;
+}
+
+
+////////////////
+// MetricGain
+////////////////
+MetricGain::MetricGain(std::vector<double> positions, double threshold)
+    : n_secrets_(positions.size()), threshold_(threshold),
+      positions_(std::move(positions)) {
+  this->sorted_positions_ = this->positions_;
+  std::sort(this->sorted_positions_.begin(), this->sorted_positions_.end());
+}
+
+MetricGain::MetricGain(int n_secrets, Distance distance, double threshold)
+    : n_secrets_(n_secrets), threshold_(threshold),
+      distance_(std::move(distance)) {}
+
+double MetricGain::Score(const int* secret, const double* weight,
+                         int n) const {
+  if(n == 0) return 0;
+  const double r = this->threshold_;
+  if(this->distance_) {
+    double score = 0;
+    for(int w = 0; w < this->n_secrets_; w++) {
+      double sum = 0;
+      for(int k = 0; k < n; k++)
+        if(this->distance_(w, secret[k]) <= r) sum += weight[k];
+      score = std::max(score, sum);
+    }
+    return score;
+  }
+
+  // The weights by position, and their prefix sums. The window of each
+  // guess, [pos(w) - r, pos(w) + r], only moves right as w does.
+  Scratch& scratch = ThreadScratch();
+  std::vector<std::pair<double, double> >& points = scratch.points;
+  points.resize(n);
+  for(int k = 0; k < n; k++)
+    points[k] = std::make_pair(this->positions_[secret[k]], weight[k]);
+  std::sort(points.begin(), points.end());
+  std::vector<double>& prefix = scratch.values;
+  prefix.assign(n + 1, 0);
+  for(int k = 0; k < n; k++) prefix[k + 1] = prefix[k] + points[k].second;
+
+  double score = 0;
+  int lo = 0, hi = 0;
+  for(double center : this->sorted_positions_) {
+    while(lo < n && center - points[lo].first > r) lo++;
+    while(hi < n && points[hi].first - center <= r) hi++;
+    score = std::max(score, prefix[hi] - prefix[lo]);
+  }
+  return score;
+}
+
+
+////////////////
+// DenseGain
+////////////////
+DenseGain::DenseGain(base::Matrix g) : g_(std::move(g)) {
+  this->has_gain_.assign(this->g_.cols(), false);
+  for(int x = 0; x < this->g_.cols(); x++) {
+    double check = 0.0;
+    for(int w = 0; w < this->g_.rows(); w++) check += this->g_(w, x);
+    this->has_gain_[x] = (check != 0.0);
+  }
+}
+
+DenseGain::DenseGain(const std::vector<std::vector<double> >& g)
+    : DenseGain(base::Matrix(g)) {}
+
+double DenseGain::Score(const int* secret, const double* weight,
+                        int n) const {
+  double score = 0;
+  for(int w = 0; w < this->g_.rows(); w++) {
+    const double* g_w = this->g_.row(w).data();
+    double sum = 0;
+    for(int k = 0; k < n; k++) sum += g_w[secret[k]] * weight[k];
+    score = std::max(score, sum);
+  }
+  return score;
+}
+
+
+////////////////
+// SparseGain
+////////////////
+SparseGain::SparseGain(const base::SparseMatrix& g) : g_t_(g.Transposed()) {
+  this->has_gain_.assign(this->g_t_.rows(), false);
+  for(int x = 0; x < this->g_t_.rows(); x++) {
+    base::SparseRow row = this->g_t_.row(x);
+    double check = 0.0;
+    for(int i = 0; i < row.size; i++) check += row.value[i];
+    this->has_gain_[x] = (check != 0.0);
+  }
+}
+
+double SparseGain::Score(const int* secret, const double* weight,
+                         int n) const {
+  // Only the guesses with a gain on the secrets of the column are
+  // scored; the others score 0.
+  Scratch& scratch = ThreadScratch();
+  std::vector<double>& score = scratch.score;
+  std::vector<char>& touched = scratch.touched;
+  std::vector<int>& guesses = scratch.guesses;
+  if((int)score.size() < this->g_t_.cols()) {
+    score.resize(this->g_t_.cols(), 0);
+    touched.resize(this->g_t_.cols(), 0);
+  }
+  guesses.clear();
+  for(int k = 0; k < n; k++) {
+    base::SparseRow row = this->g_t_.row(secret[k]);
+    for(int i = 0; i < row.size; i++) {
+      const int w = row.col[i];
+      if(!touched[w]) {
+        touched[w] = 1;
+        guesses.push_back(w);
+      }
+      score[w] += row.value[i] * weight[k];
+    }
+  }
+  double best = 0;
+  for(int w : guesses) {
+    best = std::max(best, score[w]);
+    score[w] = 0;
+    touched[w] = 0;
+  }
+  return best;
+}
+
+} // namespace vulnerability
+} // namespace channel
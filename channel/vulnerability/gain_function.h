@@ -0,0 +1,157 @@
+#ifndef _channel_vulnerability_gain_function_h
+#define _channel_vulnerability_gain_function_h
+
+#include <functional>
+#include <vector>
+
+#include "../../base/matrix.h"
+#include "../../base/sparse_matrix.h"
+
+
+namespace channel {
+namespace vulnerability {
+
+// A gain function g(w, x), the gain of guessing w when the secret is x,
+// kept in whatever form its structure allows rather than as a dense
+// |W| x |X| matrix (see gvulnerability.h for that one).
+//
+// Every vulnerability is a sum of scores of weight vectors over X: the
+// prior for V_g(pi), and the joint column p(., y) for each term of
+// V_g[pi > C]. A weight vector is given by its nonzeros, and each
+// subclass scores it with max_w sum_x weight(x) g(w, x) in the way that
+// suits it; e.g. k-tries takes the top k weights. As in
+// Channel::PostGVun, vulnerabilities are never below zero.
+class GainFunction {
+  public:
+    virtual ~GainFunction() {}
+
+    // |X|
+    virtual int n_secrets() const = 0;
+
+    // max(0, max_w sum_k weight[k] g(w, secret[k])), where the [n]
+    // secrets are distinct.
+    virtual double Score(const int* secret, const double* weight,
+                         int n) const = 0;
+
+    // Whether some guess gains anything from the secret [x], i.e. as in
+    // Channel::parallel_vulnerability, whether sum_w g(w, x) != 0. Secrets
+    // without gain do not count in the parallel composition bounds.
+    virtual bool HasGain(int x) const = 0;
+
+    // V_g(pi) = max_w sum_x pi(x) g(w, x)
+    double PriorVulnerability(const std::vector<double>& prior) const;
+
+    // V_g[pi > C] = sum_y max_w sum_x pi(x) C(x, y) g(w, x)
+    // The nonzeros of c are bucketed by column once; each column is then
+    // scored.
+    double PostVulnerability(const base::MatrixView& c,
+                             const std::vector<double>& prior) const;
+    double PostVulnerability(const base::SparseMatrix& c,
+                             const std::vector<double>& prior) const;
+};
+
+
+// g(w, x) = 1 if w = x, else 0; V_g is Bayes vulnerability. A column is
+// scored by its largest weight.
+class IdentityGain : public GainFunction {
+  public:
+    explicit IdentityGain(int n_secrets);
+
+    int n_secrets() const override { return this->n_secrets_; }
+    double Score(const int* secret, const double* weight,
+                 int n) const override;
+    bool HasGain(int) const override { return true; }
+
+  private:
+    int n_secrets_;
+};
+
+
+// The guesses are the sets of k secrets, and g(w, x) = 1 if x is in w.
+// There are |X| choose k guesses, none of them stored: a column is scored
+// by the sum of its k largest weights, found with a partial selection.
+class KTriesGain : public GainFunction {
+  public:
+    KTriesGain(int n_secrets, int k);
+
+    int n_secrets() const override { return this->n_secrets_; }
+    int k() const { return this->k_; }
+    double Score(const int* secret, const double* weight,
+                 int n) const override;
+    bool HasGain(int) const override { return true; }
+
+  private:
+    int n_secrets_, k_;
+};
+
+
+// The guesses are the secrets, and g(w, x) = 1 if d(w, x) <= threshold,
+// else 0: guessing close enough is as good as guessing right.
+//
+// With secrets at positions on a line, d(w, x) = |pos(w) - pos(x)|, and
+// a column is scored with a sliding window over the sorted positions, in
+// O(|X| + n log n). With any other distance, it is O(|X| n), and still
+// no |X| x |X| table is kept.
+class MetricGain : public GainFunction {
+  public:
+    typedef std::function<double(int, int)> Distance;
+
+    MetricGain(std::vector<double> positions, double threshold);
+    MetricGain(int n_secrets, Distance distance, double threshold);
+
+    int n_secrets() const override { return this->n_secrets_; }
+    double Score(const int* secret, const double* weight,
+                 int n) const override;
+    bool HasGain(int) const override { return true; }
+
+  private:
+    int n_secrets_;
+    double threshold_;
+    // Either the position of each secret, and the same sorted, or the
+    // distance.
+    std::vector<double> positions_, sorted_positions_;
+    Distance distance_;
+};
+
+
+// An explicit |W| x |X| matrix, as in gvulnerability.h. A column is
+// scored against every guess, in O(|W| n).
+class DenseGain : public GainFunction {
+  public:
+    explicit DenseGain(base::Matrix g);
+    explicit DenseGain(const std::vector<std::vector<double> >& g);
+
+    int n_secrets() const override { return this->g_.cols(); }
+    double Score(const int* secret, const double* weight,
+                 int n) const override;
+    bool HasGain(int x) const override { return this->has_gain_[x]; }
+
+  private:
+    base::Matrix g_;
+    std::vector<bool> has_gain_;
+};
+
+
+// An explicit |W| x |X| matrix with few nonzeros, such as the one-hot
+// gains of passwords. It is kept by secret, so a column only touches the
+// guesses that gain from its secrets: O(the nonzeros of g in those
+// columns).
+class SparseGain : public GainFunction {
+  public:
+    explicit SparseGain(const base::SparseMatrix& g);
+
+    int n_secrets() const override { return this->g_t_.rows(); }
+    double Score(const int* secret, const double* weight,
+                 int n) const override;
+    bool HasGain(int x) const override { return this->has_gain_[x]; }
+
+  private:
+    // Row x holds the (w, g(w, x)) with a nonzero gain.
+    base::SparseMatrix g_t_;
+    std::vector<bool> has_gain_;
+};
+
+} // namespace vulnerability
+} // namespace channel
+
+#endif
@@ -2,68 +2,123 @@
 #include <vector>
 
 #include "guessing.h"
+#include "joint_columns.h"
 #include "../../base/distribution.h"
 
 namespace channel {
 namespace vulnerability {
 
+namespace {
+
+// The buffers of the functions below, kept per thread so that repeated
+// evaluations do not allocate.
+struct Scratch {
+  JointColumns columns;
+  std::vector<double> values;
+};
+
+Scratch& ThreadScratch() {
+  thread_local Scratch scratch;
+  return scratch;
+}
+
+// Calls f(y, p(y), G(p(., y))) for every y, G being the guessing entropy
+// of the column y of the joint matrix. p(y) is summed in the order of the
+// rows, as in Channel.
+template <typename F>
+void ForEachJointColumn(const Channel& channel, F f) {
+  JointColumns& columns = ThreadScratch().columns;
+  if(channel.is_sparse())
+    columns.Fill(channel.c_sparse(), channel.prior_distribution());
+  else
+    columns.Fill(channel.c_matrix(), channel.prior_distribution());
+  for(int y = 0; y < columns.cols(); y++) {
+    double* column = columns.weight(y);
+    const int n = columns.size(y);
+    double p_y = 0;
+    for(int k = 0; k < n; k++) p_y += column[k];
+    f(y, p_y, base::GuessingEntropy(column, n));
+  }
+}
+
+// Calls f(x, G(p(x, .))) for every x, over the nonzeros of row x.
+template <typename F>
+void ForEachJointRow(const Channel& channel, F f) {
+  std::vector<double>& values = ThreadScratch().values;
+  const std::vector<double>& prior = channel.prior_distribution();
+  for(int i = 0; i < channel.n_in(); i++) {
+    values.clear();
+    if(channel.is_sparse()) {
+      base::SparseRow row = channel.c_sparse().row(i);
+      for(int k = 0; k < row.size; k++)
+        values.push_back(row.value[k] * prior[i]);
+    } else {
+      const double* row = channel.c_matrix().row(i).data();
+      for(int j = 0; j < channel.n_out(); j++)
+        if(row[j] != 0) values.push_back(row[j] * prior[i]);
+    }
+    f(i, base::GuessingEntropy(values.data(), values.size()));
+  }
+}
+
+} // namespace
+
 // V(X)
 double Guessing::VulnerabilityPrior(const Channel& channel) const {
-  base::Distribution d(channel.prior_distribution(), -1);
-  return d.GuessingEntropy();
+  return base::DistributionView(channel.prior_distribution()).GuessingEntropy();
 }
 
 // V(Y)
 double Guessing::VulnerabilityOut(const Channel& channel) const {
-  base::Distribution d(channel.out_distribution(), -1);
-  return d.GuessingEntropy();
+  return base::DistributionView(channel.out_distribution()).GuessingEntropy();
 }
 
 // V(X|Y)
 double Guessing::VulnerabilityPosterior(const Channel& channel) const {
   double guessing = 0;
-  for(int i = 0; i < channel.n_out(); i++) {
-    std::vector<double> dist(channel.n_in(), 0);
-    for(int j = 0; j < channel.n_in(); j++)
-      dist[j] = channel.j_matrix()[j][i];
-    base::Distribution d(dist, -1);
-    guessing += channel.out_distribution()[i] * d.GuessingEntropy();
-  }
+  ForEachJointColumn(channel, [&guessing](int, double p_y, double g) {
+    guessing += p_y * g;
+  });
   return guessing;
 }
 
 // V(Y|X)
 double Guessing::VulnerabilityReversePosterior(const Channel& channel) const {
   double guessing = 0;
-  for(int i = 0; i < channel.n_in(); i++) {
-    base::Distribution d(channel.j_matrix()[i], -1);
-    guessing += channel.prior_distribution()[i] * d.GuessingEntropy();
-  }
+  const std::vector<double>& prior = channel.prior_distribution();
+  ForEachJointRow(channel, [&guessing, &prior](int x, double g) {
+    guessing += prior[x] * g;
+  });
   return guessing;
 }
 
 // V(X|Y) = max_{y} p(y) * V(X|Y=y)
 double Guessing::VulnerabilityMaxPosterior(const Channel& channel) const {
-  // TBD.
-  return 0;
+  double guessing = 0;
+  ForEachJointColumn(channel, [&guessing](int, double p_y, double g) {
+    guessing = std::max(guessing, p_y * g);
+  });
+  return guessing;
 }
 
 // V(Y|X) = max_{x} p(x) * V(Y|X=x)
 double Guessing::VulnerabilityMaxReversePosterior(const Channel& channel) const {
-  // TBD.
-  return 0;
+  double guessing = 0;
+  const std::vector<double>& prior = channel.prior_distribution();
+  ForEachJointRow(channel, [&guessing, &prior](int x, double g) {
+    guessing = std::max(guessing, prior[x] * g);
+  });
+  return guessing;
 }
 
 // L(X|Y) = V(X|Y) / V(X)
 double Guessing::LeakageMaxPosterior(const Channel& channel) const {
-  // TBD.
-  return 0;
+  return this->VulnerabilityMaxPosterior(channel) / this->VulnerabilityPrior(channel);
 }
 
 // L(Y|X) = V(Y|X) / V(Y)
 double Guessing::LeakageMaxReversePosterior(const Channel& channel) const {
-  // TBD.
-  return 0;
+  return this->VulnerabilityMaxReversePosterior(channel) / this->VulnerabilityOut(channel);
 }
 
 } // namespace vulnerability
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "gvulnerability.h"
+#include "../../base/gemm.h"
+
+
+namespace channel {
+namespace vulnerability {
+
+namespace {
+
+// Entries of the joint block and of its scores, together, built for
+// one chunk of columns. 2^21 doubles is 16MB, enough to keep the
+// products large.
+const std::size_t kChunkEntries = std::size_t(1) << 21;
+
+// Stacks the gain functions on top of each other. first[k] is the first
+// row of gains[k] in the result, and first[gains.size()] its row count.
+base::Matrix StackGains(const std::vector<base::Matrix>& gains, int n_in,
+                        std::vector<int>* first) {
+  first->assign(1, 0);
+  for(const base::Matrix& g : gains) {
+    if(g.cols() != n_in)
+      throw std::invalid_argument(
+          "gvulnerability: a gain function does not match the secrets");
+    first->push_back(first->back() + g.rows());
+  }
+  base::Matrix stacked(first->back(), n_in);
+  for(int k = 0; k < (int)gains.size(); k++)
+    std::copy(gains[k].data(), gains[k].data() + gains[k].rows()*n_in,
+              stacked.row((*first)[k]).data());
+  return stacked;
+}
+
+}  // namespace
+
+base::Matrix PriorGVulnerability(const std::vector<base::Matrix>& gains,
+                                 const base::MatrixView& priors,
+                                 int threads) {
+  const int n_in = priors.cols(), n_priors = priors.rows();
+  std::vector<int> first;
+  base::Matrix g = StackGains(gains, n_in, &first);
+  base::Matrix r(gains.size(), n_priors, 0);
+  if(g.rows() == 0) return r;
+
+  base::Matrix priors_t(n_in, n_priors);
+  for(int p = 0; p < n_priors; p++)
+    for(int x = 0; x < n_in; x++)
+      priors_t(x, p) = priors(p, x);
+
+  // scores(w, p) = sum_x g(w, x) pi_p(x)
+  base::Matrix scores = base::Multiply(g, priors_t, threads);
+  for(int k = 0; k < (int)gains.size(); k++) {
+    double* r_k = r.row(k).data();
+    for(int w = first[k]; w < first[k+1]; w++) {
+      const double* s_w = scores.row(w).data();
+      for(int p = 0; p < n_priors; p++)
+        r_k[p] = std::max(r_k[p], s_w[p]);
+    }
+  }
+  return r;
+}
+
+base::Matrix PostGVulnerability(const base::MatrixView& c,
+                                const std::vector<base::Matrix>& gains,
+                                const base::MatrixView& priors,
+                                int threads) {
+  const int n_in = c.rows(), n_out = c.cols(), n_priors = priors.rows();
+  std::vector<int> first;
+  base::Matrix g = StackGains(gains, n_in, &first);
+  base::Matrix r(gains.size(), n_priors, 0);
+  if(g.rows() == 0 || n_in == 0 || n_out == 0) return r;
+
+  // The columns (p, y), p*|Y| + y, of all the priors side by side are
+  // taken in chunks, so that neither the joint block nor its scores
+  // outgrow kChunkEntries, whatever the number of priors, of outputs or
+  // of guesses.
+  const long long n_columns = (long long)n_priors * n_out;
+  const long long chunk = std::max<long long>(
+      1, kChunkEntries / ((std::size_t)n_in + g.rows()));
+  base::Matrix joint;
+  std::vector<double> max_w;
+  for(long long j0 = 0; j0 < n_columns; j0 += chunk) {
+    const int width = std::min(n_columns - j0, chunk);
+
+    // joint(x, j - j0) = pi_p(x) C(x, y), for j = p*|Y| + y
+    joint.assign(n_in, width);
+    for(int x = 0; x < n_in; x++) {
+      const double* c_x = c.row(x).data();
+      double* j_x = joint.row(x).data();
+      int p = j0 / n_out, y = j0 % n_out;
+      for(int i = 0; i < width; i++) {
+        j_x[i] = priors(p, x) * c_x[y];
+        if(++y == n_out) {
+          y = 0;
+          p++;
+        }
+      }
+    }
+
+    // scores(w, j - j0) = sum_x g(w, x) pi_p(x) C(x, y)
+    base::Matrix scores = base::Multiply(g, joint, threads);
+    for(int k = 0; k < (int)gains.size(); k++) {
+      max_w.assign(width, 0);
+      for(int w = first[k]; w < first[k+1]; w++) {
+        const double* s_w = scores.row(w).data();
+        for(int i = 0; i < width; i++)
+          max_w[i] = std::max(max_w[i], s_w[i]);
+      }
+      // The outputs of each prior are summed in order, across chunks.
+      for(int i = 0; i < width; i++)
+        r(k, (j0 + i) / n_out) += max_w[i];
+    }
+  }
+  return r;
+}
+
+double PriorGVulnerability(const std::vector<std::vector<double> >& g,
+                           const std::vector<double>& prior) {
+  std::vector<base::Matrix> gains(1, base::Matrix(g));
+  base::MatrixView priors(prior.data(), 1, prior.size());
+  return PriorGVulnerability(gains, priors)(0, 0);
+}
+
+double PostGVulnerability(const base::MatrixView& c,
+                          const std::vector<std::vector<double> >& g,
+                          const std::vector<double>& prior) {
+  std::vector<base::Matrix> gains(1, base::Matrix(g));
+  base::MatrixView priors(prior.data(), 1, prior.size());
+  return PostGVulnerability(c, gains, priors)(0, 0);
+}
+
+double PostGVulnerability(const base::SparseMatrix& c,
+                          const std::vector<std::vector<double> >& g,
+                          const std::vector<double>& prior) {
+  // Row y of the transpose holds the nonzeros of column y, by x.
+  const base::SparseMatrix c_t = c.Transposed();
+  std::vector<double> joint;
+  double vulnerability = 0;
+  for(int y = 0; y < c_t.rows(); y++) {
+    base::SparseRow column = c_t.row(y);
+    joint.resize(column.size);
+    for(int k = 0; k < column.size; k++)
+      joint[k] = prior[column.col[k]] * column.value[k];
+
+    double max_w = 0;
+    for(const std::vector<double>& g_w : g) {
+      double score = 0;
+      for(int k = 0; k < column.size; k++)
+        score += g_w[column.col[k]] * joint[k];
+      max_w = std::max(max_w, score);
+    }
+    vulnerability += max_w;
+  }
+  return vulnerability;
+}
+
+} // namespace vulnerability
+} // namespace channel
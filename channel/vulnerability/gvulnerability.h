@@ -0,0 +1,59 @@
+#ifndef _channel_vulnerability_gvulnerability_h
+#define _channel_vulnerability_gvulnerability_h
+
+#include <vector>
+
+#include "../../base/matrix.h"
+#include "../../base/sparse_matrix.h"
+
+
+namespace channel {
+namespace vulnerability {
+
+// Batched g-vulnerabilities: many gain functions against many priors,
+// for one channel, in a few matrix products.
+//
+// A gain function is a |W| x |X| matrix g, where g(w, x) is the gain of
+// guessing w when the secret is x. A batch of priors is a P x |X| matrix
+// with one prior per row. Vulnerabilities are never below zero, as in
+// Channel::PriorGVun and Channel::PostGVun.
+
+// V_g(pi) = max_w sum_x pi(x) g(w, x)
+// Returns a matrix r with r(k, p) = V_{gains[k]}(priors[p]).
+base::Matrix PriorGVulnerability(const std::vector<base::Matrix>& gains,
+                                 const base::MatrixView& priors,
+                                 int threads=1);
+
+// V_g[pi > C] = sum_y max_w sum_x pi(x) C(x, y) g(w, x)
+// Returns a matrix r with r(k, p) = V_{gains[k]}[priors[p] > c].
+//
+// The joint matrices J = diag(pi) C of all the priors are laid side by
+// side and multiplied by all the gain functions stacked on top of each
+// other, so the whole batch is a single base::Multiply. It is split in
+// chunks of columns so that J and the scores stay within 16MB together,
+// even for one prior. The scores of each gain function are then reduced
+// with a column max. Throws std::invalid_argument if a gain function
+// does not have a column per row of c.
+base::Matrix PostGVulnerability(const base::MatrixView& c,
+                                const std::vector<base::Matrix>& gains,
+                                const base::MatrixView& priors,
+                                int threads=1);
+
+// Single gain function and prior versions of the above.
+double PriorGVulnerability(const std::vector<std::vector<double> >& g,
+                           const std::vector<double>& prior);
+double PostGVulnerability(const base::MatrixView& c,
+                          const std::vector<std::vector<double> >& g,
+                          const std::vector<double>& prior);
+
+// The same, for a channel matrix in sparse form. Each column of c is
+// scored against every guess once, so the work is |W| times the
+// nonzeros of c, plus |Y|.
+double PostGVulnerability(const base::SparseMatrix& c,
+                          const std::vector<std::vector<double> >& g,
+                          const std::vector<double>& prior);
+
+} // namespace vulnerability
+} // namespace channel
+
+#endif
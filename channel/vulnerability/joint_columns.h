@@ -0,0 +1,95 @@
+#ifndef _channel_vulnerability_joint_columns_h
+#define _channel_vulnerability_joint_columns_h
+
+#include <cstddef>
+#include <vector>
+
+#include "../../base/matrix.h"
+#include "../../base/sparse_matrix.h"
+
+namespace channel {
+namespace vulnerability {
+
+// The joint matrix p(x, y) = pi(x) C(x, y) of a channel, bucketed by
+// column, so that every column can be scored without copying it out of
+// the channel matrix and without building the joint matrix. Column y has
+// size(y) entries, the secrets x and their weights p(x, y), in the order
+// of the rows. Only the nonzeros of C with pi(x) != 0 are kept.
+//
+// The buffers are reused by every Fill, so an instance kept per thread
+// does not allocate on repeated evaluations.
+class JointColumns {
+  public:
+    // Buckets the entries given by for_each_entry(f), which calls
+    // f(x, y, C(x, y)) for the nonzeros of a matrix with [n_out] columns,
+    // row by row. A counting sort, in two passes.
+    template <typename ForEachEntry>
+    void Fill(int n_out, const std::vector<double>& prior,
+              ForEachEntry for_each_entry) {
+      std::vector<size_t>& start = this->start_;
+      start.assign(n_out + 1, 0);
+      for_each_entry([&start, &prior](int x, int y, double) {
+        if(prior[x] != 0) start[y + 1]++;
+      });
+      for(int y = 0; y < n_out; y++) start[y + 1] += start[y];
+      this->secret_.resize(start[n_out]);
+      this->weight_.resize(start[n_out]);
+      for_each_entry([this, &start, &prior](int x, int y, double c) {
+        if(prior[x] == 0) return;
+        this->secret_[start[y]] = x;
+        this->weight_[start[y]++] = prior[x] * c;
+      });
+      // The scatter moved every start to the end of its column, so column
+      // y is now [start[y-1], start[y]).
+    }
+
+    void Fill(const base::MatrixView& c, const std::vector<double>& prior) {
+      this->Fill(c.cols(), prior, [&c](auto&& f) {
+        for(int x = 0; x < c.rows(); x++) {
+          const double* row = c.row(x).data();
+          for(int y = 0; y < c.cols(); y++)
+            if(row[y] != 0) f(x, y, row[y]);
+        }
+      });
+    }
+
+    void Fill(const base::SparseMatrix& c, const std::vector<double>& prior) {
+      this->Fill(c.cols(), prior, [&c](auto&& f) {
+        for(int x = 0; x < c.rows(); x++) {
+          base::SparseRow row = c.row(x);
+          for(int k = 0; k < row.size; k++) f(x, row.col[k], row.value[k]);
+        }
+      });
+    }
+
+    int cols() const {
+      return (int)this->start_.size() - 1;
+    }
+
+    int size(int y) const {
+      return this->start_[y] - this->begin(y);
+    }
+
+    const int* secret(int y) const {
+      return this->secret_.data() + this->begin(y);
+    }
+
+    // Mutable, so that a column can be sorted in place.
+    double* weight(int y) {
+      return this->weight_.data() + this->begin(y);
+    }
+
+  private:
+    size_t begin(int y) const {
+      return y == 0 ? 0 : this->start_[y - 1];
+    }
+
+    std::vector<int> secret_;
+    std::vector<double> weight_;
+    std::vector<size_t> start_;
+};
+
+} // namespace vulnerability
+} // namespace channel
+
+#endif
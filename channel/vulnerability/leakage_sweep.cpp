@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <functional>
+
+#include "leakage_sweep.h"
+#include "gvulnerability.h"
+
+
+namespace channel {
+namespace vulnerability {
+
+namespace {
+
+// Priors evaluated by one task.
+const int kPriorsPerTask = 64;
+
+// Runs fn over chunks of [0, n), on the pool if there is one.
+void ForEachChunk(int n, base::ThreadPool* pool,
+                  const std::function<void(int, int)>& fn) {
+  if(pool == nullptr) fn(0, n);
+  else pool->ParallelFor(0, n, fn, kPriorsPerTask);
+}
+
+}  // namespace
+
+std::vector<SweepPoint> LeakageSweep::Bayes(const base::MatrixView& priors,
+                                            base::ThreadPool* pool) const {
+  const int n_in = this->c_.rows(), n_out = this->c_.cols();
+  std::vector<SweepPoint> points(priors.rows());
+  ForEachChunk(priors.rows(), pool, [&](int p0, int p1) {
+    // max_x[y] = max_x p(x, y), built one row of C at a time.
+    std::vector<double> max_x(n_out);
+    for(int p = p0; p < p1; p++) {
+      const double* pi = priors.row(p).data();
+      std::fill(max_x.begin(), max_x.end(), 0);
+      double prior = 0;
+      for(int x = 0; x < n_in; x++) {
+        const double* c_x = this->c_.row(x).data();
+        prior = std::max(prior, pi[x]);
+        for(int y = 0; y < n_out; y++)
+          max_x[y] = std::max(max_x[y], pi[x] * c_x[y]);
+      }
+      double posterior = 0;
+      for(int y = 0; y < n_out; y++)
+        posterior += max_x[y];
+      points[p].prior = prior;
+      points[p].posterior = posterior;
+    }
+  });
+  return points;
+}
+
+std::vector<SweepPoint> LeakageSweep::Gain(
+    const base::MatrixView& priors,
+    const std::vector<std::vector<double> >& g,
+    base::ThreadPool* pool) const {
+  std::vector<SweepPoint> points(priors.rows());
+  const std::vector<base::Matrix> gains(1, base::Matrix(g));
+  ForEachChunk(priors.rows(), pool, [&](int p0, int p1) {
+    // Every chunk of priors is one batched evaluation.
+    base::MatrixView chunk(priors.row(p0).data(), p1 - p0, priors.cols(),
+                           priors.stride());
+    base::Matrix prior = PriorGVulnerability(gains, chunk);
+    base::Matrix posterior = PostGVulnerability(this->c_, gains, chunk);
+    for(int p = p0; p < p1; p++) {
+      points[p].prior = prior(0, p - p0);
+      points[p].posterior = posterior(0, p - p0);
+    }
+  });
+  return points;
+}
+
+} // namespace vulnerability
+} // namespace channel
@@ -0,0 +1,60 @@
+#ifndef _channel_vulnerability_leakage_sweep_h
+#define _channel_vulnerability_leakage_sweep_h
+
+#include <vector>
+
+#include "../channel.h"
+#include "../../base/matrix.h"
+#include "../../base/thread_pool.h"
+
+
+namespace channel {
+namespace vulnerability {
+
+// The prior and posterior vulnerabilities of a channel under one prior.
+struct SweepPoint {
+  // V(X)
+  double prior;
+  // V(X|Y)
+  double posterior;
+
+  // V(X|Y) / V(X)
+  double LeakageMult() const { return this->posterior / this->prior; }
+  // V(X|Y) - V(X)
+  double LeakageAdd() const { return this->posterior - this->prior; }
+};
+
+// Evaluates the vulnerabilities of one channel under many priors, e.g. to
+// see how its leakage changes with the prior, or to look for the prior
+// that maximizes it.
+//
+// Only the channel matrix is used, through a view, so no Channel is
+// rebuilt per prior and the channel lazy caches are never touched from
+// the worker threads. The channel must outlive the sweep.
+class LeakageSweep {
+  public:
+    explicit LeakageSweep(const Channel& channel)
+      : c_(channel.c_matrix()) {}
+
+    explicit LeakageSweep(const base::MatrixView& c) : c_(c) {}
+
+    // Bayes vulnerabilities, as in vulnerability::Bayes, for every prior.
+    // [priors] has one prior per row. Without a pool, the sweep runs on
+    // the calling thread.
+    std::vector<SweepPoint> Bayes(const base::MatrixView& priors,
+                                  base::ThreadPool* pool=nullptr) const;
+
+    // g-vulnerabilities, as in Channel::PriorGVun and PostGVun, for every
+    // prior.
+    std::vector<SweepPoint> Gain(const base::MatrixView& priors,
+                                 const std::vector<std::vector<double> >& g,
+                                 base::ThreadPool* pool=nullptr) const;
+
+  private:
+    base::MatrixView c_;
+};
+
+} // namespace vulnerability
+} // namespace channel
+
+#endif
@@ -0,0 +1,138 @@
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+#include "channel/channel.h"
+#include "channel/vulnerability/bayes.h"
+#include "channel/vulnerability/capacity.h"
+#include "gtest/gtest.h"
+using std::vector;
+using channel::vulnerability::CapacityResult;
+
+
+// A random distribution over [n] elements.
+vector<double> RandomDistribution(int n, std::mt19937* rng) {
+  std::exponential_distribution<double> dist(1);
+  vector<double> d(n);
+  double sum = 0;
+  for(double& p : d) sum += (p = dist(*rng));
+  for(double& p : d) p /= sum;
+  return d;
+}
+
+channel::Channel RandomChannel(int n_in, int n_out, unsigned seed) {
+  std::mt19937 rng(seed);
+  base::Matrix c(n_in, n_out);
+  for(int x = 0; x < n_in; x++) {
+    vector<double> row = RandomDistribution(n_out, &rng);
+    std::copy(row.begin(), row.end(), c.row(x).data());
+  }
+  return channel::Channel(c);
+}
+
+vector<vector<double> > Identity(int n) {
+  vector<vector<double> > g(n, vector<double>(n, 0));
+  for(int i = 0; i < n; i++) g[i][i] = 1;
+  return g;
+}
+
+TEST(CapacityTest, BayesMultIsReachedByTheUniformPrior) {
+  channel::Channel c = RandomChannel(5, 4, 1);
+  CapacityResult r = channel::vulnerability::BayesMultCapacity(c);
+  channel::vulnerability::Bayes bayes;
+  ASSERT_NEAR(r.capacity, bayes.LeakageMultPosterior(c), 1e-12);
+
+  std::mt19937 rng(2);
+  for(int i = 0; i < 200; i++) {
+    channel::Channel cp(c.c_matrix(), RandomDistribution(5, &rng));
+    ASSERT_LE(bayes.LeakageMultPosterior(cp), r.capacity + 1e-12);
+  }
+}
+
+TEST(CapacityTest, GainMultWithBayesGainIsBayesCapacity) {
+  channel::Channel c = RandomChannel(6, 5, 3);
+  CapacityResult r = channel::vulnerability::GainMultCapacity(c, Identity(6));
+  ASSERT_NEAR(r.capacity,
+              channel::vulnerability::BayesMultCapacity(c).capacity, 1e-9);
+}
+
+TEST(CapacityTest, GainAddBeatsRandomSearch) {
+  vector<vector<double> > g = {{1, 0.5, 0, 0}, {0, 0.5, 1, 0.5}, {0, 0, 0, 1}};
+  channel::Channel c = RandomChannel(4, 3, 4);
+  CapacityResult r = channel::vulnerability::GainAddCapacity(c, g);
+  ASSERT_TRUE(r.exact);
+  channel::Channel at(c.c_matrix(), r.prior);
+  ASSERT_NEAR(r.capacity, at.PostGVun(g) - at.PriorGVun(g), 1e-12);
+
+  std::mt19937 rng(5);
+  for(int i = 0; i < 2000; i++) {
+    channel::Channel cp(c.c_matrix(), RandomDistribution(4, &rng));
+    ASSERT_LE(cp.PostGVun(g) - cp.PriorGVun(g), r.capacity + 1e-9);
+  }
+}
+
+TEST(CapacityTest, GainAddOfTheIdentityChannel) {
+  // For C = I, V[pi > C] = 1, so the leakage is 1 - max pi.
+  base::Matrix id(3, 3);
+  for(int i = 0; i < 3; i++) id(i, i) = 1;
+  CapacityResult r =
+      channel::vulnerability::GainAddCapacity(channel::Channel(id), Identity(3));
+  ASSERT_NEAR(r.capacity, 2.0/3, 1e-9);
+}
+
+TEST(CapacityTest, LocalSearchOnLargeStrategySpaces) {
+  // 6^8 strategies, too many to try them all.
+  channel::Channel c = RandomChannel(6, 8, 6);
+  vector<vector<double> > g = Identity(6);
+  CapacityResult r = channel::vulnerability::GainAddCapacity(c, g);
+  ASSERT_FALSE(r.exact);
+  channel::Channel at(c.c_matrix(), r.prior);
+  ASSERT_NEAR(r.capacity, at.PostGVun(g) - at.PriorGVun(g), 1e-12);
+  ASSERT_GE(r.capacity, c.PostGVun(g) - c.PriorGVun(g));
+
+  CapacityResult m = channel::vulnerability::GainMultCapacity(c, g);
+  ASSERT_FALSE(m.exact);
+  ASSERT_NEAR(m.capacity,
+              channel::vulnerability::BayesMultCapacity(c).capacity, 1e-9);
+
+  // The same generator gives the same restarts.
+  base::Rng rng1(7), rng2(7);
+  CapacityResult a =
+      channel::vulnerability::GainAddCapacity(c, g, 4, 100, &rng1);
+  CapacityResult b =
+      channel::vulnerability::GainAddCapacity(c, g, 4, 100, &rng2);
+  ASSERT_EQ(a.capacity, b.capacity);
+  ASSERT_EQ(a.prior, b.prior);
+}
+
+TEST(CapacityTest, ShannonOfTheBinarySymmetricChannel) {
+  // C = 1 - H(0.1), reached by the uniform prior.
+  base::Matrix bsc(2, 2);
+  bsc(0, 0) = bsc(1, 1) = 0.9;
+  bsc(0, 1) = bsc(1, 0) = 0.1;
+  CapacityResult r = channel::vulnerability::ShannonCapacity(channel::Channel(bsc));
+  ASSERT_NEAR(r.capacity, 1 + 0.9*log2(0.9) + 0.1*log2(0.1), 1e-9);
+  ASSERT_NEAR(r.prior[0], 0.5, 1e-9);
+}
+
+TEST(CapacityTest, ShannonIsTheMutualInformationOfItsPrior) {
+  channel::Channel c = RandomChannel(7, 5, 8);
+  CapacityResult r = channel::vulnerability::ShannonCapacity(c, {}, 1e-10);
+  ASSERT_TRUE(r.exact);
+  ASSERT_FALSE(channel::vulnerability::ShannonCapacity(c, {}, 1e-10, 1).exact);
+  channel::Channel at(c.c_matrix(), r.prior);
+  ASSERT_NEAR(r.capacity, at.MutualInformation(), 1e-9);
+
+  std::mt19937 rng(9);
+  for(int i = 0; i < 500; i++) {
+    channel::Channel cp(c.c_matrix(), RandomDistribution(7, &rng));
+    ASSERT_LE(cp.MutualInformation(), r.capacity + 1e-9);
+  }
+
+  // Starting from the answer, there is (almost) nothing left to do.
+  CapacityResult warm =
+      channel::vulnerability::ShannonCapacity(c, r.prior, 1e-10);
+  ASSERT_LT(warm.rounds, r.rounds);
+  ASSERT_NEAR(warm.capacity, r.capacity, 1e-9);
+}
@@ -3,8 +3,11 @@
 #include <cstdlib>
 #include <cmath>
 #include <cstring>
+#include <stdexcept>
 
+#include "base/random.h"
 #include "channel/channel.h"
+#include "channel/vulnerability/bayes.h"
 #include "gtest/gtest.h"
 using namespace std;
 
@@ -15,19 +18,302 @@ TEST(HelloTestAcc, cname) {
 // This unit test checks whether the ParseInput can understand the output
 // of the to_string function.
 TEST(ParsingTest, WithCnameWithInput) {
-  // TODO(thiagovas): To Be Implemented...
+  vector<vector<double> > c_matrix = {{1, 0, 0}, {0.25, 0.25, 0.5}};
+  channel::Channel c(c_matrix, vector<double>({0.75, 0.25}), 8);
+  c.set_cname("Hello");
+  c.set_in_names(vector<string>({"a", "b"}));
+  c.set_out_names(vector<string>({"x", "y", "z"}));
+
+  channel::Channel parsed;
+  parsed.ParseInput(c.to_string());
+  EXPECT_EQ(parsed.cname(), "Hello");
+  EXPECT_EQ(parsed.base_norm(), 8);
+  EXPECT_EQ(parsed.in_names(), c.in_names());
+  EXPECT_EQ(parsed.out_names(), c.out_names());
+  EXPECT_EQ(parsed.prior_distribution(), c.prior_distribution());
+  for(int i = 0; i < 2; i++)
+    for(int j = 0; j < 3; j++)
+      EXPECT_EQ(parsed.c_matrix()[i][j], c_matrix[i][j]);
 }
 
 TEST(ParsingTest, WithCnameWithoutInput) {
-  // TODO(thiagovas): To Be Implemented...
+  // The files of binary_sources have neither a base norm nor a prior.
+  channel::Channel c;
+  c.ParseInput("Coin\n2 2\nh t\nH T\n0.7 0.3\n0.5 0.5\n");
+  EXPECT_EQ(c.cname(), "Coin");
+  EXPECT_EQ(c.base_norm(), 0);
+  EXPECT_EQ(c.out_names(), vector<string>({"H", "T"}));
+  EXPECT_DOUBLE_EQ(c.c_matrix()[0][0], 0.7);
+  EXPECT_DOUBLE_EQ(c.c_matrix()[1][1], 0.5);
+  EXPECT_EQ(c.prior_distribution(), vector<double>(2, 1.0f/2));
 }
 
 TEST(ParsingTest, WithoutCnameWithInput) {
-  // TODO(thiagovas): To Be Implemented...
+  channel::Channel c;
+  c.ParseInput("2 1\n5\na b\nx\n1\n1\n0.2 0.8\n");
+  EXPECT_EQ(c.cname(), "");
+  EXPECT_EQ(c.base_norm(), 5);
+  EXPECT_EQ(c.in_names(), vector<string>({"a", "b"}));
+  EXPECT_EQ(c.prior_distribution(), vector<double>({0.2, 0.8}));
 }
 
 TEST(ParsingTest, WithoutCnameWithoutInput) {
-  // TODO(thiagovas): To Be Implemented...
+  channel::Channel c;
+  c.ParseInput("3 2\na b c x y 1 0 0 1 0.5 0.5");
+  EXPECT_EQ(c.cname(), "");
+  EXPECT_EQ(c.n_in(), 3);
+  EXPECT_EQ(c.n_out(), 2);
+  EXPECT_EQ(c.prior_distribution(), vector<double>(3, 1.0f/3));
+}
+
+// The derived quantities are cached, so they must follow prior changes.
+TEST(DerivedTest, FollowsPriorChanges) {
+  vector<vector<double> > c_matrix = {{1, 0}, {0.5, 0.5}};
+  channel::Channel c(c_matrix, vector<double>({0.5, 0.5}));
+  ASSERT_NEAR(c.out_distribution()[0], 0.75, 1e-9);
+  ASSERT_NEAR(c.h_matrix()[0][0], 2.0/3.0, 1e-9);
+
+  c.set_prior_distribution({1, 0});
+  ASSERT_NEAR(c.out_distribution()[0], 1, 1e-9);
+  ASSERT_NEAR(c.j_matrix()[1][0], 0, 1e-9);
+  ASSERT_NEAR(c.max_poutput()[0], 1, 1e-9);
+  ASSERT_NEAR(c.h_matrix()[0][0], 1, 1e-9);
+}
+
+// Updating one row must leave the caches as a full rebuild would.
+TEST(DerivedTest, SetRowMatchesARebuild) {
+  vector<vector<double> > c_matrix = {{0.5, 0.5, 0}, {0.2, 0.3, 0.5},
+                                      {0.1, 0.1, 0.8}};
+  vector<double> prior = {0.5, 0.3, 0.2};
+  channel::Channel c(c_matrix, prior);
+  c.h_matrix();
+  c.NormalizedMutualInformation();
+  c.ConditionalEntropy();
+
+  // The first update lowers the maximum of column 0, the second one only
+  // changes two columns.
+  vector<vector<double> > rows = {{0.1, 0.1, 0.8}, {0.1, 0.9, 0}};
+  for(const vector<double>& row : rows) {
+    c.set_row(0, row);
+    c_matrix[0] = row;
+    channel::Channel rebuilt(c_matrix, prior);
+    for(int j = 0; j < 3; j++) {
+      ASSERT_EQ(c.out_distribution()[j], rebuilt.out_distribution()[j]);
+      ASSERT_EQ(c.max_poutput()[j], rebuilt.max_poutput()[j]);
+      for(int i = 0; i < 3; i++) {
+        ASSERT_EQ(c.j_matrix()[i][j], rebuilt.j_matrix()[i][j]);
+        ASSERT_EQ(c.h_matrix()[i][j], rebuilt.h_matrix()[i][j]);
+      }
+    }
+    for(int i = 0; i < 3; i++)
+      ASSERT_EQ(c.max_pinput()[i], rebuilt.max_pinput()[i]);
+    ASSERT_EQ(c.JointEntropy(), rebuilt.JointEntropy());
+    ASSERT_EQ(c.ConditionalEntropy(), rebuilt.ConditionalEntropy());
+    ASSERT_EQ(c.NormalizedMutualInformation(),
+              rebuilt.NormalizedMutualInformation());
+  }
+
+  // Without caches, the row is just stored.
+  channel::Channel cold(vector<vector<double> >({{1, 0}, {0, 1}}));
+  cold.set_row(1, vector<double>({0.5, 0.5}));
+  ASSERT_NEAR(cold.out_distribution()[0], 0.75, 1e-7);
+  ASSERT_EQ(cold.c_matrix()[1][1], 0.5);
+}
+
+// Outputs with the same name must be merged, whatever their positions.
+TEST(CompositionTest, HiddenChoiceMergesOutputsByName) {
+  channel::Channel c1(vector<vector<double> >({{1, 0}, {0.5, 0.5}}));
+  channel::Channel c2(vector<vector<double> >({{0.25, 0.75}, {0, 1}}));
+  c1.set_out_names({"b", "a"});
+  c2.set_out_names({"c", "b"});
+
+  channel::Channel c3 = channel::Channel::hidden_choice(c1, 0.5, c2);
+  ASSERT_EQ(c3.out_names(), vector<string>({"a", "b", "c"}));
+  ASSERT_EQ(c3.in_names(), c1.in_names());
+  ASSERT_NEAR(c3.c_matrix()[0][0], 0, 1e-12);
+  ASSERT_NEAR(c3.c_matrix()[0][1], 0.5 + 0.375, 1e-12);
+  ASSERT_NEAR(c3.c_matrix()[0][2], 0.125, 1e-12);
+  ASSERT_NEAR(c3.c_matrix()[1][0], 0.25, 1e-12);
+  ASSERT_NEAR(c3.c_matrix()[1][1], 0.75, 1e-12);
+  ASSERT_NEAR(c3.c_matrix()[1][2], 0, 1e-12);
+
+  vector<string> A = {"x1"};
+  channel::Channel c4 = channel::Channel::hidden_conditional(c1, A, c2);
+  ASSERT_EQ(c4.out_names(), vector<string>({"a", "b", "c"}));
+  ASSERT_NEAR(c4.c_matrix()[0][1], 0.75, 1e-12);
+  ASSERT_NEAR(c4.c_matrix()[0][2], 0.25, 1e-12);
+  ASSERT_NEAR(c4.c_matrix()[1][0], 0.5, 1e-12);
+  ASSERT_NEAR(c4.c_matrix()[1][1], 0.5, 1e-12);
+}
+
+// An n x n channel that is the identity, except for the rows of the
+// multiples of 3, which split between two outputs. Its density is
+// below 1/4 for n >= 8.
+channel::Channel NearIdentity(int n) {
+  base::Matrix m(n, n);
+  for(int i = 0; i < n; i++) {
+    if(i % 3 == 0) {
+      m(i, i) = 0.75;
+      m(i, (i + 1) % n) = 0.25;
+    } else {
+      m(i, i) = 1;
+    }
+  }
+  vector<double> prior(n);
+  for(int i = 0; i < n; i++) prior[i] = 2.0 * (i + 1) / (n * (n + 1));
+  return channel::Channel(std::move(m), prior);
+}
+
+// The same channel, stored dense.
+channel::Channel Dense(channel::Channel c) {
+  c.set_sparse(false);
+  return c;
+}
+
+void ExpectSameMatrix(const channel::Channel& c1, const channel::Channel& c2) {
+  ASSERT_EQ(c1.n_in(), c2.n_in());
+  ASSERT_EQ(c1.n_out(), c2.n_out());
+  ASSERT_EQ(c1.out_names(), c2.out_names());
+  for(int i = 0; i < c1.n_in(); i++)
+    for(int j = 0; j < c1.n_out(); j++)
+      ASSERT_NEAR(c1.c_matrix()[i][j], c2.c_matrix()[i][j], 1e-12);
+}
+
+TEST(SparseTest, ChosenByDensity) {
+  ASSERT_TRUE(NearIdentity(8).is_sparse());
+  ASSERT_FALSE(NearIdentity(3).is_sparse());
+  ASSERT_FALSE(channel::Channel(base::Matrix(8, 8, 0.125)).is_sparse());
+
+  channel::Channel c = NearIdentity(12);
+  ASSERT_EQ(c.c_sparse().nonzeros(), 16u);
+  c.set_sparse(false);
+  ASSERT_FALSE(c.is_sparse());
+  ASSERT_EQ(c.c_matrix()(3, 4), 0.25);
+}
+
+// Skipping the zeros must not change any metric.
+TEST(SparseTest, MetricsMatchDense) {
+  channel::Channel s = NearIdentity(16), d = Dense(s);
+  ASSERT_TRUE(s.is_sparse());
+  for(int j = 0; j < 16; j++) {
+    ASSERT_EQ(s.out_distribution()[j], d.out_distribution()[j]);
+    ASSERT_EQ(s.max_poutput()[j], d.max_poutput()[j]);
+    ASSERT_EQ(s.max_pinput()[j], d.max_pinput()[j]);
+    for(int i = 0; i < 16; i++) {
+      ASSERT_EQ(s.j_matrix()[i][j], d.j_matrix()[i][j]);
+      ASSERT_EQ(s.h_matrix()[i][j], d.h_matrix()[i][j]);
+    }
+  }
+  ASSERT_EQ(s.ShannonEntropyOut(), d.ShannonEntropyOut());
+  ASSERT_EQ(s.ConditionalEntropy(), d.ConditionalEntropy());
+  ASSERT_EQ(s.JointEntropy(), d.JointEntropy());
+  ASSERT_EQ(s.MutualInformation(), d.MutualInformation());
+
+  channel::vulnerability::Bayes b;
+  ASSERT_EQ(b.VulnerabilityPosterior(s), b.VulnerabilityPosterior(d));
+  ASSERT_EQ(b.VulnerabilityMaxPosterior(s), b.VulnerabilityMaxPosterior(d));
+  ASSERT_EQ(b.VulnerabilityMaxReversePosterior(s),
+            b.VulnerabilityMaxReversePosterior(d));
+
+  vector<vector<double> > g(16, vector<double>(16, 0));
+  for(int i = 0; i < 16; i++) {
+    g[i][i] = 1;
+    g[i][(i + 5) % 16] = 0.5;
+  }
+  ASSERT_NEAR(s.PostGVun(g), d.PostGVun(g), 1e-12);
+}
+
+TEST(SparseTest, CompositionsMatchDense) {
+  channel::Channel s1 = NearIdentity(9), s2 = NearIdentity(9);
+  s2.set_out_names({"y4", "y5", "y6", "y7", "y8", "z0", "z1", "z2", "z3"});
+  channel::Channel d1 = Dense(s1), d2 = Dense(s2);
+
+  channel::Channel parallel = s1 || s2;
+  ASSERT_TRUE(parallel.is_sparse());
+  ExpectSameMatrix(parallel, d1 || d2);
+  ExpectSameMatrix(s1 || d2, d1 || d2);
+
+  channel::Channel cascade = s1 * s1;
+  ASSERT_TRUE(cascade.is_sparse());
+  ExpectSameMatrix(cascade, d1 * d1);
+
+  using channel::Channel;
+  ExpectSameMatrix(Channel::hidden_choice(s1, 0.3, s2),
+                   Channel::hidden_choice(d1, 0.3, d2));
+  ExpectSameMatrix(Channel::visible_choice(s1, 0.3, s2),
+                   Channel::visible_choice(d1, 0.3, d2));
+  vector<string> A = {"x0", "x4", "x5"};
+  ExpectSameMatrix(Channel::visible_conditional(s1, A, s2),
+                   Channel::visible_conditional(d1, A, d2));
+  ExpectSameMatrix(Channel::hidden_conditional(s1, A, s2),
+                   Channel::hidden_conditional(d1, A, d2));
+}
+
+// Writing a row makes the channel dense.
+TEST(SparseTest, SetRow) {
+  channel::Channel c = NearIdentity(8);
+  c.out_distribution();
+  c.set_row(1, vector<double>(8, 0.125));
+  ASSERT_FALSE(c.is_sparse());
+  ASSERT_EQ(c.c_matrix()(1, 7), 0.125);
+  ASSERT_EQ(c.c_matrix()(0, 1), 0.25);
+}
+
+// The sparse copy of a dense channel follows the writes.
+TEST(SparseTest, SparseCopyFollowsWrites) {
+  channel::Channel c(base::Matrix({{0.5, 0.5}, {0.25, 0.75}}));
+  ASSERT_FALSE(c.is_sparse());
+  ASSERT_EQ(c.c_sparse().nonzeros(), 4u);
+  c.set_row(0, vector<double>({1, 0}));
+  ASSERT_EQ(c.c_sparse().nonzeros(), 3u);
+  ASSERT_EQ(c.c_sparse().row(0).size, 1);
+  ASSERT_EQ(c.c_sparse().row(0).value[0], 1);
+
+  base::Rng rng(7);
+  c.Randomize(&rng);
+  base::Matrix dense = c.c_sparse().ToDense();
+  for(int i = 0; i < 2; i++)
+    for(int j = 0; j < 2; j++)
+      ASSERT_EQ(dense(i, j), c.c_matrix()(i, j));
+}
+
+TEST(AlphabetTest, EqualNamesShareOneAlphabet) {
+  channel::Channel c1(base::Matrix(3, 2, 0.5));
+  channel::Channel c2(base::Matrix(3, 4, 0.25));
+  ASSERT_EQ(c1.in_alphabet(), c2.in_alphabet());
+  ASSERT_TRUE(channel::Channel::CompatibleChannels(c1, c2));
+  ASSERT_EQ(c2.out_index("y3"), 3);
+
+  c2.set_in_names({"x0", "x1", "z"});
+  ASSERT_FALSE(channel::Channel::CompatibleChannels(c1, c2));
+  c2.set_in_names(c1.in_names());
+  ASSERT_TRUE(channel::Channel::CompatibleChannels(c1, c2));
+  ASSERT_THROW(c2.in_index("z"), std::out_of_range);
+}
+
+// As with the name maps alphabets replaced, a repeated name maps to its
+// last position.
+TEST(AlphabetTest, RepeatedNamesKeepTheLastPosition) {
+  channel::Alphabet::Ptr a = channel::Alphabet::Make({"a", "b", "a"});
+  ASSERT_EQ(a->size(), 3);
+  ASSERT_EQ(a->index("a"), 2);
+  ASSERT_EQ(a->index("b"), 1);
+  ASSERT_EQ(a->position(channel::SymbolTable::Intern("a")), 2);
+}
+
+TEST(AlphabetTest, DefaultAlphabetsAreKept) {
+  channel::Alphabet::Ptr a = channel::Alphabet::Default("x", 12, false);
+  ASSERT_EQ(channel::Alphabet::Default("x", 12, false), a);
+  ASSERT_NE(channel::Alphabet::Default("x", 12, true), a);
+  ASSERT_EQ(channel::Alphabet::Default("x", 12, true)->names()[3], "x03");
+
+  // The compositions keep the names of their operands.
+  channel::Channel c1(base::Matrix(3, 2, 0.5)), c2(base::Matrix(2, 4, 0.25));
+  c1.set_in_names({"a", "b", "c"});
+  channel::Channel c3 = c1 * c2;
+  ASSERT_EQ(c3.in_alphabet(), c1.in_alphabet());
+  ASSERT_EQ(c3.out_alphabet(), c2.out_alphabet());
+  ASSERT_EQ(c3.prior_distribution(), c1.prior_distribution());
 }
 
 /*
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "channel/channel.h"
+#include "channel/channel_file.h"
+#include "gtest/gtest.h"
+using std::vector;
+
+
+std::string TempPath(const std::string& name) {
+  const char* dir = std::getenv("TEST_TMPDIR");
+  return std::string(dir ? dir : "/tmp") + "/" + name;
+}
+
+channel::Channel Example() {
+  channel::Channel c(vector<vector<double> >({{0.1, 0.2, 0.7}, {1.0/3, 1.0/3, 1.0/3}}),
+                     vector<double>({0.25, 0.75}), 12);
+  c.set_cname("example");
+  c.set_in_names({"alice", "bob"});
+  c.set_out_names({"a", "bb", "ccc"});
+  return c;
+}
+
+TEST(ChannelFileTest, DoubleFilesRoundTripExactly) {
+  const std::string path = TempPath("double.qch");
+  channel::Channel c = Example();
+  channel::WriteChannelFile(c, path);
+  ASSERT_TRUE(channel::IsChannelFile(path));
+
+  channel::MappedChannel mapped(path);
+  ASSERT_EQ(mapped.cname(), "example");
+  ASSERT_EQ(mapped.n_in(), 2);
+  ASSERT_EQ(mapped.n_out(), 3);
+  ASSERT_EQ(mapped.base_norm(), 12);
+  ASSERT_EQ(mapped.in_names(), c.in_names());
+  ASSERT_EQ(mapped.out_names(), c.out_names());
+  for(int i = 0; i < 2; i++) {
+    ASSERT_EQ(mapped.prior_distribution()[i], c.prior_distribution()[i]);
+    for(int j = 0; j < 3; j++)
+      ASSERT_EQ(mapped.c_matrix()(i, j), c.c_matrix()(i, j));
+  }
+
+  channel::Channel read = channel::ReadChannelFile(path);
+  ASSERT_EQ(read.to_string(), c.to_string());
+  ASSERT_TRUE(channel::Alphabet::Same(read.in_alphabet(), c.in_alphabet()));
+  std::remove(path.c_str());
+}
+
+TEST(ChannelFileTest, FloatFilesKeepFloatPrecision) {
+  const std::string path = TempPath("float.qch");
+  channel::Channel c = Example();
+  channel::WriteChannelFile(c, path, channel::ChannelFilePrecision::kFloat);
+  channel::MappedChannel mapped(path);
+  for(int i = 0; i < 2; i++)
+    for(int j = 0; j < 3; j++)
+      ASSERT_EQ(mapped.c_matrix()(i, j), (float)c.c_matrix()(i, j));
+  ASSERT_EQ(mapped.prior_distribution()[1], 0.75);
+  std::remove(path.c_str());
+}
+
+TEST(ChannelFileTest, RejectsInvalidFiles) {
+  ASSERT_THROW(channel::MappedChannel(TempPath("missing.qch")),
+               std::runtime_error);
+
+  const std::string text = TempPath("text.qch");
+  std::ofstream(text) << Example().to_string();
+  ASSERT_FALSE(channel::IsChannelFile(text));
+  ASSERT_THROW(channel::MappedChannel m(text), std::runtime_error);
+
+  // A valid file cut short.
+  const std::string path = TempPath("short.qch");
+  channel::WriteChannelFile(Example(), path);
+  std::string bytes;
+  {
+    std::ifstream f(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+  }
+  std::ofstream(path, std::ios::binary) << bytes.substr(0, bytes.size() - 8);
+  ASSERT_THROW(channel::MappedChannel m(path), std::runtime_error);
+
+  // A header with far more names than the file holds fails before they
+  // are allocated. n_in and n_out are at bytes 16 and 20.
+  std::string huge(bytes);
+  const int32_t n = 2000000000;
+  huge.replace(16, sizeof(n), reinterpret_cast<const char*>(&n), sizeof(n));
+  huge.replace(20, sizeof(n), reinterpret_cast<const char*>(&n), sizeof(n));
+  std::ofstream(path, std::ios::binary) << huge;
+  ASSERT_THROW(channel::MappedChannel m(path), std::runtime_error);
+  std::remove(text.c_str());
+  std::remove(path.c_str());
+}
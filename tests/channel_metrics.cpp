@@ -0,0 +1,84 @@
+#include <vector>
+
+#include "base/matrix.h"
+#include "channel/channel.h"
+#include "channel/channel_metrics.h"
+#include "channel/vulnerability/bayes.h"
+#include "gtest/gtest.h"
+using namespace std;
+using channel::Channel;
+using channel::ChannelMetrics;
+
+namespace {
+
+// Every field must be the value of the function that gives it alone.
+void ExpectSameMetrics(const Channel& c) {
+  channel::vulnerability::Bayes b;
+  ChannelMetrics m = channel::ComputeChannelMetrics(c);
+  ASSERT_EQ(m.fields, (unsigned)ChannelMetrics::kAll);
+  ASSERT_DOUBLE_EQ(m.shannon_entropy_prior, c.ShannonEntropyPrior());
+  ASSERT_DOUBLE_EQ(m.shannon_entropy_out, c.ShannonEntropyOut());
+  ASSERT_DOUBLE_EQ(m.conditional_entropy, c.ConditionalEntropy());
+  ASSERT_DOUBLE_EQ(m.conditional_entropy_hyper, c.ConditionalEntropyHyper());
+  ASSERT_DOUBLE_EQ(m.joint_entropy, c.JointEntropy());
+  ASSERT_DOUBLE_EQ(m.mutual_information, c.MutualInformation());
+  ASSERT_DOUBLE_EQ(m.normalized_mutual_information,
+                   c.NormalizedMutualInformation());
+  ASSERT_DOUBLE_EQ(m.symmetric_uncertainty, c.SymmetricUncertainty());
+  ASSERT_DOUBLE_EQ(m.bayes_prior, b.VulnerabilityPrior(c));
+  ASSERT_DOUBLE_EQ(m.bayes_out, b.VulnerabilityOut(c));
+  ASSERT_DOUBLE_EQ(m.bayes_posterior, b.VulnerabilityPosterior(c));
+  ASSERT_DOUBLE_EQ(m.bayes_reverse_posterior,
+                   b.VulnerabilityReversePosterior(c));
+  ASSERT_DOUBLE_EQ(m.bayes_max_posterior, b.VulnerabilityMaxPosterior(c));
+  ASSERT_DOUBLE_EQ(m.bayes_max_reverse_posterior,
+                   b.VulnerabilityMaxReversePosterior(c));
+  ASSERT_DOUBLE_EQ(m.bayes_leakage_mult_posterior, b.LeakageMultPosterior(c));
+  ASSERT_DOUBLE_EQ(m.bayes_leakage_mult_reverse_posterior,
+                   b.LeakageMultReversePosterior(c));
+}
+
+}  // namespace
+
+TEST(ChannelMetricsTest, DenseMatchesTheFunctions) {
+  Channel c(base::Matrix({{0.5, 0.25, 0.25, 0}, {0, 1, 0, 0},
+                          {0.1, 0.2, 0.3, 0.4}}),
+            vector<double>({0.2, 0.3, 0.5}));
+  ASSERT_FALSE(c.is_sparse());
+  ExpectSameMetrics(c);
+}
+
+TEST(ChannelMetricsTest, SparseMatchesTheFunctions) {
+  // Mostly the identity, with an output that never happens.
+  base::Matrix m(12, 13);
+  for(int i = 0; i < 12; i++) m(i, i) = 1;
+  m(3, 3) = 0.5;
+  m(3, 7) = 0.5;
+  vector<double> prior(12);
+  for(int i = 0; i < 12; i++) prior[i] = (i + 1) / 78.0;
+  Channel c(m, prior);
+  ASSERT_TRUE(c.is_sparse());
+  ExpectSameMetrics(c);
+}
+
+TEST(ChannelMetricsTest, OnlyTheSelectedFields) {
+  Channel c(base::Matrix({{0.5, 0.5}, {0.25, 0.75}}));
+  unsigned fields = ChannelMetrics::kNormalizedMutualInformation |
+                    ChannelMetrics::kBayesMaxPosterior;
+  ChannelMetrics m = channel::ComputeChannelMetrics(c, fields);
+  ASSERT_EQ(m.fields, fields);
+  ASSERT_TRUE(m.has(ChannelMetrics::kBayesMaxPosterior));
+  ASSERT_FALSE(m.has(ChannelMetrics::kBayes));
+  ASSERT_DOUBLE_EQ(m.normalized_mutual_information,
+                   c.NormalizedMutualInformation());
+  ASSERT_DOUBLE_EQ(m.bayes_max_posterior,
+                   channel::vulnerability::Bayes().VulnerabilityMaxPosterior(c));
+  // The intermediates are not reported.
+  ASSERT_EQ(m.shannon_entropy_prior, 0);
+  ASSERT_EQ(m.mutual_information, 0);
+  ASSERT_EQ(m.bayes_out, 0);
+
+  m = channel::ComputeChannelMetrics(c, ChannelMetrics::kBayesPrior);
+  ASSERT_DOUBLE_EQ(m.bayes_prior, 0.5);
+  ASSERT_EQ(m.joint_entropy, 0);
+}
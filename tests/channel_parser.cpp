@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "base/matrix.h"
+#include "channel/channel.h"
+#include "channel/channel_parser.h"
+#include "gtest/gtest.h"
+using namespace std;
+
+namespace {
+
+channel::Channel Parse(const string& text) {
+  return channel::ParseChannel(text.data(), text.data() + text.size(), "test");
+}
+
+// Returns the error of parsing [text], which must fail.
+channel::ParseError ParseFailure(const string& text) {
+  try {
+    Parse(text);
+  } catch(const channel::ParseError& e) {
+    return e;
+  }
+  ADD_FAILURE() << "parsed: " << text;
+  return channel::ParseError("", 0, 0, "");
+}
+
+}  // namespace
+
+TEST(ChannelParserTest, NumbersMatchStrtod) {
+  // Short numbers take the exact path, long ones the stream.
+  vector<string> numbers = {"0.1", "0.3", "1e-3", "2.5E-1", "0.00000001",
+                            "0.33333333333333331483", "0.1000000000000000055511",
+                            "1234567890123456789e-19", "0", "+0.5"};
+  for(const string& number : numbers) {
+    double value = strtod(number.c_str(), nullptr);
+    char rest[32];
+    snprintf(rest, sizeof(rest), "%.17g", 1 - value);
+    channel::Channel c = Parse("1 2\na x y " + number + " " + rest);
+    EXPECT_EQ(c.c_matrix()[0][0], value) << number;
+  }
+}
+
+TEST(ChannelParserTest, ReportsLineAndColumn) {
+  channel::ParseError e = ParseFailure("C\n2 2\na b\nx y\n1 0\n0.5 zero\n");
+  EXPECT_EQ(e.line(), 6);
+  EXPECT_EQ(e.column(), 5);
+  EXPECT_EQ(string(e.what()).find("test:6:5:"), 0u);
+
+  e = ParseFailure("C\nn 2\n");
+  EXPECT_EQ(e.line(), 2);
+  EXPECT_EQ(e.column(), 1);
+}
+
+TEST(ChannelParserTest, RejectsNonStochasticRows) {
+  channel::ParseError e = ParseFailure("C\n2 2\na b\nx y\n1 0\n  0.5 0.6\n");
+  EXPECT_EQ(e.line(), 6);
+  EXPECT_EQ(e.column(), 3);
+
+  // Rounded values are fine, as in crowds_9.
+  EXPECT_NO_THROW(Parse("3 2\na b c x y 0.334 0.667 1 0 0 1"));
+
+  e = ParseFailure("C 2 2 a b x y 1 0 0 1 0.5 0.7");
+  EXPECT_EQ(e.column(), 23);
+  EXPECT_NE(string(e.what()).find("prior"), string::npos);
+}
+
+TEST(ChannelParserTest, RejectsNegativeAndNonFinite) {
+  EXPECT_EQ(ParseFailure("C 1 2 a x y -0.5 1.5").column(), 13);
+  EXPECT_EQ(ParseFailure("C 1 2 a x y inf 0").column(), 13);
+  EXPECT_EQ(ParseFailure("C 1 2 a x y 1e400 0").column(), 13);
+}
+
+TEST(ChannelParserTest, RejectsWrongCounts) {
+  // Too short: reported at the end of the input.
+  channel::ParseError e = ParseFailure("C\n2 2\na b\nx y\n1 0 0.5\n");
+  EXPECT_EQ(e.line(), 6);
+  EXPECT_EQ(e.column(), 1);
+
+  // Far too short for its dimensions: reported at them, without trying to
+  // allocate the matrix.
+  e = ParseFailure("C 200000 200000 a b");
+  EXPECT_EQ(e.line(), 1);
+  EXPECT_EQ(e.column(), 3);
+  e = ParseFailure("C\n2 2\na b\nx y\n1 0\n");
+  EXPECT_EQ(e.line(), 2);
+  EXPECT_EQ(e.column(), 1);
+
+  // Too long: reported at the first extra value.
+  e = ParseFailure("C 2 2 7 a b x y 1 0 0 1 0.5 0.5 extra");
+  EXPECT_EQ(e.column(), 33);
+
+  // Not a base norm.
+  e = ParseFailure("C 2 2 7.5 a b x y 1 0 0 1");
+  EXPECT_EQ(e.column(), 7);
+
+  EXPECT_THROW(Parse(""), channel::ParseError);
+  EXPECT_THROW(Parse("C 0 2"), channel::ParseError);
+}
+
+TEST(ChannelParserTest, ReadsEveryLayout) {
+  // With and without the base norm and the prior.
+  const string names = "a b c x y\n", rows = "1 0\n0.25 0.75\n0 1\n";
+  const string prior = "0.5 0.25 0.25\n";
+  for(int layout = 0; layout < 4; layout++) {
+    const bool base_norm = layout & 1, has_prior = layout & 2;
+    channel::Channel c = Parse("C\n3 2\n" + string(base_norm ? "4\n" : "") +
+                               names + rows + (has_prior ? prior : ""));
+    EXPECT_EQ(c.base_norm(), base_norm ? 4 : 0);
+    EXPECT_EQ(c.in_names(), vector<string>({"a", "b", "c"}));
+    EXPECT_EQ(c.out_names(), vector<string>({"x", "y"}));
+    EXPECT_EQ(c.c_matrix()[1][0], 0.25);
+    EXPECT_EQ(c.c_matrix()[2][1], 1);
+    EXPECT_EQ(c.prior_distribution()[0], has_prior ? 0.5 : 1.0f/3);
+  }
+
+  // One output: every row is a single value.
+  channel::Channel c = Parse("2 1\n7 a b y 1 1 0.75 0.25");
+  EXPECT_EQ(c.base_norm(), 7);
+  EXPECT_EQ(c.prior_distribution()[1], 0.25);
+
+  // The rows are found with the base norm too.
+  channel::ParseError e = ParseFailure("C 2 2 4 a b x y 1 0 0.5 0.6");
+  EXPECT_EQ(e.column(), 21);
+  EXPECT_NE(string(e.what()).find("row 2"), string::npos);
+}
+
+TEST(ChannelParserTest, MissingFile) {
+  channel::Channel c;
+  EXPECT_THROW(c.ParseFile("/nonexistent/channel"), std::runtime_error);
+}
+
+TEST(ChannelParserTest, ReadsAFile) {
+  channel::Channel c(base::Matrix({{0.5, 0.5}, {0.25, 0.75}}), 4);
+  c.set_cname("C");
+  const string path = ::testing::TempDir() + "channel_parser_test.txt";
+  FILE* file = fopen(path.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  fputs(c.to_string().c_str(), file);
+  fclose(file);
+
+  channel::Channel read;
+  read.ParseFile(path);
+  remove(path.c_str());
+  EXPECT_EQ(read.cname(), "C");
+  EXPECT_EQ(read.base_norm(), 4);
+  EXPECT_EQ(read.c_matrix()[1][1], 0.75);
+}
@@ -0,0 +1,65 @@
+#include <vector>
+#include <random>
+
+#include "channel/channel.h"
+#include "channel/count_evaluator.h"
+#include "channel/vulnerability/bayes.h"
+#include "gtest/gtest.h"
+using std::vector;
+
+
+// The channel with joint distribution counts / total.
+channel::Channel JointChannel(const vector<int>& counts, int n_in, int n_out) {
+  vector<vector<double> > c_matrix(n_in, vector<double>(n_out, 0));
+  vector<double> prior(n_in, 0);
+  double total = 0;
+  for(int x = 0; x < n_in; x++) {
+    for(int y = 0; y < n_out; y++) prior[x] += counts[x*n_out + y];
+    for(int y = 0; y < n_out; y++)
+      if(prior[x] != 0) c_matrix[x][y] = counts[x*n_out + y] / prior[x];
+    total += prior[x];
+  }
+  for(double& p : prior) p /= total;
+  return channel::Channel(c_matrix, prior);
+}
+
+template <int NIn, int NOut>
+void ExpectSameMetrics(const vector<int>& counts) {
+  channel::CountEvaluator<NIn, NOut> evaluator(counts.data());
+  channel::Channel c = JointChannel(counts, NIn, NOut);
+  channel::vulnerability::Bayes bayes;
+  EXPECT_NEAR(evaluator.ShannonEntropyPrior(), c.ShannonEntropyPrior(), 1e-12);
+  EXPECT_NEAR(evaluator.ShannonEntropyOut(), c.ShannonEntropyOut(), 1e-12);
+  EXPECT_NEAR(evaluator.ConditionalEntropyHyper(),
+              c.ConditionalEntropyHyper(), 1e-12);
+  EXPECT_NEAR(evaluator.NormalizedMutualInformation(),
+              c.NormalizedMutualInformation(), 1e-12);
+  EXPECT_NEAR(evaluator.LeakageMultPosterior(),
+              bayes.LeakageMultPosterior(c), 1e-12);
+  EXPECT_NEAR(evaluator.LeakageMultReversePosterior(),
+              bayes.LeakageMultReversePosterior(c), 1e-12);
+}
+
+TEST(CountEvaluatorTest, MatchesChannelOnRandomJointCounts) {
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<int> dist(0, 1000);
+  for(int t = 0; t < 50; t++) {
+    vector<int> counts(3*4);
+    for(int& count : counts) count = dist(rng);
+    ExpectSameMetrics<3, 4>(counts);
+  }
+}
+
+TEST(CountEvaluatorTest, MatchesChannelWithEqualRowSums) {
+  // Rows summing to 20: C = counts / 20 under a uniform prior.
+  ExpectSameMetrics<2, 3>({0, 5, 15, 10, 10, 0});
+  ExpectSameMetrics<4, 2>({20, 0, 0, 20, 7, 13, 13, 7});
+}
+
+TEST(CountEvaluatorTest, HandlesEmptyRowsAndColumns) {
+  ExpectSameMetrics<3, 3>({0, 4, 0, 0, 0, 0, 2, 1, 0});
+  channel::CountEvaluator<2, 2> identity(vector<int>({3, 0, 0, 3}).data());
+  ASSERT_DOUBLE_EQ(identity.NormalizedMutualInformation(), 1);
+  ASSERT_DOUBLE_EQ(identity.LeakageMultPosterior(), 2);
+  ASSERT_EQ(identity.total(), 6);
+}
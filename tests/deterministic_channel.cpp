@@ -0,0 +1,133 @@
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "channel/channel.h"
+#include "channel/deterministic_channel.h"
+#include "channel/vulnerability/bayes.h"
+#include "gtest/gtest.h"
+using namespace std;
+using channel::Channel;
+using channel::DeterministicChannel;
+
+namespace {
+
+// x -> x mod 4 over 10 inputs, under a prior that is not uniform.
+DeterministicChannel Mod4() {
+  vector<int> map(10);
+  vector<double> prior(10);
+  for(int x = 0; x < 10; x++) {
+    map[x] = x % 4;
+    prior[x] = (x + 1) / 55.0;
+  }
+  return DeterministicChannel(map, 4, prior);
+}
+
+void ExpectSameMatrix(const Channel& c1, const Channel& c2) {
+  ASSERT_EQ(c1.n_in(), c2.n_in());
+  ASSERT_EQ(c1.n_out(), c2.n_out());
+  for(int i = 0; i < c1.n_in(); i++)
+    for(int j = 0; j < c1.n_out(); j++)
+      ASSERT_NEAR(c1.c_matrix()[i][j], c2.c_matrix()[i][j], 1e-12);
+}
+
+}  // namespace
+
+TEST(DeterministicChannelTest, ChannelRoundTrip) {
+  DeterministicChannel d = Mod4();
+  Channel c = d.ToChannel();
+  ASSERT_TRUE(DeterministicChannel::IsDeterministic(c));
+  ASSERT_EQ(c.c_matrix()(5, 1), 1);
+  ASSERT_EQ(c.prior_distribution(), d.prior_distribution());
+
+  DeterministicChannel back(c);
+  ASSERT_EQ(back.map(), d.map());
+  ASSERT_EQ(back.out_names(), d.out_names());
+
+  c.set_row(0, vector<double>({0.5, 0.5, 0, 0}));
+  ASSERT_FALSE(DeterministicChannel::IsDeterministic(c));
+  ASSERT_THROW(DeterministicChannel back2(c), std::invalid_argument);
+  ASSERT_THROW(DeterministicChannel(vector<int>({0, 2}), 2),
+               std::invalid_argument);
+}
+
+// The metrics must be the ones of the equivalent Channel.
+TEST(DeterministicChannelTest, MetricsMatchChannel) {
+  DeterministicChannel d = Mod4();
+  Channel c = d.ToChannel();
+  channel::vulnerability::Bayes b;
+
+  ASSERT_NEAR(d.ShannonEntropyOut(), c.ShannonEntropyOut(), 1e-12);
+  ASSERT_NEAR(d.ConditionalEntropy(), c.ConditionalEntropy(), 1e-12);
+  ASSERT_NEAR(d.ConditionalEntropyHyper(), c.ConditionalEntropyHyper(), 1e-12);
+  ASSERT_NEAR(d.JointEntropy(), c.JointEntropy(), 1e-12);
+  ASSERT_NEAR(d.MutualInformation(), c.MutualInformation(), 1e-12);
+  ASSERT_NEAR(d.NormalizedMutualInformation(),
+              c.NormalizedMutualInformation(), 1e-12);
+  ASSERT_NEAR(d.VulnerabilityOut(), b.VulnerabilityOut(c), 1e-12);
+  ASSERT_NEAR(d.VulnerabilityPosterior(), b.VulnerabilityPosterior(c), 1e-12);
+  ASSERT_NEAR(d.VulnerabilityReversePosterior(),
+              b.VulnerabilityReversePosterior(c), 1e-12);
+
+  // V(X|Y) is the sum of the largest prior of each class: 10, 9, 8, 7.
+  ASSERT_NEAR(d.VulnerabilityPosterior(), 34 / 55.0, 1e-12);
+
+  vector<vector<double> > g(10, vector<double>(10, 0));
+  for(int x = 0; x < 10; x++) {
+    g[x][x] = 1;
+    g[x][(x + 3) % 10] = 0.5;
+  }
+  ASSERT_NEAR(d.PriorGVun(g), c.PriorGVun(g), 1e-12);
+  ASSERT_NEAR(d.PostGVun(g), c.PostGVun(g), 1e-12);
+}
+
+TEST(DeterministicChannelTest, CompositionsMatchChannel) {
+  DeterministicChannel d1 = Mod4();
+  vector<int> map2 = {0, 1, 2, 0, 1, 2, 0, 1, 2, 0};
+  DeterministicChannel d2(map2, 3);
+  DeterministicChannel parity(vector<int>({0, 1, 0, 1}), 2);
+
+  // Parallel packs the outputs.
+  DeterministicChannel parallel = d1 || d2;
+  ASSERT_EQ(parallel.n_out(), 12);
+  ASSERT_EQ(parallel(7), 3*3 + 1);
+  ExpectSameMatrix(parallel.ToChannel(), d1.ToChannel() || d2.ToChannel());
+
+  // Cascade gathers.
+  DeterministicChannel cascade = d1 * parity;
+  ASSERT_EQ(cascade(7), 1);
+  ExpectSameMatrix(cascade.ToChannel(), d1.ToChannel() * parity.ToChannel());
+
+  // Mixed with a general channel.
+  Channel noisy(base::Matrix({{0.5, 0.25, 0.25, 0}, {0, 1, 0, 0},
+                              {0.1, 0.2, 0.3, 0.4}, {0, 0, 0.5, 0.5}}));
+  ExpectSameMatrix(d1 * noisy, d1.ToChannel() * noisy);
+  ExpectSameMatrix(noisy * parity, noisy * parity.ToChannel());
+
+  Channel wide(base::Matrix(10, 3, 1.0/3));
+  ExpectSameMatrix(wide || d1, wide || d1.ToChannel());
+  ExpectSameMatrix(d1 || wide, d1.ToChannel() || wide);
+
+  // Too many outputs for an int.
+  DeterministicChannel many(vector<int>(10, 0), 100000);
+  Channel many_noisy(base::Matrix(10, 30000, 1.0/30000));
+  ASSERT_THROW(many || many_noisy, std::invalid_argument);
+  ASSERT_THROW(many_noisy || many, std::invalid_argument);
+
+  ASSERT_THROW(d1 * d2, std::invalid_argument);
+  d2.set_in_names({"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"});
+  ASSERT_THROW(d1 || d2, std::invalid_argument);
+}
+
+TEST(DeterministicChannelTest, Identity) {
+  DeterministicChannel d = DeterministicChannel::Identity(6);
+  ASSERT_EQ(d.out_names(), d.in_names());
+  ASSERT_NEAR(d.VulnerabilityPosterior(), 1, 1e-12);
+
+  Channel c(6, 6);
+  c.Identity();
+  ASSERT_TRUE(c.is_sparse());
+  ASSERT_EQ(c.out_names(), c.in_names());
+  ASSERT_EQ(DeterministicChannel(c).map(), d.map());
+}
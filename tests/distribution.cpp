@@ -45,3 +45,22 @@ TEST(DistributionGeneration, uniform) {
   ASSERT_TRUE(fabs(dist[0]-0.5) < 1e-9);
   ASSERT_TRUE(fabs(dist[1]-0.5) < 1e-9);
 }
+
+// A view reads the values in place: a row of a matrix, part of a vector.
+TEST(DistributionView, BorrowedValues) {
+  double row[6] = {0.5, 0.25, 0, 0.125, 0.125, 7};
+  base::DistributionView view(row, 5);
+  ASSERT_TRUE(view.isDistribution());
+  ASSERT_FALSE(base::DistributionView(row, 6).isDistribution());
+  ASSERT_DOUBLE_EQ(view.ShannonEntropy(), 1.75);
+  ASSERT_DOUBLE_EQ(view.GuessingEntropy(), 1*0.5 + 2*0.25 + 3*0.125 + 4*0.125);
+  ASSERT_DOUBLE_EQ(view.MinEntropy(), 1);
+  // The values are not reordered.
+  ASSERT_EQ(row[2], 0);
+
+  std::vector<double> vec = {0.1, 0.6, 0.3};
+  Distribution d(vec);
+  ASSERT_EQ(d.view().data(), d.pdist().data());
+  ASSERT_EQ(d.GuessingEntropy(), base::DistributionView(vec).GuessingEntropy());
+  ASSERT_DOUBLE_EQ(d.MinEntropy(), -log2(0.6));
+}
@@ -0,0 +1,69 @@
+#include <array>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "channel/channel.h"
+#include "channel/fixed_channel.h"
+#include "channel/vulnerability/bayes.h"
+#include "gtest/gtest.h"
+using std::vector;
+
+
+TEST(FixedChannelTest, MatchesChannel) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<double> dist(0, 1);
+  channel::vulnerability::Bayes bayes;
+  for(int t = 0; t < 20; t++) {
+    channel::FixedChannel<3, 4>::CMatrix c_matrix;
+    channel::FixedChannel<3, 4>::Prior prior;
+    double prior_sum = 0;
+    for(int i = 0; i < 3; i++) {
+      double sum = 0;
+      for(double& value : c_matrix[i]) sum += (value = dist(rng));
+      for(double& value : c_matrix[i]) value /= sum;
+      prior_sum += (prior[i] = dist(rng));
+    }
+    for(double& p : prior) p /= prior_sum;
+
+    channel::FixedChannel<3, 4> fixed(c_matrix, prior);
+    channel::Channel c = fixed.ToChannel();
+    ASSERT_NEAR(fixed.ShannonEntropyPrior(), c.ShannonEntropyPrior(), 1e-12);
+    ASSERT_NEAR(fixed.ShannonEntropyOut(), c.ShannonEntropyOut(), 1e-12);
+    ASSERT_NEAR(fixed.ConditionalEntropy(), c.ConditionalEntropy(), 1e-12);
+    ASSERT_NEAR(fixed.ConditionalEntropyHyper(), c.ConditionalEntropyHyper(), 1e-12);
+    ASSERT_NEAR(fixed.JointEntropy(), c.JointEntropy(), 1e-12);
+    ASSERT_NEAR(fixed.NormalizedMutualInformation(),
+                c.NormalizedMutualInformation(), 1e-12);
+    ASSERT_NEAR(fixed.LeakageMultPosterior(), bayes.LeakageMultPosterior(c), 1e-12);
+    ASSERT_NEAR(fixed.LeakageMultReversePosterior(),
+                bayes.LeakageMultReversePosterior(c), 1e-12);
+
+    std::array<std::array<double, 3>, 2> g;
+    vector<vector<double> > g_vector(2, vector<double>(3));
+    for(int w = 0; w < 2; w++)
+      for(int i = 0; i < 3; i++)
+        g_vector[w][i] = g[w][i] = dist(rng) - 0.3;
+    ASSERT_NEAR(fixed.PriorGVun(g), c.PriorGVun(g_vector), 1e-12);
+    ASSERT_NEAR(fixed.PostGVun(g), c.PostGVun(g_vector), 1e-12);
+  }
+}
+
+TEST(FixedChannelTest, ConvertsToAndFromChannel) {
+  channel::Channel c({{0.5, 0.5}, {0.25, 0.75}, {1, 0}}, {0.2, 0.3, 0.5});
+  channel::FixedChannel<3, 2> fixed(c);
+  ASSERT_EQ(fixed.c_matrix()[1][1], 0.75);
+  ASSERT_EQ(fixed.prior_distribution()[2], 0.5);
+  ASSERT_DOUBLE_EQ(fixed.out_distribution()[0], 0.675);
+
+  channel::Channel back = fixed.ToChannel();
+  ASSERT_EQ(back.n_in(), 3);
+  ASSERT_EQ(back.n_out(), 2);
+  for(int i = 0; i < 3; i++) {
+    ASSERT_EQ(back.prior_distribution()[i], c.prior_distribution()[i]);
+    for(int j = 0; j < 2; j++)
+      ASSERT_EQ(back.c_matrix()(i, j), c.c_matrix()(i, j));
+  }
+
+  ASSERT_THROW((channel::FixedChannel<2, 2>(c)), std::invalid_argument);
+}
@@ -0,0 +1,147 @@
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "base/matrix.h"
+#include "base/sparse_matrix.h"
+#include "channel/channel.h"
+#include "channel/vulnerability/bayes.h"
+#include "channel/vulnerability/gain_function.h"
+#include "gtest/gtest.h"
+using namespace std;
+using channel::Channel;
+using namespace channel::vulnerability;
+
+namespace {
+
+// A dense channel, and a sparse one: mostly the identity, with an output
+// that never happens.
+Channel DenseChannel() {
+  return Channel(base::Matrix({{0.5, 0.25, 0.25, 0}, {0, 1, 0, 0},
+                               {0.1, 0.2, 0.3, 0.4}, {0.3, 0.3, 0.2, 0.2},
+                               {0, 0, 0.5, 0.5}}),
+                 vector<double>({0.1, 0.3, 0.2, 0.25, 0.15}));
+}
+
+Channel SparseChannel() {
+  base::Matrix m(12, 13);
+  for(int i = 0; i < 12; i++) m(i, i) = 1;
+  m(3, 3) = 0.5;
+  m(3, 7) = 0.5;
+  vector<double> prior(12);
+  for(int i = 0; i < 12; i++) prior[i] = (i + 1) / 78.0;
+  return Channel(m, prior);
+}
+
+// The guesses are the pairs of secrets.
+vector<vector<double> > TwoTriesMatrix(int n) {
+  vector<vector<double> > g;
+  for(int a = 0; a < n; a++)
+    for(int b = a + 1; b < n; b++) {
+      g.push_back(vector<double>(n, 0));
+      g.back()[a] = g.back()[b] = 1;
+    }
+  return g;
+}
+
+vector<vector<double> > ThresholdMatrix(const vector<double>& positions,
+                                        double r) {
+  const int n = positions.size();
+  vector<vector<double> > g(n, vector<double>(n, 0));
+  for(int w = 0; w < n; w++)
+    for(int x = 0; x < n; x++)
+      if(fabs(positions[w] - positions[x]) <= r) g[w][x] = 1;
+  return g;
+}
+
+vector<vector<double> > SomeGain(int n) {
+  vector<vector<double> > g(3, vector<double>(n, 0));
+  for(int x = 0; x < n; x++) {
+    g[0][x] = (x % 3 == 0) ? 1 : 0;
+    g[1][x] = 0.5;
+    g[2][x] = (x == 1) ? 2 : -0.5;
+  }
+  return g;
+}
+
+// The structured gain must give what the same gain as a matrix gives.
+void ExpectSameVulnerabilities(const Channel& c, const GainFunction& g,
+                               const vector<vector<double> >& dense) {
+  ASSERT_NEAR(c.PriorGVun(g), c.PriorGVun(dense), 1e-12);
+  ASSERT_NEAR(c.PostGVun(g), c.PostGVun(dense), 1e-12);
+  vector<double> uniform(c.n_in(), 1.0 / c.n_in());
+  ASSERT_NEAR(c.PostGVun(uniform, g), c.PostGVun(uniform, dense), 1e-12);
+}
+
+}  // namespace
+
+TEST(GainFunctionTest, IdentityIsBayes) {
+  Bayes b;
+  for(const Channel& c : {DenseChannel(), SparseChannel()}) {
+    IdentityGain g(c.n_in());
+    ASSERT_DOUBLE_EQ(c.PriorGVun(g), b.VulnerabilityPrior(c));
+    ASSERT_DOUBLE_EQ(c.PostGVun(g), b.VulnerabilityPosterior(c));
+  }
+}
+
+TEST(GainFunctionTest, KTriesMatchesTheMatrix) {
+  for(const Channel& c : {DenseChannel(), SparseChannel()}) {
+    ExpectSameVulnerabilities(c, KTriesGain(c.n_in(), 2),
+                              TwoTriesMatrix(c.n_in()));
+    // Guessing every secret at once always wins.
+    ASSERT_NEAR(c.PostGVun(KTriesGain(c.n_in(), c.n_in())), 1, 1e-12);
+  }
+  ASSERT_THROW(KTriesGain(3, 0), std::invalid_argument);
+  ASSERT_THROW(KTriesGain(3, 4), std::invalid_argument);
+}
+
+TEST(GainFunctionTest, MetricMatchesTheMatrix) {
+  for(const Channel& c : {DenseChannel(), SparseChannel()}) {
+    vector<double> positions;
+    for(int x = 0; x < c.n_in(); x++) positions.push_back((x * 7) % 5 + 0.5*x);
+    vector<vector<double> > dense = ThresholdMatrix(positions, 1.5);
+    ExpectSameVulnerabilities(c, MetricGain(positions, 1.5), dense);
+    MetricGain::Distance d = [&positions](int w, int x) {
+      return fabs(positions[w] - positions[x]);
+    };
+    ExpectSameVulnerabilities(c, MetricGain(c.n_in(), d, 1.5), dense);
+  }
+}
+
+TEST(GainFunctionTest, DenseAndSparseMatchTheMatrix) {
+  for(const Channel& c : {DenseChannel(), SparseChannel()}) {
+    vector<vector<double> > g = SomeGain(c.n_in());
+    ExpectSameVulnerabilities(c, DenseGain(g), g);
+    ExpectSameVulnerabilities(
+        c, SparseGain(base::SparseMatrix::FromDense(base::Matrix(g))), g);
+  }
+}
+
+TEST(GainFunctionTest, BoundsMatchTheMatrix) {
+  Channel c1 = DenseChannel();
+  Channel c2(base::Matrix({{1, 0}, {0.5, 0.5}, {0, 1}, {0.2, 0.8}, {1, 0}}),
+             c1.prior_distribution());
+  vector<vector<double> > g = SomeGain(c1.n_in());
+  // A secret without gain.
+  for(auto& row : g) row[4] = 0;
+  DenseGain dense(g);
+  ASSERT_FALSE(dense.HasGain(4));
+  SparseGain sparse(base::SparseMatrix::FromDense(base::Matrix(g)));
+  ASSERT_FALSE(sparse.HasGain(4));
+
+  for(const GainFunction* f : {(const GainFunction*)&dense,
+                               (const GainFunction*)&sparse}) {
+    pair<double, double> p =
+        Channel::parallel_vulnerability(c1, c2, c1.prior_distribution(), g);
+    pair<double, double> q =
+        Channel::parallel_vulnerability(c1, c2, c1.prior_distribution(), *f);
+    ASSERT_NEAR(p.first, q.first, 1e-12);
+    ASSERT_NEAR(p.second, q.second, 1e-12);
+    p = Channel::hidden_choice_vulnerability(c1, c2, 0.3, g);
+    q = Channel::hidden_choice_vulnerability(c1, c2, 0.3, *f);
+    ASSERT_NEAR(p.first, q.first, 1e-12);
+    ASSERT_NEAR(p.second, q.second, 1e-12);
+    ASSERT_NEAR(Channel::visible_choice_vulnerability(c1, c2, 0.3, g),
+                Channel::visible_choice_vulnerability(c1, c2, 0.3, *f), 1e-12);
+  }
+}
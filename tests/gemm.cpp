@@ -0,0 +1,73 @@
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+#include "base/cpu.h"
+#include "base/gemm.h"
+#include "base/matrix.h"
+#include "gtest/gtest.h"
+using base::Matrix;
+
+
+// Random row-stochastic matrix, as the ones used by channels.
+Matrix RandomStochastic(int rows, int cols, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> dist(0, 1);
+  Matrix m(rows, cols);
+  for(int i = 0; i < rows; i++) {
+    double sum = 0;
+    for(int j = 0; j < cols; j++) sum += (m(i, j) = dist(rng));
+    for(int j = 0; j < cols; j++) m(i, j) /= sum;
+  }
+  return m;
+}
+
+Matrix NaiveMultiply(const Matrix& a, const Matrix& b) {
+  Matrix c(a.rows(), b.cols());
+  for(int i = 0; i < a.rows(); i++)
+    for(int j = 0; j < b.cols(); j++) {
+      double sum = 0;
+      for(int k = 0; k < a.cols(); k++) sum += a(i, k) * b(k, j);
+      c(i, j) = sum;
+    }
+  return c;
+}
+
+class GemmTest : public ::testing::TestWithParam<base::SimdLevel> {
+  protected:
+    void TearDown() override {
+      base::SetMaxSimdLevel(base::SimdLevel::kAvx512);
+    }
+};
+
+
+// Every path and thread count must stay within the tolerance documented
+// on base::Multiply; the scalar path must match the naive loop exactly.
+TEST_P(GemmTest, MatchesNaiveProduct) {
+  base::SetMaxSimdLevel(GetParam());
+  const int shapes[][3] = {{1, 1, 1}, {5, 2, 16}, {80, 16, 2}, {33, 300, 17},
+                           {130, 140, 270}, {7, 9, 40}};
+  for(const auto& shape : shapes) {
+    Matrix a = RandomStochastic(shape[0], shape[1], 1);
+    Matrix b = RandomStochastic(shape[1], shape[2], 2);
+    Matrix expected = NaiveMultiply(a, b);
+    for(int threads : {1, 3}) {
+      Matrix c = base::Multiply(a, b, threads);
+      ASSERT_EQ(c.rows(), shape[0]);
+      ASSERT_EQ(c.cols(), shape[2]);
+      for(int i = 0; i < c.rows(); i++)
+        for(int j = 0; j < c.cols(); j++) {
+          if(base::ActiveSimdLevel() == base::SimdLevel::kScalar)
+            ASSERT_EQ(c(i, j), expected(i, j));
+          else
+            ASSERT_NEAR(c(i, j), expected(i, j), shape[1] * 1.2e-16);
+        }
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(SimdLevels, GemmTest,
+                        ::testing::Values(base::SimdLevel::kScalar,
+                                          base::SimdLevel::kAvx2,
+                                          base::SimdLevel::kAvx512));
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <vector>
+
+#include "base/distribution.h"
+#include "base/matrix.h"
+#include "channel/channel.h"
+#include "channel/vulnerability/guessing.h"
+#include "gtest/gtest.h"
+using namespace std;
+using channel::Channel;
+using channel::vulnerability::Guessing;
+
+namespace {
+
+// The guessing entropy of every joint column y, as the sum of
+// p(y) * G(column), through base::Distribution.
+vector<double> ColumnTerms(const Channel& c) {
+  vector<double> terms;
+  for(int y = 0; y < c.n_out(); y++) {
+    vector<double> column(c.n_in());
+    for(int x = 0; x < c.n_in(); x++) column[x] = c.j_matrix()(x, y);
+    terms.push_back(c.out_distribution()[y] *
+                    base::Distribution(column, -1).GuessingEntropy());
+  }
+  return terms;
+}
+
+vector<double> RowTerms(const Channel& c) {
+  vector<double> terms;
+  for(int x = 0; x < c.n_in(); x++)
+    terms.push_back(c.prior_distribution()[x] *
+        base::Distribution(c.j_matrix()[x].to_vector(), -1).GuessingEntropy());
+  return terms;
+}
+
+void ExpectMatchesDistribution(const Channel& c) {
+  Guessing g;
+  vector<double> columns = ColumnTerms(c), rows = RowTerms(c);
+  double posterior = 0, reverse = 0;
+  for(double term : columns) posterior += term;
+  for(double term : rows) reverse += term;
+  // The same sums, in the same order.
+  ASSERT_EQ(g.VulnerabilityPosterior(c), posterior);
+  ASSERT_EQ(g.VulnerabilityReversePosterior(c), reverse);
+  ASSERT_EQ(g.VulnerabilityMaxPosterior(c),
+            *max_element(columns.begin(), columns.end()));
+  ASSERT_EQ(g.VulnerabilityMaxReversePosterior(c),
+            *max_element(rows.begin(), rows.end()));
+  ASSERT_EQ(g.VulnerabilityPrior(c),
+            base::Distribution(c.prior_distribution(), -1).GuessingEntropy());
+  ASSERT_DOUBLE_EQ(g.LeakageMaxPosterior(c),
+                   g.VulnerabilityMaxPosterior(c) / g.VulnerabilityPrior(c));
+  ASSERT_DOUBLE_EQ(g.LeakageMaxReversePosterior(c),
+                   g.VulnerabilityMaxReversePosterior(c) / g.VulnerabilityOut(c));
+}
+
+}  // namespace
+
+TEST(GuessingTest, GuessingEntropyKernel) {
+  vector<double> v = {0, 0.25, 0, 0.5, 0.125, 0.125};
+  ASSERT_DOUBLE_EQ(base::GuessingEntropy(v.data(), v.size()),
+                   1*0.5 + 2*0.25 + 3*0.125 + 4*0.125);
+  ASSERT_EQ(base::GuessingEntropy(v.data(), 0), 0);
+}
+
+TEST(GuessingTest, DenseMatchesDistribution) {
+  Channel c(base::Matrix({{0.5, 0.25, 0.25, 0}, {0, 1, 0, 0},
+                          {0.1, 0.2, 0.3, 0.4}}),
+            vector<double>({0.2, 0.3, 0.5}));
+  ASSERT_FALSE(c.is_sparse());
+  ExpectMatchesDistribution(c);
+}
+
+TEST(GuessingTest, SparseMatchesDistribution) {
+  base::Matrix m(12, 13);
+  for(int i = 0; i < 12; i++) m(i, (i * 5) % 13) = 1;
+  m(3, 3) = 0.5;
+  m(3, 2) = 0.5;
+  vector<double> prior(12);
+  for(int i = 0; i < 12; i++) prior[i] = (i + 1) / 78.0;
+  Channel c(m, prior);
+  ASSERT_TRUE(c.is_sparse());
+  ExpectMatchesDistribution(c);
+}
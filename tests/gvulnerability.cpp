@@ -0,0 +1,105 @@
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+#include "base/matrix.h"
+#include "channel/vulnerability/gvulnerability.h"
+#include "gtest/gtest.h"
+using base::Matrix;
+using std::vector;
+
+
+Matrix RandomMatrix(int rows, int cols, unsigned seed, bool stochastic) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> dist(0, 1);
+  Matrix m(rows, cols);
+  for(int i = 0; i < rows; i++) {
+    double sum = 0;
+    for(int j = 0; j < cols; j++) sum += (m(i, j) = dist(rng));
+    if(stochastic)
+      for(int j = 0; j < cols; j++) m(i, j) /= sum;
+  }
+  return m;
+}
+
+// The straightforward y -> w -> x loop.
+double NaivePost(const Matrix& c, const Matrix& g, base::Span<const double> pi) {
+  double sum = 0;
+  for(int y = 0; y < c.cols(); y++) {
+    double max_w = 0;
+    for(int w = 0; w < g.rows(); w++) {
+      double s = 0;
+      for(int x = 0; x < c.rows(); x++) s += pi[x] * c(x, y) * g(w, x);
+      max_w = std::max(max_w, s);
+    }
+    sum += max_w;
+  }
+  return sum;
+}
+
+double NaivePrior(const Matrix& g, base::Span<const double> pi) {
+  double max_w = 0;
+  for(int w = 0; w < g.rows(); w++) {
+    double s = 0;
+    for(int x = 0; x < g.cols(); x++) s += pi[x] * g(w, x);
+    max_w = std::max(max_w, s);
+  }
+  return max_w;
+}
+
+TEST(GVulnerabilityTest, BatchMatchesSingleEvaluations) {
+  const int n_in = 7, n_out = 5, n_priors = 40;
+  Matrix c = RandomMatrix(n_in, n_out, 1, true);
+  Matrix priors = RandomMatrix(n_priors, n_in, 2, true);
+  vector<Matrix> gains = {RandomMatrix(3, n_in, 3, false),
+                          RandomMatrix(1, n_in, 4, false),
+                          RandomMatrix(9, n_in, 5, false)};
+
+  Matrix post = channel::vulnerability::PostGVulnerability(c, gains, priors, 2);
+  Matrix prior = channel::vulnerability::PriorGVulnerability(gains, priors);
+  ASSERT_EQ(post.rows(), 3);
+  ASSERT_EQ(post.cols(), n_priors);
+  for(int k = 0; k < 3; k++)
+    for(int p = 0; p < n_priors; p++) {
+      ASSERT_NEAR(post(k, p), NaivePost(c, gains[k], priors[p]), 1e-12);
+      ASSERT_NEAR(prior(k, p), NaivePrior(gains[k], priors[p]), 1e-12);
+    }
+}
+
+TEST(GVulnerabilityTest, IdentityGainIsBayes) {
+  Matrix c = RandomMatrix(6, 4, 7, true);
+  vector<vector<double> > id(6, vector<double>(6, 0));
+  for(int i = 0; i < 6; i++) id[i][i] = 1;
+  vector<double> pi(6, 1.0/6);
+
+  double bayes = 0;
+  for(int y = 0; y < 4; y++)
+    bayes += *std::max_element(c.column(y).begin(), c.column(y).end()) / 6;
+  ASSERT_NEAR(channel::vulnerability::PostGVulnerability(c, id, pi), bayes, 1e-12);
+  ASSERT_NEAR(channel::vulnerability::PriorGVulnerability(id, pi), 1.0/6, 1e-12);
+}
+
+// With many guesses, the columns are taken in several chunks, and a
+// chunk may end within the outputs of a prior.
+TEST(GVulnerabilityTest, ChunksSplitThePriors) {
+  const int n_in = 64, n_out = 37, n_priors = 9;
+  Matrix c = RandomMatrix(n_in, n_out, 8, true);
+  Matrix priors = RandomMatrix(n_priors, n_in, 9, true);
+  vector<Matrix> gains = {RandomMatrix(8192, n_in, 10, false)};
+
+  Matrix post = channel::vulnerability::PostGVulnerability(c, gains, priors);
+  for(int p = 0; p < n_priors; p++)
+    ASSERT_NEAR(post(0, p), NaivePost(c, gains[0], priors[p]), 1e-9);
+}
+
+TEST(GVulnerabilityTest, MismatchedGainThrows) {
+  Matrix c = RandomMatrix(6, 4, 11, true);
+  Matrix priors = RandomMatrix(1, 6, 12, true);
+  vector<Matrix> gains = {RandomMatrix(3, 6, 13, false),
+                          RandomMatrix(3, 5, 14, false)};
+  ASSERT_THROW(channel::vulnerability::PostGVulnerability(c, gains, priors),
+               std::invalid_argument);
+  ASSERT_THROW(channel::vulnerability::PriorGVulnerability(gains, priors),
+               std::invalid_argument);
+}
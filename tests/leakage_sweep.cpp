@@ -0,0 +1,57 @@
+#include <vector>
+#include <random>
+
+#include "channel/channel.h"
+#include "channel/vulnerability/bayes.h"
+#include "channel/vulnerability/leakage_sweep.h"
+#include "gtest/gtest.h"
+using std::vector;
+
+
+// [n] random distributions over [n_in] elements, one per row.
+base::Matrix RandomPriors(int n, int n_in, unsigned seed=11) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> dist(0, 1);
+  base::Matrix priors(n, n_in);
+  for(int p = 0; p < n; p++) {
+    double sum = 0;
+    for(int x = 0; x < n_in; x++) sum += (priors(p, x) = dist(rng));
+    for(int x = 0; x < n_in; x++) priors(p, x) /= sum;
+  }
+  return priors;
+}
+
+TEST(LeakageSweepTest, BayesMatchesRebuiltChannels) {
+  channel::Channel c(RandomPriors(6, 5, 1));
+  base::Matrix priors = RandomPriors(300, 6);
+  base::ThreadPool pool(4);
+  vector<channel::vulnerability::SweepPoint> points =
+      channel::vulnerability::LeakageSweep(c).Bayes(priors, &pool);
+
+  channel::vulnerability::Bayes bayes;
+  ASSERT_EQ(points.size(), 300u);
+  for(int p = 0; p < 300; p++) {
+    channel::Channel cp(c.c_matrix(), priors[p].to_vector());
+    ASSERT_DOUBLE_EQ(points[p].prior, bayes.VulnerabilityPrior(cp));
+    ASSERT_DOUBLE_EQ(points[p].posterior, bayes.VulnerabilityPosterior(cp));
+    ASSERT_NEAR(points[p].LeakageMult(), bayes.LeakageMultPosterior(cp), 1e-12);
+  }
+}
+
+TEST(LeakageSweepTest, GainMatchesChannelGVun) {
+  channel::Channel c(RandomPriors(4, 3, 2));
+  vector<vector<double> > g = {{1, 0.5, 0, 0}, {0, 0.5, 1, 0}, {0, 0, 0.5, 1}};
+  base::Matrix priors = RandomPriors(150, 4);
+  base::ThreadPool pool(2);
+  vector<channel::vulnerability::SweepPoint> points =
+      channel::vulnerability::LeakageSweep(c).Gain(priors, g, &pool);
+  vector<channel::vulnerability::SweepPoint> serial =
+      channel::vulnerability::LeakageSweep(c).Gain(priors, g);
+
+  for(int p = 0; p < 150; p++) {
+    channel::Channel cp(c.c_matrix(), priors[p].to_vector());
+    ASSERT_NEAR(points[p].prior, cp.PriorGVun(g), 1e-12);
+    ASSERT_NEAR(points[p].posterior, cp.PostGVun(g), 1e-12);
+    ASSERT_EQ(points[p].posterior, serial[p].posterior);
+  }
+}
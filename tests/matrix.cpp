@@ -0,0 +1,53 @@
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#include "base/matrix.h"
+#include "gtest/gtest.h"
+using base::Matrix;
+
+
+// The matrix must keep the layout of the vector of rows it was built from.
+TEST(MatrixTest, FromVectors) {
+  std::vector<std::vector<double> > rows = {{1, 2, 3}, {4, 5, 6}};
+  Matrix m(rows);
+  ASSERT_EQ(m.rows(), 2);
+  ASSERT_EQ(m.cols(), 3);
+  for(int i = 0; i < 2; i++)
+    for(int j = 0; j < 3; j++) {
+      ASSERT_EQ(m[i][j], rows[i][j]);
+      ASSERT_EQ(m(i, j), rows[i][j]);
+      ASSERT_EQ(m.data()[i*3 + j], rows[i][j]);
+    }
+  ASSERT_TRUE(m.to_vectors() == rows);
+}
+
+
+TEST(MatrixTest, RowAndColumnViews) {
+  Matrix m(3, 4);
+  m[1][2] = 7;
+  m.column(3)[2] = 9;
+  ASSERT_EQ(m(1, 2), 7);
+  ASSERT_EQ(m(2, 3), 9);
+
+  double sum = 0;
+  for(double value : m.column(3)) sum += value;
+  ASSERT_EQ(sum, 9);
+  ASSERT_EQ(m.row(2).to_vector(), std::vector<double>({0, 0, 0, 9}));
+}
+
+
+TEST(MatrixTest, Transposed) {
+  Matrix m(37, 70);
+  for(int i = 0; i < m.rows(); i++)
+    for(int j = 0; j < m.cols(); j++)
+      m(i, j) = i*100 + j;
+
+  Matrix t = m.Transposed();
+  ASSERT_EQ(t.rows(), 70);
+  ASSERT_EQ(t.cols(), 37);
+  for(int i = 0; i < m.rows(); i++)
+    for(int j = 0; j < m.cols(); j++)
+      ASSERT_EQ(t(j, i), m(i, j));
+  ASSERT_TRUE(t.Transposed() == m);
+}
@@ -0,0 +1,68 @@
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "channel/channel.h"
+#include "channel/parallel_channel.h"
+#include "channel/vulnerability/bayes.h"
+#include "gtest/gtest.h"
+using namespace std;
+using channel::Channel;
+using channel::ParallelChannel;
+
+
+class ParallelChannelTest : public ::testing::Test {
+  public:
+    vector<double> prior = {0.1, 0.2, 0.3, 0.4};
+    Channel c1, c2, c3;
+
+    ParallelChannelTest()
+      : c1(vector<vector<double> >({{0.5, 0.5}, {0.1, 0.9}, {1, 0}, {0.3, 0.7}})),
+        c2(vector<vector<double> >({{0.2, 0.3, 0.5}, {0, 0, 1},
+                                    {0.6, 0.2, 0.2}, {0.3, 0.3, 0.4}})),
+        c3(vector<vector<double> >({{1, 0}, {0, 1}, {0.25, 0.75}, {1, 0}})) {}
+};
+
+
+// The implicit composition must agree with the materialized one.
+TEST_F(ParallelChannelTest, MatchesMaterializedComposition) {
+  ParallelChannel p = ParallelChannel(c1) || c2 || c3;
+  p.set_prior_distribution(prior);
+  ASSERT_EQ(p.n_out(), 12);
+
+  Channel m = c1 || c2 || c3;
+  Channel c(m.c_matrix(), prior);
+  channel::vulnerability::Bayes b;
+
+  const double eps = 1e-12;
+  ASSERT_NEAR(p.BayesVulnerabilityPrior(), b.VulnerabilityPrior(c), eps);
+  ASSERT_NEAR(p.BayesVulnerabilityPosterior(), b.VulnerabilityPosterior(c), eps);
+  ASSERT_NEAR(p.ShannonEntropyPrior(), c.ShannonEntropyPrior(), 1e-6);
+  ASSERT_NEAR(p.ShannonEntropyOut(), c.ShannonEntropyOut(), 1e-6);
+  ASSERT_NEAR(p.ConditionalEntropy(), c.ConditionalEntropy(), 1e-6);
+  ASSERT_NEAR(p.ConditionalEntropyHyper(), c.ConditionalEntropyHyper(), 1e-6);
+  ASSERT_NEAR(p.JointEntropy(), c.JointEntropy(), 1e-6);
+  ASSERT_NEAR(p.MutualInformation(), c.MutualInformation(), 1e-6);
+  ASSERT_NEAR(p.NormalizedMutualInformation(),
+              c.NormalizedMutualInformation(), 1e-6);
+
+  vector<vector<double> > g = {{1, 0, 0, 0.5}, {0, 1, 0.5, 0}, {0.2, 0.2, 0.2, 0.2}};
+  ASSERT_NEAR(p.PriorGVun(g), c.PriorGVun(g), eps);
+  ASSERT_NEAR(p.PostGVun(g), c.PostGVun(g), eps);
+
+  Channel back = p.ToChannel();
+  for(int x = 0; x < 4; x++)
+    for(int y = 0; y < 12; y++)
+      ASSERT_NEAR(back.c_matrix()[x][y], m.c_matrix()[x][y], eps);
+}
+
+// Compositions too wide for a matrix, or for a long long, must fail.
+TEST_F(ParallelChannelTest, RejectsTooManyOutputs) {
+  Channel wide(vector<vector<double> >(4, vector<double>(2000, 1.0/2000)));
+  ParallelChannel p = ParallelChannel(wide) || wide || wide;
+  ASSERT_EQ(p.n_out(), 8000000000LL);
+  ASSERT_THROW(p.ToChannel(), std::length_error);
+  p.Add(wide).Add(wide);
+  ASSERT_THROW(p.Add(wide), std::invalid_argument);
+}
@@ -0,0 +1,100 @@
+#include <cmath>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "base/random.h"
+#include "gtest/gtest.h"
+
+
+TEST(RandomTest, SameSeedSameSequence) {
+  base::Rng a(42), b(42), c(43);
+  bool differs = false;
+  for(int i = 0; i < 100; i++) {
+    uint64_t value = a();
+    ASSERT_EQ(value, b());
+    differs |= (value != c());
+  }
+  ASSERT_TRUE(differs);
+}
+
+TEST(RandomTest, StreamsAreJumpsAndDoNotOverlap) {
+  base::Rng jumped(5);
+  jumped.Jump();
+  jumped.Jump();
+  base::Rng stream = base::Rng::Stream(5, 2);
+  for(int i = 0; i < 10; i++) ASSERT_EQ(jumped(), stream());
+
+  std::set<uint64_t> seen;
+  for(int k = 0; k < 4; k++) {
+    base::Rng rng = base::Rng::Stream(5, k);
+    for(int i = 0; i < 1000; i++) seen.insert(rng());
+  }
+  ASSERT_EQ(seen.size(), 4000u);
+}
+
+TEST(RandomTest, UniformValuesAreInRange) {
+  base::Rng rng(1);
+  std::vector<int> hits(6, 0);
+  for(int i = 0; i < 60000; i++) {
+    long long value = rng.UniformInt(-2, 3);
+    ASSERT_GE(value, -2);
+    ASSERT_LE(value, 3);
+    hits[value + 2]++;
+  }
+  for(int count : hits) ASSERT_NEAR(count, 10000, 500);
+
+  double sum = 0;
+  for(int i = 0; i < 100000; i++) {
+    double u = rng.Uniform();
+    ASSERT_GE(u, 0);
+    ASSERT_LT(u, 1);
+    sum += u;
+  }
+  ASSERT_NEAR(sum / 100000, 0.5, 0.01);
+}
+
+// A symmetric Dirichlet(alpha) over n elements has mean 1/n and variance
+// (1/n)(1 - 1/n) / (n alpha + 1) in each element.
+TEST(RandomTest, StochasticMatricesFollowTheDirichlet) {
+  base::Rng rng(9);
+  const int rows = 20000, cols = 4;
+  for(double alpha : {0.3, 1.0, 4.0}) {
+    base::Matrix m = base::RandomStochasticMatrix(rng, rows, cols, alpha);
+    double sum = 0, squares = 0;
+    for(int i = 0; i < rows; i++) {
+      double row_sum = 0;
+      for(int j = 0; j < cols; j++) {
+        ASSERT_GE(m(i, j), 0);
+        row_sum += m(i, j);
+      }
+      ASSERT_NEAR(row_sum, 1, 1e-12);
+      sum += m(i, 0);
+      squares += m(i, 0) * m(i, 0);
+    }
+    double mean = sum / rows, variance = squares / rows - mean * mean;
+    ASSERT_NEAR(mean, 0.25, 0.01);
+    ASSERT_NEAR(variance, 0.25 * 0.75 / (cols * alpha + 1), 0.005);
+  }
+
+  std::vector<double> distribution(5);
+  base::RandomDistribution(rng, distribution.data(), 5);
+  double total = 0;
+  for(double p : distribution) total += p;
+  ASSERT_NEAR(total, 1, 1e-12);
+}
+
+TEST(RandomTest, ThreadRngsAreSeededStreams) {
+  base::SeedThreadRngs(7);
+  uint64_t first = base::ThreadRng()();
+  ASSERT_EQ(first, base::Rng::Stream(7, 0)());
+
+  // Another thread gets the next stream.
+  uint64_t other = 0;
+  std::thread thread([&other] { other = base::ThreadRng()(); });
+  thread.join();
+  ASSERT_EQ(other, base::Rng::Stream(7, 1)());
+
+  base::SeedThreadRngs(7);
+  ASSERT_EQ(base::ThreadRng()(), first);
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <vector>
+
+#include "base/thread_pool.h"
+#include "channel/search.h"
+#include "gtest/gtest.h"
+
+using channel::search::CountEnumerator;
+
+namespace {
+
+std::vector<std::vector<int> > Visit(const CountEnumerator& enumerator,
+                                     base::ThreadPool* pool) {
+  std::mutex mutex;
+  std::vector<std::vector<int> > visited;
+  const int size = enumerator.n_in() * enumerator.n_out();
+  enumerator.ForEach(pool, [&](const int* counts, int worker) {
+    EXPECT_GE(worker, 0);
+    EXPECT_LT(worker, CountEnumerator::Workers(pool));
+    std::lock_guard<std::mutex> lock(mutex);
+    visited.emplace_back(counts, counts + size);
+  });
+  return visited;
+}
+
+// The smallest matrix over every row and column permutation.
+std::vector<int> Canonical(const std::vector<int>& counts, int n, int m) {
+  std::vector<int> rows(n), columns(m);
+  std::iota(rows.begin(), rows.end(), 0);
+  std::vector<int> best = counts;
+  do {
+    std::iota(columns.begin(), columns.end(), 0);
+    do {
+      std::vector<int> image(n*m);
+      for(int x = 0; x < n; x++)
+        for(int y = 0; y < m; y++)
+          image[x*m + y] = counts[rows[x]*m + columns[y]];
+      best = std::min(best, image);
+    } while(std::next_permutation(columns.begin(), columns.end()));
+  } while(std::next_permutation(rows.begin(), rows.end()));
+  return best;
+}
+
+}  // namespace
+
+TEST(SearchTest, NextRowFollowsTheLexicographicOrder) {
+  std::vector<int> row = {0, 0, 2};
+  std::vector<std::vector<int> > rows = {row};
+  while(channel::search::NextRow(row.data(), row.size()))
+    rows.push_back(row);
+  std::vector<std::vector<int> > expected = {
+    {0, 0, 2}, {0, 1, 1}, {0, 2, 0}, {1, 0, 1}, {1, 1, 0}, {2, 0, 0}};
+  ASSERT_EQ(rows, expected);
+}
+
+TEST(SearchTest, VisitsEveryMatrixWithoutSymmetry) {
+  CountEnumerator enumerator(3, 3, 4, false);
+  std::vector<std::vector<int> > visited = Visit(enumerator, nullptr);
+  // 15 rows of 3 counts summing to 4, in every one of the 3 rows.
+  ASSERT_EQ(visited.size(), 15u * 15 * 15);
+  ASSERT_EQ(std::set<std::vector<int> >(visited.begin(), visited.end()).size(),
+            visited.size());
+  for(const std::vector<int>& counts : visited)
+    for(int x = 0; x < 3; x++)
+      ASSERT_EQ(counts[3*x] + counts[3*x + 1] + counts[3*x + 2], 4);
+}
+
+TEST(SearchTest, VisitsOneMatrixPerClass) {
+  const int sizes[][3] = {{2, 2, 5}, {2, 3, 4}, {3, 3, 4}, {3, 2, 6}};
+  for(const auto& size : sizes) {
+    const int n = size[0], m = size[1], norm = size[2];
+    std::set<std::vector<int> > classes;
+    for(const std::vector<int>& counts :
+        Visit(CountEnumerator(n, m, norm, false), nullptr))
+      classes.insert(Canonical(counts, n, m));
+
+    std::vector<std::vector<int> > visited =
+      Visit(CountEnumerator(n, m, norm), nullptr);
+    ASSERT_EQ(visited.size(), classes.size());
+    for(const std::vector<int>& counts : visited)
+      ASSERT_TRUE(classes.count(counts));
+  }
+}
+
+TEST(SearchTest, PoolVisitsTheSameMatrices) {
+  CountEnumerator enumerator(3, 3, 7);
+  std::vector<std::vector<int> > serial = Visit(enumerator, nullptr);
+  base::ThreadPool pool(4);
+  std::vector<std::vector<int> > parallel = Visit(enumerator, &pool);
+  std::sort(parallel.begin(), parallel.end());
+  ASSERT_TRUE(std::is_sorted(serial.begin(), serial.end()));
+  ASSERT_EQ(serial, parallel);
+}
@@ -0,0 +1,49 @@
+#include <vector>
+
+#include "base/simplex.h"
+#include "gtest/gtest.h"
+using base::LinearProgram;
+using base::LpResult;
+using base::LpStatus;
+
+
+TEST(SimplexTest, LessEqualConstraints) {
+  // max 3x + 5y  s.t.  x <= 4,  2y <= 12,  3x + 2y <= 18
+  LinearProgram lp(2);
+  lp.SetObjective({3, 5});
+  lp.AddLessEqual({1, 0}, 4);
+  lp.AddLessEqual({0, 2}, 12);
+  lp.AddLessEqual({3, 2}, 18);
+  LpResult r = lp.Maximize();
+  ASSERT_EQ(r.status, LpStatus::kOptimal);
+  ASSERT_NEAR(r.objective, 36, 1e-9);
+  ASSERT_NEAR(r.x[0], 2, 1e-9);
+  ASSERT_NEAR(r.x[1], 6, 1e-9);
+}
+
+TEST(SimplexTest, EqualAndGreaterEqualConstraints) {
+  // max -x - 2y  s.t.  x + y = 3,  x >= 1,  y - x >= -2
+  LinearProgram lp(2);
+  lp.SetObjective({-1, -2});
+  lp.AddEqual({1, 1}, 3);
+  lp.AddGreaterEqual({1, 0}, 1);
+  lp.AddGreaterEqual({-1, 1}, -2);
+  LpResult r = lp.Maximize();
+  ASSERT_EQ(r.status, LpStatus::kOptimal);
+  ASSERT_NEAR(r.x[0], 2.5, 1e-9);
+  ASSERT_NEAR(r.x[1], 0.5, 1e-9);
+  ASSERT_NEAR(r.objective, -3.5, 1e-9);
+}
+
+TEST(SimplexTest, InfeasibleAndUnbounded) {
+  LinearProgram infeasible(1);
+  infeasible.SetObjective({1});
+  infeasible.AddLessEqual({1}, 1);
+  infeasible.AddGreaterEqual({1}, 2);
+  ASSERT_EQ(infeasible.Maximize().status, LpStatus::kInfeasible);
+
+  LinearProgram unbounded(2);
+  unbounded.SetObjective({1, 1});
+  unbounded.AddLessEqual({1, -1}, 1);
+  ASSERT_EQ(unbounded.Maximize().status, LpStatus::kUnbounded);
+}
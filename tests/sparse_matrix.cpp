@@ -0,0 +1,81 @@
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#include "base/gemm.h"
+#include "base/matrix.h"
+#include "base/sparse_matrix.h"
+#include "gtest/gtest.h"
+using base::Matrix;
+using base::SparseMatrix;
+
+
+// A rows x cols matrix with about [density] of its entries nonzero.
+Matrix RandomSparse(int rows, int cols, double density) {
+  Matrix m(rows, cols);
+  for(int i = 0; i < rows; i++)
+    for(int j = 0; j < cols; j++)
+      if(rand() % 1000 < density * 1000) m(i, j) = (rand() % 1000 + 1) / 1000.0;
+  return m;
+}
+
+
+TEST(SparseMatrixTest, DenseRoundTrip) {
+  Matrix m({{0, 2, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 3}});
+  SparseMatrix s = SparseMatrix::FromDense(m);
+  ASSERT_EQ(s.rows(), 3);
+  ASSERT_EQ(s.cols(), 4);
+  ASSERT_EQ(s.nonzeros(), 3u);
+  ASSERT_EQ(SparseMatrix::CountNonzeros(m), 3u);
+  ASSERT_DOUBLE_EQ(s.density(), 0.25);
+  ASSERT_EQ(s.row(1).size, 0);
+  ASSERT_EQ(s.row(2).size, 2);
+  ASSERT_EQ(s.row(2).col[1], 3);
+  ASSERT_EQ(s.row(2).value[1], 3);
+  ASSERT_TRUE(s.ToDense() == m);
+}
+
+
+// Rows may be added in any order; repeated columns are summed in the
+// order they were added, and zeros dropped.
+TEST(SparseMatrixTest, EndRowSortsAndMerges) {
+  SparseMatrix s(5);
+  s.Add(4, 1);
+  s.Add(1, 0.5);
+  s.Add(4, 2);
+  s.Add(3, 0);
+  s.EndRow();
+  s.Add(2, 1);
+  s.Add(2, -1);
+  s.EndRow();
+  ASSERT_EQ(s.rows(), 2);
+  ASSERT_EQ(s.row(0).size, 2);
+  ASSERT_EQ(s.row(0).col[0], 1);
+  ASSERT_EQ(s.row(0).value[0], 0.5);
+  ASSERT_EQ(s.row(0).col[1], 4);
+  ASSERT_EQ(s.row(0).value[1], 3);
+  ASSERT_EQ(s.row(1).size, 0);
+}
+
+
+TEST(SparseMatrixTest, Transposed) {
+  Matrix m = RandomSparse(37, 23, 0.2);
+  ASSERT_TRUE(SparseMatrix::FromDense(m).Transposed().ToDense() ==
+              m.Transposed());
+}
+
+
+// Without the zero terms, every entry is the sum of the textbook triple
+// loop, in the same order.
+TEST(SparseMatrixTest, MultiplyMatchesTheTripleLoop) {
+  Matrix a = RandomSparse(40, 30, 0.1), b = RandomSparse(30, 50, 0.15);
+  Matrix c = base::Multiply(SparseMatrix::FromDense(a),
+                            SparseMatrix::FromDense(b)).ToDense();
+  for(int i = 0; i < 40; i++)
+    for(int j = 0; j < 50; j++) {
+      double sum = 0;
+      for(int k = 0; k < 30; k++)
+        if(a(i, k) != 0 && b(k, j) != 0) sum += a(i, k) * b(k, j);
+      ASSERT_EQ(c(i, j), sum);
+    }
+}
@@ -0,0 +1,48 @@
+#include <vector>
+#include <atomic>
+#include <functional>
+
+#include "base/thread_pool.h"
+#include "gtest/gtest.h"
+
+
+TEST(ThreadPoolTest, ParallelForCoversTheRangeOnce) {
+  base::ThreadPool pool(4);
+  std::vector<int> hits(1000, 0);
+  pool.ParallelFor(3, 1000, [&hits](int b, int e) {
+    for(int i = b; i < e; i++) hits[i]++;
+  }, 7);
+  for(int i = 0; i < 1000; i++)
+    ASSERT_EQ(hits[i], i < 3 ? 0 : 1);
+}
+
+TEST(ThreadPoolTest, WaitsForSubmittedTasks) {
+  std::atomic<int> done(0);
+  base::ThreadPool pool(3);
+  for(int t = 0; t < 50; t++)
+    pool.Submit([&done] { done++; });
+  pool.Wait();
+  ASSERT_EQ(done.load(), 50);
+  ASSERT_EQ(pool.size(), 3);
+}
+
+TEST(ThreadPoolTest, TasksCanSubmitTasks) {
+  base::ThreadPool pool(4);
+  std::atomic<int> leaves(0);
+  std::vector<std::atomic<int> > per_worker(4);
+  std::function<void(int)> tree = [&](int depth) {
+    int worker = pool.CurrentWorker();
+    ASSERT_GE(worker, 0);
+    per_worker[worker]++;
+    if(depth == 0) {
+      leaves++;
+      return;
+    }
+    pool.Submit([&tree, depth] { tree(depth - 1); });
+    pool.Submit([&tree, depth] { tree(depth - 1); });
+  };
+  pool.Submit([&tree] { tree(10); });
+  pool.Wait();
+  ASSERT_EQ(leaves.load(), 1 << 10);
+  ASSERT_EQ(pool.CurrentWorker(), -1);
+}
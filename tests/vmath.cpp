@@ -0,0 +1,109 @@
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "base/cpu.h"
+#include "base/vmath.h"
+#include "gtest/gtest.h"
+using std::vector;
+
+
+class VmathTest : public ::testing::TestWithParam<base::SimdLevel> {
+  protected:
+    void SetUp() override { base::SetMaxSimdLevel(GetParam()); }
+    void TearDown() override {
+      base::SetMaxSimdLevel(base::SimdLevel::kAvx512);
+    }
+};
+
+TEST_P(VmathTest, MatchesStd) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> exponent(-300, 300), arg(-700, 700);
+  vector<double> x(1003), y(1003);
+  for(double& v : x) v = std::pow(10.0, exponent(rng));
+  base::Log(x.data(), y.data(), x.size());
+  for(int i = 0; i < (int)x.size(); i++)
+    ASSERT_NEAR(y[i], std::log(x[i]), 4e-16 * std::fabs(std::log(x[i])));
+
+  for(double& v : x) v = arg(rng);
+  base::Exp(x.data(), y.data(), x.size());
+  for(int i = 0; i < (int)x.size(); i++)
+    ASSERT_NEAR(y[i], std::exp(x[i]), 4e-16 * std::exp(x[i]));
+}
+
+TEST_P(VmathTest, SpecialValues) {
+  const double inf = std::numeric_limits<double>::infinity();
+  vector<double> x = {0, -1, inf, 1e-310, 1, 2, 4, 8};
+  vector<double> y(x.size());
+  base::Log(x.data(), y.data(), x.size());
+  ASSERT_EQ(y[0], -inf);
+  ASSERT_TRUE(std::isnan(y[1]));
+  ASSERT_EQ(y[2], inf);
+  ASSERT_EQ(y[3], std::log(1e-310));
+  ASSERT_EQ(y[4], 0);
+
+  x = {-800, 800, 0, 1, -inf, 2, 3, 4};
+  base::Exp(x.data(), x.data(), x.size());
+  ASSERT_EQ(x[0], 0);
+  ASSERT_EQ(x[1], inf);
+  ASSERT_EQ(x[2], 1);
+  ASSERT_EQ(x[4], 0);
+}
+
+// sum x log2(1 / x) in order, skipping the zeros.
+double NaiveEntropy(const vector<double>& p, double scale) {
+  double entropy = 0;
+  for(double v : p)
+    if(v * scale != 0) entropy -= v * scale * std::log2(v * scale);
+  return entropy;
+}
+
+// Sizes that leave every tail length, with zeros and tiny values mixed in.
+TEST_P(VmathTest, EntropyMatchesTheSum) {
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<double> value(0, 1), exponent(-300, 0);
+  for(int n = 0; n < 40; n++) {
+    vector<double> p(n);
+    for(int i = 0; i < n; i++) {
+      double u = value(rng);
+      p[i] = (u < 0.3) ? 0 : (u < 0.4) ? std::pow(10.0, exponent(rng)) : u;
+    }
+    double total = 0;
+    for(double v : p) total += v;
+    for(double scale : {1.0, 0.125, 1e-3}) {
+      double naive = NaiveEntropy(p, scale);
+      ASSERT_NEAR(base::Entropy(p.data(), n, scale, base::LogMode::kExact),
+                  naive, 1e-14 * (1 + naive));
+      ASSERT_NEAR(base::Entropy(p.data(), n, scale, base::LogMode::kFast),
+                  naive, 5e-8 * total * scale + 1e-14 * (1 + naive));
+    }
+  }
+}
+
+// Subnormal values take the scalar path. Their term is tiny, not the
+// infinity of x * log2(1 / x), whose 1 / x overflows.
+TEST_P(VmathTest, EntropySpecialValues) {
+  vector<double> p = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+  ASSERT_EQ(base::Entropy(p.data(), p.size()), 0);
+  p = {0.5, 1e-310, 0, 0.25, 0.25, 0, 0, 0, 0};
+  ASSERT_NEAR(base::Entropy(p.data(), p.size()), 1.5, 1e-15);
+  ASSERT_NEAR(base::Entropy(p.data(), p.size(), 1, base::LogMode::kFast),
+              1.5, 5e-8);
+}
+
+TEST(VmathLogModeTest, SetLogMode) {
+  ASSERT_EQ(base::ActiveLogMode(), base::LogMode::kExact);
+  vector<double> p = {0.1, 0.2, 0.3, 0.4};
+  const double exact = base::Entropy(p.data(), p.size());
+  base::SetLogMode(base::LogMode::kFast);
+  ASSERT_EQ(base::Entropy(p.data(), p.size()),
+            base::Entropy(p.data(), p.size(), 1, base::LogMode::kFast));
+  ASSERT_NEAR(base::Entropy(p.data(), p.size()), exact, 5e-8);
+  base::SetLogMode(base::LogMode::kExact);
+}
+
+INSTANTIATE_TEST_CASE_P(SimdLevels, VmathTest,
+                        ::testing::Values(base::SimdLevel::kScalar,
+                                          base::SimdLevel::kAvx2,
+                                          base::SimdLevel::kAvx512));